@@ -47,6 +47,21 @@ var gGWUriRoot = 'ant.r.gw';
 // var gGWUriMask = 'ant.r.gw.';
 var gGWVSMUri = 'ant.r.gw.vsm';
 
+/* Periodic incremental discovery of virtual sensors */
+var gVSDiscoveryIntervalMS = 30000;
+var gVSDiscoveryCacheTTLMS = gVSDiscoveryIntervalMS * 3;
+
+/* DFE scheduler: adaptive DNN partitioning */
+var gDFESchedulerIntervalMS = 5000;
+// Link bandwidth assumed until a transfer is measured (10 Mbps)
+var gDFEDefaultBandwidthBytesPerMS = 1250;
+// Partitioning point is changed only if it is expected to be faster by this
+// ratio. It prevents flapping between two points of similar latency.
+var gDFESchedulerSwitchRatio = 0.1;
+
+/* DFE profile: saved every this number of executions */
+var gDFEProfileSaveInterval = 100;
+
 /* URIs of Virtual Sensor Resources */
 
 /**
@@ -115,12 +130,17 @@ function ANTGateway() {}
  * @param {Number} numFragments the number of fragments
  * @param {String} targetUri the URI of target device that will be used for
  *                           DNN partitioning
+ * @param {Number} maxInFlightFrames (optional) the number of frames whose
+ *                                   tails can be executed on the target while
+ *                                   heads of next frames run. Default: 1
+ *                                   (not pipelined)
  * @returns {Object} a new ML fragment element for the ML model
  */
 ANTGateway.prototype.createImgClsImagenetElement = function (
   modelPath,
   numFragments,
-  targetUri
+  targetUri,
+  maxInFlightFrames
 ) {
   var mlFragmentElement = MLAPI.createMLFragmentElement(
     modelPath,
@@ -129,7 +149,8 @@ ANTGateway.prototype.createImgClsImagenetElement = function (
     'input',
     'gateway_imgcls_imagenet',
     numFragments,
-    targetUri
+    targetUri,
+    maxInFlightFrames
   );
   return mlFragmentElement;
 };
@@ -374,7 +395,7 @@ VirtualSensorAdapter.prototype.createDeepSensor = function (
   var hObserver = dfe.getObserverHandler();
   var hGenerator = dfe.getGeneratorHandler();
   var hSetting = dfe.getSettingHandler();
-  return this.createSensor(
+  var virtualSensor = this.createSensor(
     sensorName,
     sensorType,
     deviceType,
@@ -382,6 +403,8 @@ VirtualSensorAdapter.prototype.createDeepSensor = function (
     hGenerator,
     hSetting
   );
+  virtualSensor.mDFE = dfe;
+  return virtualSensor;
 };
 
 /**
@@ -645,11 +668,12 @@ VirtualSensor.prototype.addObserver = function (
   deviceType,
   endpoint,
   uri,
-  intervalMS
+  intervalMS,
+  deviceId
 ) {
   var self = this;
   var oa = gVSAdapter.mOCFAdapter;
-  function onIncomingInletData(response) {
+  function onIncomingInletData(response, elapsedMS) {
     var inputData = {};
     if (response.payload !== undefined) {
       var payloadObj = JSON.parse(response.payload);
@@ -667,6 +691,14 @@ VirtualSensor.prototype.addObserver = function (
       return;
     }
 
+    // Transfers of the source device let DFE scheduler estimate its link
+    var gwManager = gVSAdapter.getGWManager();
+    if (gwManager !== undefined && deviceId !== undefined) {
+      gwManager
+        .getDFEScheduler()
+        .reportTransfer(deviceId, inputData.buffer.length, elapsedMS);
+    }
+
     /*
      * Call custom observer handler
      * inputData.jsObject: (mandatory) JavaScript object
@@ -677,7 +709,11 @@ VirtualSensor.prototype.addObserver = function (
 
   // Start observer
   var intervalDesc = setInterval(function () {
-    oa.get(endpoint, uri, onIncomingInletData, undefined, undefined, true);
+    var requestTimeMS = Date.now();
+    function onResponse(response) {
+      onIncomingInletData(response, Date.now() - requestTimeMS);
+    }
+    oa.get(endpoint, uri, onResponse, undefined, undefined, true);
   }, intervalMS);
 
   // Add observer to the virtual sensor's observer list
@@ -857,7 +893,9 @@ function onPostInlet(request) {
   }
 
   if (response.result !== 'Failure') {
+    var virtualSensor = gVSAdapter.findSensorByUri(request.dest_uri);
     response = onPostInletInternal(
+      virtualSensor,
       commandType,
       sensorType,
       deviceType,
@@ -874,10 +912,22 @@ function onPostInlet(request) {
 /**
  * @private
  */
-function onPostInletInternal(commandType, sensorType, deviceType, intervalMS) {
+function onPostInletInternal(
+  virtualSensor,
+  commandType,
+  sensorType,
+  deviceType,
+  intervalMS
+) {
   // Step 1. Discover outlet resource
   var oa = gVSAdapter.mOCFAdapter;
-  function onDiscoveryAfterPostInlet(endpoint, uri, types, interfaceMask) {
+  function onDiscoveryAfterPostInlet(
+    endpoint,
+    uri,
+    types,
+    interfaceMask,
+    deviceId
+  ) {
     // Step 2. On discover outlet resource
     var isFoundSensorType = false;
     var isFoundDeviceType = false;
@@ -896,7 +946,8 @@ function onPostInletInternal(commandType, sensorType, deviceType, intervalMS) {
           deviceType,
           endpoint,
           uri,
-          intervalMS
+          intervalMS,
+          deviceId
         );
       } else if (commandType == 'remove') {
         // Remove observer
@@ -986,13 +1037,11 @@ function onPostSetting(request) {
   var resultJSONString = JSON.stringify(result);
 
   // Send response
-  if (!isFailed) {
-    var oa = gVSAdapter.mOCFAdapter;
-    var responsePayload = {
-      result: resultJSONString
-    };
-    oa.sendResponse(request, ocf.OC_STATUS_OK, responsePayload);
-  }
+  var oa = gVSAdapter.mOCFAdapter;
+  var responsePayload = {
+    result: resultJSONString
+  };
+  oa.sendResponse(request, OCFAPI.OC_STATUS_OK, responsePayload);
 }
 
 /*
@@ -1015,16 +1064,32 @@ function DFE(modelName, numFragments) {
   this.recentInputData = undefined;
   this.presentFragNum = numFragments - 1;
   this.averageLatencyMS = 0.0;
+  this.averageFragmentLatencyMS = 0.0;
+  // tensorBytes[i]: size of the tensor that goes into fragment i.
+  // tensorBytes[numFragments] is the size of the final output.
+  this.tensorBytes = [];
+  for (var i = 0; i <= numFragments; i++) {
+    this.tensorBytes.push(undefined);
+  }
+  // Profile table saved by the previous run on this device
+  this.savedProfile = undefined;
+  this.numExecutions = 0;
 }
 
 /**
  * @private
  */
-DFE.prototype.updateAverageLatency = function (latency) {
+DFE.prototype.updateAverageLatency = function (latency, numExecutedFragments) {
   // Exponential moving average
   var kMomentum = 0.9;
   this.averageLatencyMS =
     this.averageLatencyMS * kMomentum + latency * (1 - kMomentum);
+  if (numExecutedFragments > 0) {
+    var fragmentLatency = latency / numExecutedFragments;
+    this.averageFragmentLatencyMS =
+      this.averageFragmentLatencyMS * kMomentum +
+      fragmentLatency * (1 - kMomentum);
+  }
 };
 
 /**
@@ -1045,6 +1110,7 @@ DFE.prototype.load = function () {
     this.modelName,
     this.numFragments
   );
+  this.loadProfile();
 };
 
 /**
@@ -1063,12 +1129,119 @@ DFE.prototype.execute = function (inputBuffer, startLayerNum, endLayerNum) {
   if (typeof endLayerNum !== 'number' || parseInt(endLayerNum) != endLayerNum) {
     throw 'Invalid endLayerNum ' + endLayerNum;
   }
-  return native.ant_gateway_dfeExecute(
+  var startTimeMS = Date.now();
+  var outputBuffer = native.ant_gateway_dfeExecute(
     this.interpreters,
     inputBuffer,
     startLayerNum,
     endLayerNum
   );
+  var endTimeMS = Date.now();
+
+  // Update average latency and tensor sizes of the cut points
+  this.updateAverageLatency(
+    endTimeMS - startTimeMS,
+    endLayerNum - startLayerNum + 1
+  );
+  this.tensorBytes[startLayerNum] = inputBuffer.length;
+  this.tensorBytes[endLayerNum + 1] = outputBuffer.length;
+
+  // Save profile table periodically
+  this.numExecutions++;
+  if (this.numExecutions % gDFEProfileSaveInterval == 0) {
+    this.saveProfile();
+  }
+  return outputBuffer;
+};
+
+/**
+ * Get the latency profile table of the DFE's fragments. Each fragment's
+ * latency is measured by fragment runner except its warm-up invocations.
+ * Fragments not executed since loading take the entries saved by the
+ * previous run on this device.
+ * @returns {Object[]} profile table. Each entry has {count, meanMS, p50MS,
+ * p90MS, p99MS, outputBytes} of the fragment. undefined if the DFE has no
+ * profile (e.g. it is not loaded yet).
+ */
+DFE.prototype.getProfile = function () {
+  var profile;
+  try {
+    profile = JSON.parse(native.ant_gateway_dfeGetProfile(this.interpreters));
+  } catch (e) {
+    return undefined;
+  }
+  var savedProfile = this.savedProfile;
+  if (savedProfile !== undefined) {
+    for (var i = 0; i < profile.length; i++) {
+      if (profile[i].count == 0 && savedProfile[i] !== undefined) {
+        profile[i] = savedProfile[i];
+      }
+    }
+  }
+  return profile;
+};
+
+/**
+ * @private
+ */
+DFE.prototype.getProfilePath = function () {
+  // Profile is kept per model and per device
+  var hostname = 'localhost';
+  try {
+    hostname = fs.readFileSync('/etc/hostname').toString().trim();
+  } catch (e) {
+    // Use default hostname
+  }
+  return this.modelName + '.' + hostname + '.profile.json';
+};
+
+/**
+ * Save the profile table to the file of this model and device. It is loaded
+ * when the DFE is loaded again.
+ * @returns {Boolean} the result of saving profile table
+ */
+DFE.prototype.saveProfile = function () {
+  var profile = this.getProfile();
+  if (profile === undefined) {
+    return false;
+  }
+  var profileFile = {
+    modelName: this.modelName,
+    numFragments: this.numFragments,
+    profile: profile
+  };
+  try {
+    fs.writeFileSync(this.getProfilePath(), JSON.stringify(profileFile));
+  } catch (e) {
+    console.error('DFE profile error: cannot save ' + this.getProfilePath());
+    return false;
+  }
+  return true;
+};
+
+/**
+ * @private
+ */
+DFE.prototype.loadProfile = function () {
+  var profilePath = this.getProfilePath();
+  if (!fs.existsSync(profilePath)) {
+    return false;
+  }
+  try {
+    var profileFile = JSON.parse(fs.readFileSync(profilePath).toString());
+    if (
+      profileFile.numFragments !== this.numFragments ||
+      !Array.isArray(profileFile.profile)
+    ) {
+      console.error('DFE profile error: mismatched ' + profilePath);
+      return false;
+    }
+    this.savedProfile = profileFile.profile;
+  } catch (e) {
+    console.error('DFE profile error: cannot load ' + profilePath);
+    return false;
+  }
+  return true;
 };
 
 /**
@@ -1102,25 +1275,23 @@ DFE.prototype.getGeneratorHandler = function () {
     }
 
     var dfeFlag = jsObject.dfeFlag;
-    var fragNum = jsObject.jsObject;
+    var fragNum = jsObject.fragNum;
     if (dfeFlag === undefined || typeof dfeFlag !== 'boolean') {
       console.error('DFE generator error: invalid dfeFlag');
       return;
     } else if (dfeFlag) {
-      if (fragNum === undefined || typeof fragNum !== 'number') {
+      if (
+        fragNum === undefined ||
+        typeof fragNum !== 'number' ||
+        fragNum >= self.numFragments
+      ) {
         console.error('DFE generator error: invalid fragNum');
         return;
       }
     }
 
     // Execute DNN fragment
-    var startTimeMS = Date.now();
-    self.execute(buffer, fragNum, self.numFragments);
-    var endTimeMS = Date.now();
-
-    // Update average latency
-    var latencyMS = endTimeMS - startTimeMS;
-    self.updateAverageLatency(latencyMS);
+    self.execute(buffer, fragNum, self.numFragments - 1);
   }
   return dfeGeneratorHandler;
 };
@@ -1134,21 +1305,61 @@ DFE.prototype.getLoad = function () {
   return avgLoad1min;
 };
 
+/**
+ * @private
+ */
+DFE.prototype.getNumCPUs = function () {
+  if (this.numCPUs === undefined) {
+    var cpuinfo = fs.readFileSync('/proc/cpuinfo').toString();
+    var matches = cpuinfo.match(/^processor\s*:/gm);
+    this.numCPUs = matches !== null ? matches.length : 1;
+  }
+  return this.numCPUs;
+};
+
+/**
+ * Get the status of this DFE. DFE scheduler estimates the latency of every
+ * partitioning point with it.
+ * @returns {Object} status ({modelName, numFragments, fragNum, latencyMS,
+ * fragmentLatencyMS, tensorBytes, profile, load, numCPUs}). profile is omitted
+ * if the DFE has no profile.
+ */
+DFE.prototype.getStatus = function () {
+  return {
+    modelName: this.modelName,
+    numFragments: this.numFragments,
+    fragNum: this.presentFragNum,
+    latencyMS: this.averageLatencyMS,
+    fragmentLatencyMS: this.averageFragmentLatencyMS,
+    tensorBytes: this.tensorBytes,
+    profile: this.getProfile(),
+    load: this.getLoad(),
+    numCPUs: this.getNumCPUs()
+  };
+};
+
 /**
  * @private
  */
 DFE.prototype.getSettingHandler = function (fragNum) {
   var self = this;
   function dfeSettingHandler(setting) {
-    // Set fragment number
-    self.presentFragNum = setting.fragNum;
+    // Set fragment number if it is assigned. A setting without fragNum only
+    // queries the status.
+    var fragNum = setting.fragNum;
+    if (
+      typeof fragNum === 'number' &&
+      parseInt(fragNum) == fragNum &&
+      fragNum >= 0 &&
+      fragNum < self.numFragments
+    ) {
+      self.presentFragNum = fragNum;
+    } else if (fragNum !== undefined) {
+      console.error('DFE setting error: invalid fragNum ' + fragNum);
+    }
 
     // Return status
-    var latencyMS = self.averageLatencyMS;
-    var load = self.getLoad();
-
-    var result = {latencyMS: latencyMS, load: load};
-    return result;
+    return self.getStatus();
   }
   return dfeSettingHandler;
 };
@@ -1160,7 +1371,7 @@ DFE.prototype.getSettingHandler = function (fragNum) {
  */
 function GatewayManager() {
   this.mVirtualSensorManager = new VirtualSensorManager(this);
-  this.mDFEScheduler = new DFEScheduler();
+  this.mDFEScheduler = new DFEScheduler(this);
 }
 
 /**
@@ -1204,7 +1415,7 @@ GatewayManager.prototype.onOCFClientPrepared = function (vsAdapter) {
   // DFE scheduler: start
   var dfeScheduler = this.getDFEScheduler();
   if (dfeScheduler !== undefined) {
-    dfeScheduler.start();
+    dfeScheduler.start(vsAdapter);
   }
 };
 
@@ -1221,6 +1432,7 @@ function VirtualSensorManager(antGateway) {
   this.mInletList = [];
   this.mOutletList = [];
   this.mSettingList = [];
+  this.mDiscoveryTimer = undefined;
 }
 
 /**
@@ -1292,8 +1504,14 @@ VirtualSensorManager.prototype.setup = function (oa) {
  */
 VirtualSensorManager.prototype.startDiscovery = function (vsAdapter) {
   // Virtual sensor manager (OCF-client-side): background discovery
+  // Only new, changed or removed resources are reported by incremental
+  // discovery, so that rediscovery does not repeat the known resources.
   var self = this;
-  function onDiscovery(endpoint, uri, types, interfaceMask) {
+  function onDiscovery(endpoint, uri, types, interfaceMask, deviceId, change) {
+    if (change === 'removed') {
+      self.removeResource(deviceId, uri);
+      return;
+    }
     var isFound = false;
     for (var i = 0; i < types.length; i++) {
       if (types[i] == gVSUriRoot) {
@@ -1301,12 +1519,19 @@ VirtualSensorManager.prototype.startDiscovery = function (vsAdapter) {
       }
     }
     if (isFound) {
-      self.addResource(endpoint, uri, types);
+      self.addResource(endpoint, uri, types, deviceId);
     }
   }
 
   var oa = vsAdapter.getOCFAdapter();
-  oa.discoveryAll(onDiscovery);
+  var options = {incremental: true, cacheTTLMs: gVSDiscoveryCacheTTLMS};
+  oa.discoveryAll(onDiscovery, options);
+  if (this.mDiscoveryTimer === undefined) {
+    this.mDiscoveryTimer = setInterval(function () {
+      oa.stopDiscovery();
+      oa.discoveryAll(onDiscovery, options);
+    }, gVSDiscoveryIntervalMS);
+  }
 };
 
 /**
@@ -1492,7 +1717,15 @@ function onGetVirtualSensorManager(request) {
 /**
  * @private
  */
-VirtualSensorManager.prototype.addResource = function (endpoint, uri, types) {
+VirtualSensorManager.prototype.addResource = function (
+  endpoint,
+  uri,
+  types,
+  deviceId
+) {
+  // A changed resource replaces the previous entry.
+  this.removeResource(deviceId, uri);
+
   var vsTypes = [];
   var letType = undefined;
   for (var i = 0; i < types.length; i++) {
@@ -1505,7 +1738,12 @@ VirtualSensorManager.prototype.addResource = function (endpoint, uri, types) {
     }
     vsTypes.push(type);
   }
-  var foundEntry = {endpoint: endpoint, uri: uri, types: vsTypes};
+  var foundEntry = {
+    endpoint: endpoint,
+    uri: uri,
+    types: vsTypes,
+    deviceId: deviceId
+  };
   if (letType == gVSInletUri) {
     this.mInletList.push(foundEntry);
   } else if (letType == gVSOutletUri) {
@@ -1518,6 +1756,21 @@ VirtualSensorManager.prototype.addResource = function (endpoint, uri, types) {
   }
 };
 
+/**
+ * @private
+ */
+VirtualSensorManager.prototype.removeResource = function (deviceId, uri) {
+  var lists = [this.mInletList, this.mOutletList, this.mSettingList];
+  for (var i = 0; i < lists.length; i++) {
+    var list = lists[i];
+    for (var j = list.length - 1; j >= 0; j--) {
+      if (list[j].deviceId === deviceId && list[j].uri === uri) {
+        list.splice(j, 1);
+      }
+    }
+  }
+};
+
 /**
  * @private
  */
@@ -1552,21 +1805,341 @@ VirtualSensorManager.prototype.observeInlet = function (inletEntry) {
 /**
  * @class
  * @classdesc DFE Scheduler object. It is a module to manage DNN partitioning.
- * It monitors the current status of DFEs running on several devices and make
- * commands to control DFE's partitioning points. (Not yet implemented)
- */
-function DFEScheduler() {
-  this.mResource = undefined;
+ * It periodically collects the status of DFEs on the devices through their
+ * setting resources, and assigns each device the partitioning point (fragNum)
+ * that minimizes its expected end-to-end latency.
+ *
+ * With partitioning point k of a model with N fragments, the device executes
+ * fragments [0, k-1], sends the input tensor of fragment k, and the gateway
+ * executes fragments [k, N-1]. The expected latency of k is
+ *   (device latency of [0, k-1]) + (RTT + tensorBytes[k] / bandwidth)
+ *   + (gateway latency of [k, N-1]).
+ * Fragment latencies are scaled by CPU overload (load / numCPUs) of each side.
+ * @param {Object} gwManager the gateway manager
+ */
+function DFEScheduler(gwManager) {
+  this.mGatewayManager = gwManager;
+  this.mVSAdapter = undefined;
+  this.mTimer = undefined;
+  // Scheduled clients (key: deviceId + setting URI)
+  this.mClients = {};
+  // Link bandwidth estimates (key: deviceId, value: bytes/ms)
+  this.mBandwidths = {};
 }
 
 /**
  * @private
  */
 DFEScheduler.prototype.start = function (vsAdapter) {
-  // TODO(RedCarrottt): DFEScheduler: client - GET setting resource
-  // Not yet implemented
+  var self = this;
+  this.mVSAdapter = vsAdapter;
+  if (this.mTimer === undefined) {
+    this.mTimer = setInterval(function () {
+      self.schedule();
+    }, gDFESchedulerIntervalMS);
+  }
+};
+
+/**
+ * @private
+ */
+DFEScheduler.prototype.stop = function () {
+  if (this.mTimer !== undefined) {
+    clearInterval(this.mTimer);
+    this.mTimer = undefined;
+  }
+};
+
+/**
+ * Get the present partitioning points assigned by DFE scheduler.
+ * @returns {Object[]} assignments ({deviceId, uri, fragNum,
+ * expectedLatencyMS, bandwidthBytesPerMS})
+ */
+DFEScheduler.prototype.getAssignments = function () {
+  var assignments = [];
+  for (var key in this.mClients) {
+    var client = this.mClients[key];
+    assignments.push({
+      deviceId: client.deviceId,
+      uri: client.uri,
+      fragNum: client.fragNum,
+      expectedLatencyMS: client.expectedLatencyMS,
+      bandwidthBytesPerMS: this.getBandwidth(client.deviceId)
+    });
+  }
+  return assignments;
+};
+
+/**
+ * Report a transfer from a device. It updates the link bandwidth estimate of
+ * the device. The elapsed time includes the response time of the device, so
+ * the estimate is conservative.
+ * @param {String} deviceId the device ID of the source device
+ * @param {Number} bytes the transferred bytes
+ * @param {Number} elapsedMS the elapsed time of the transfer
+ */
+DFEScheduler.prototype.reportTransfer = function (deviceId, bytes, elapsedMS) {
+  // Exponential moving average
+  var kMomentum = 0.8;
+  var bandwidth = bytes / Math.max(elapsedMS, 1);
+  var prevBandwidth = this.mBandwidths[deviceId];
+  if (prevBandwidth === undefined) {
+    this.mBandwidths[deviceId] = bandwidth;
+  } else {
+    this.mBandwidths[deviceId] =
+      prevBandwidth * kMomentum + bandwidth * (1 - kMomentum);
+  }
+};
+
+/**
+ * @private
+ */
+DFEScheduler.prototype.getBandwidth = function (deviceId) {
+  var bandwidth = this.mBandwidths[deviceId];
+  return bandwidth !== undefined ? bandwidth : gDFEDefaultBandwidthBytesPerMS;
+};
+
+/**
+ * @private
+ */
+DFEScheduler.prototype.schedule = function () {
+  var settings = this.mGatewayManager.getVSManager().mSettingList;
+  var liveKeys = {};
+  for (var i = 0; i < settings.length; i++) {
+    var entry = settings[i];
+    var key = entry.deviceId + entry.uri;
+    liveKeys[key] = true;
+    this.pollClient(key, entry);
+  }
+
+  // Forget the clients whose setting resources are removed
+  for (var key in this.mClients) {
+    if (liveKeys[key] === undefined) {
+      delete this.mClients[key];
+    }
+  }
+};
+
+/**
+ * @private
+ */
+DFEScheduler.prototype.pollClient = function (key, entry) {
+  var self = this;
+  var client = this.mClients[key];
+  if (client === undefined) {
+    client = {
+      deviceId: entry.deviceId,
+      uri: entry.uri,
+      endpoint: undefined,
+      status: undefined,
+      rttMS: 0,
+      fragNum: undefined,
+      expectedLatencyMS: undefined
+    };
+    this.mClients[key] = client;
+  }
+  client.endpoint = entry.endpoint;
+
+  // Setting without fragNum: query the status of the device's DFE
+  var requestTimeMS = Date.now();
+  function onStatus(response) {
+    var status = parseSettingResponse(response);
+    if (status === undefined) {
+      return;
+    }
+    client.rttMS = Date.now() - requestTimeMS;
+    client.status = status;
+    self.assign(client);
+  }
+  this.postSetting(client, {}, onStatus);
 };
 
+/**
+ * @private
+ */
+DFEScheduler.prototype.postSetting = function (client, setting, onResponse) {
+  var oa = this.mVSAdapter.getOCFAdapter();
+  var res = oa.post(
+    client.endpoint,
+    client.uri,
+    onResponse,
+    '',
+    OCFAPI.OC_LOW_QOS,
+    false,
+    setting
+  );
+  if (!res) {
+    console.error('DFE scheduler: failed to post setting to ' + client.uri);
+  }
+  return res;
+};
+
+/**
+ * @private
+ */
+DFEScheduler.prototype.assign = function (client) {
+  var status = client.status;
+  var latencies = this.estimateLatencies(client);
+  if (latencies === undefined) {
+    return;
+  }
+
+  var bestFragNum = 0;
+  for (var k = 1; k < latencies.length; k++) {
+    if (latencies[k] < latencies[bestFragNum]) {
+      bestFragNum = k;
+    }
+  }
+
+  // Keep the present partitioning point unless the best one is enough faster
+  var fragNum = status.fragNum;
+  if (
+    typeof fragNum === 'number' &&
+    fragNum >= 0 &&
+    fragNum < latencies.length &&
+    latencies[bestFragNum] >=
+      latencies[fragNum] * (1 - gDFESchedulerSwitchRatio)
+  ) {
+    client.fragNum = fragNum;
+    client.expectedLatencyMS = latencies[fragNum];
+    return;
+  }
+
+  client.fragNum = bestFragNum;
+  client.expectedLatencyMS = latencies[bestFragNum];
+  this.postSetting(client, {fragNum: bestFragNum}, function () {});
+};
+
+/**
+ * @private
+ */
+DFEScheduler.prototype.findLocalDFEStatus = function (modelName) {
+  var virtualSensors = this.mVSAdapter.mVirtualSensors;
+  for (var i = 0; i < virtualSensors.length; i++) {
+    var dfe = virtualSensors[i].mDFE;
+    if (dfe !== undefined && dfe.modelName === modelName) {
+      return dfe.getStatus();
+    }
+  }
+  return undefined;
+};
+
+/**
+ * Estimate the end-to-end latency of every partitioning point of a client.
+ * @private
+ * The gateway executes at least the last fragment, so the partitioning point k
+ * is in [0, numFragments - 1].
+ * @returns {Number[]} latencies[k] (0 <= k < numFragments), or undefined if
+ * no fragment latency is known yet
+ */
+DFEScheduler.prototype.estimateLatencies = function (client) {
+  var deviceStatus = client.status;
+  var numFragments = deviceStatus.numFragments;
+  if (typeof numFragments !== 'number' || numFragments <= 0) {
+    return undefined;
+  }
+
+  // The gateway's own DFE of the same model tells the gateway-side cost.
+  // If one side is not measured yet, it is assumed to be as fast as the other.
+  var gatewayStatus = this.findLocalDFEStatus(deviceStatus.modelName);
+  var deviceCosts = getFragmentCosts(deviceStatus, numFragments);
+  var gatewayCosts =
+    gatewayStatus !== undefined
+      ? getFragmentCosts(gatewayStatus, numFragments)
+      : undefined;
+  if (deviceCosts === undefined) deviceCosts = gatewayCosts;
+  if (gatewayCosts === undefined) gatewayCosts = deviceCosts;
+  if (deviceCosts === undefined) {
+    return undefined;
+  }
+
+  var bandwidth = this.getBandwidth(client.deviceId);
+  var latencies = [];
+  for (var k = 0; k < numFragments; k++) {
+    var latency = client.rttMS;
+    for (var i = 0; i < k; i++) {
+      latency += deviceCosts[i];
+    }
+    for (var i = k; i < numFragments; i++) {
+      latency += gatewayCosts[i];
+    }
+    var bytes = getTensorBytes(deviceStatus, gatewayStatus, k);
+    if (bytes !== undefined) {
+      latency += bytes / bandwidth;
+    }
+    latencies.push(latency);
+  }
+  return latencies;
+};
+
+/**
+ * @private
+ */
+function parseSettingResponse(response) {
+  try {
+    var payload = JSON.parse(response.payload);
+    var status = JSON.parse(payload.result);
+    return typeof status === 'object' && status !== null ? status : undefined;
+  } catch (e) {
+    console.error('DFE scheduler: invalid setting response');
+    return undefined;
+  }
+}
+
+/**
+ * Per-fragment latencies of a DFE, scaled by its CPU overload. The median of
+ * the fragment's profile is used, or the average fragment latency if the
+ * fragment is not profiled yet.
+ * @private
+ */
+function getFragmentCosts(status, numFragments) {
+  var fragmentLatencyMS = status.fragmentLatencyMS;
+  var profile = Array.isArray(status.profile) ? status.profile : [];
+  var numCPUs = status.numCPUs > 0 ? status.numCPUs : 1;
+  var loadFactor = Math.max(1, status.load / numCPUs);
+  var costs = [];
+  for (var i = 0; i < numFragments; i++) {
+    var entry = profile[i];
+    var cost = undefined;
+    if (entry !== undefined && entry !== null && entry.count > 0) {
+      cost = entry.p50MS;
+    } else if (typeof fragmentLatencyMS === 'number' && fragmentLatencyMS > 0) {
+      cost = fragmentLatencyMS;
+    } else {
+      return undefined;
+    }
+    costs.push(cost * loadFactor);
+  }
+  return costs;
+}
+
+/**
+ * Size of the tensor transferred at partitioning point k. Cut points that are
+ * not measured yet take the size of the nearest measured one before them.
+ * @private
+ */
+function getTensorBytes(deviceStatus, gatewayStatus, k) {
+  var statuses = [deviceStatus, gatewayStatus];
+  for (var i = k; i >= 0; i--) {
+    for (var j = 0; j < statuses.length; j++) {
+      var status = statuses[j];
+      if (status === undefined || !Array.isArray(status.tensorBytes)) {
+        continue;
+      }
+      var bytes = status.tensorBytes[i];
+      if (typeof bytes === 'number') {
+        return bytes;
+      }
+      // Output of the previous fragment
+      var entry = Array.isArray(status.profile) ? status.profile[i - 1] : null;
+      if (entry !== undefined && entry !== null && entry.outputBytes > 0) {
+        return entry.outputBytes;
+      }
+    }
+  }
+  return undefined;
+}
+
 /**
  * @class
  * @classdesc Gateway client.
@@ -27,10 +27,21 @@
 #include "./ant_gateway_common.h"
 #include "./ant_gateway_dfe.h"
 #include "./internal/ant_gateway_dfe_internal.h"
+#include "./internal/ant_gateway_dfe_native_internal.h"
 
 const jerry_object_native_info_t interpreters_native_info = {
     .free_cb = (jerry_object_native_free_callback_t)interpreters_destroy,
 };
+const jerry_object_native_info_t dfe_native_native_info = {
+    .free_cb = (jerry_object_native_free_callback_t)dfe_native_destroy,
+};
+
+static jerry_value_t create_js_buffer_from(const void *data, size_t length) {
+  jerry_value_t js_buffer = iotjs_bufferwrap_create_buffer(length);
+  iotjs_bufferwrap_t *buffer = iotjs_bufferwrap_from_jbuffer(js_buffer);
+  iotjs_bufferwrap_copy(buffer, (const char *)data, length);
+  return js_buffer;
+}
 
 // TODO(RedCarrottt): hard-coding input
 JS_FUNCTION(ant_gateway_dfeLoadAndPreprocessImage) {
@@ -67,13 +78,21 @@ JS_FUNCTION(ant_gateway_dfeLoad) {
   argNumFragments = (int)JS_GET_ARG(1, number);
   const char *modelName = iotjs_string_data(&argModelName);
 
-  void *native_interpreters =
-      ant_gateway_dfeLoad_internal(modelName, argNumFragments);
+  // Native engine is preferred. Python engine is used if it is not available.
   jerry_value_t js_interpreters = jerry_create_object();
-  jerry_set_object_native_pointer(js_interpreters, native_interpreters,
-                                  &interpreters_native_info);
-  IOTJS_ASSERT(jerry_get_object_native_pointer(js_interpreters, NULL,
-                                               &interpreters_native_info));
+  void *dfe_native =
+      ant_gateway_dfeNativeLoad_internal(modelName, argNumFragments);
+  if (dfe_native != NULL) {
+    jerry_set_object_native_pointer(js_interpreters, dfe_native,
+                                    &dfe_native_native_info);
+  } else {
+    void *native_interpreters =
+        ant_gateway_dfeLoad_internal(modelName, argNumFragments);
+    jerry_set_object_native_pointer(js_interpreters, native_interpreters,
+                                    &interpreters_native_info);
+    IOTJS_ASSERT(jerry_get_object_native_pointer(js_interpreters, NULL,
+                                                 &interpreters_native_info));
+  }
 
   iotjs_string_destroy(&argModelName);
   return js_interpreters;
@@ -90,15 +109,35 @@ JS_FUNCTION(ant_gateway_dfeExecute) {
   argStartLayerNum = (int)JS_GET_ARG(2, number);
   argEndLayerNum = (int)JS_GET_ARG(3, number);
 
-  JS_DECLARE_PTR2(argInterpreters, void, interpreters_nobject, interpreters);
   iotjs_bufferwrap_t *inputTensorBuffer =
       iotjs_bufferwrap_from_jbuffer(argInputTensor);
   void *inputTensorNativeBuffer = (void *)inputTensorBuffer->buffer;
   size_t inputTensorLength = iotjs_bufferwrap_length(inputTensorBuffer);
 
+  // Native engine: output tensor is resident in the engine
+  void *dfe_native = NULL;
+  if (jerry_get_object_native_pointer(argInterpreters, &dfe_native,
+                                      &dfe_native_native_info)) {
+    const void *outputTensorNativeBuffer = NULL;
+    size_t outputTensorLength = 0;
+    if (!ant_gateway_dfeNativeExecute_internal(
+            dfe_native, inputTensorNativeBuffer, inputTensorLength,
+            argStartLayerNum, argEndLayerNum, &outputTensorNativeBuffer,
+            &outputTensorLength)) {
+      return JS_CREATE_ERROR(COMMON, "DFE execution failed");
+    }
+    return create_js_buffer_from(outputTensorNativeBuffer,
+                                 outputTensorLength);
+  }
+
+  // Python engine
+  JS_DECLARE_PTR2(argInterpreters, void, interpreters_nobject, interpreters);
   void *outputTensor = ant_gateway_dfeExecute_internal(
       interpreters_nobject, inputTensorNativeBuffer, inputTensorLength,
       argStartLayerNum, argEndLayerNum);
+  if (outputTensor == NULL) {
+    return JS_CREATE_ERROR(COMMON, "DFE execution failed");
+  }
 
   size_t outputTensorLength;
   void *outputTensorNativeBuffer =
@@ -106,21 +145,41 @@ JS_FUNCTION(ant_gateway_dfeExecute) {
                                                        &outputTensorLength);
 
   jerry_value_t js_outputTensor =
-      iotjs_bufferwrap_create_buffer(outputTensorLength);
-  iotjs_bufferwrap_t *outputTensorBuffer =
-      iotjs_bufferwrap_from_jbuffer(js_outputTensor);
-  iotjs_bufferwrap_copy(outputTensorBuffer,
-                        (const char *)outputTensorNativeBuffer,
-                        outputTensorLength);
+      create_js_buffer_from(outputTensorNativeBuffer, outputTensorLength);
   ant_gateway_dfeExecute_releaseOutput(outputTensor);
 
   return js_outputTensor;
 }
 
+JS_FUNCTION(ant_gateway_dfeGetProfile) {
+  jerry_value_t argInterpreters;
+  DJS_CHECK_ARGS(1, object);
+  argInterpreters = JS_GET_ARG(0, object);
+
+  char *profile = NULL;
+  void *dfe_native = NULL;
+  if (jerry_get_object_native_pointer(argInterpreters, &dfe_native,
+                                      &dfe_native_native_info)) {
+    profile = ant_gateway_dfeNativeGetProfile_internal(dfe_native);
+  } else {
+    JS_DECLARE_PTR2(argInterpreters, void, interpreters_nobject,
+                    interpreters);
+    profile = ant_gateway_dfeGetProfile_internal(interpreters_nobject);
+  }
+  if (profile == NULL) {
+    return JS_CREATE_ERROR(COMMON, "DFE profile not available");
+  }
+
+  jerry_value_t js_profile = jerry_create_string((const jerry_char_t *)profile);
+  free(profile);
+  return js_profile;
+}
+
 void InitANTGatewayDFE(jerry_value_t nativeObj) {
   // TODO(RedCarrottt): hard-coding input
   REGISTER_ANT_API(nativeObj, ant_gateway, dfeLoadAndPreprocessImage);
 
   REGISTER_ANT_API(nativeObj, ant_gateway, dfeLoad);
   REGISTER_ANT_API(nativeObj, ant_gateway, dfeExecute);
+  REGISTER_ANT_API(nativeObj, ant_gateway, dfeGetProfile);
 }
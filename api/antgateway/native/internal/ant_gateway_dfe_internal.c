@@ -16,6 +16,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 
@@ -38,6 +39,7 @@ void interpreters_destroy(void *interpreters) {
 }
 
 PyObject *gPyModule = NULL;
+PyObject *gPyDfeExecute = NULL;
 
 void ant_gateway_dfe_initOnce(void) {
   // Initialize Python interpreter
@@ -81,7 +83,6 @@ void *ant_gateway_dfeLoadAndPreprocessImage_internal(const char *imgPath) {
   // Call inner python function
   PyObject *pyInputTensor = PyObject_CallObject(pyFunc, pyArgs);
   ANT_PYTHON_ASSERT(pyInputTensor != NULL);
-  Py_DECREF(pyImgPath);
   Py_DECREF(pyFunc);
   Py_DECREF(pyArgs);
 
@@ -139,8 +140,6 @@ void *ant_gateway_dfeLoad_internal(const char *modelName, int numFragments) {
   // Call inner python function
   PyObject *pyInterpreters = PyObject_CallObject(pyFunc, pyArgs);
   ANT_PYTHON_ASSERT(pyInterpreters != NULL);
-  Py_DECREF(pyModelName);
-  Py_DECREF(pyNumFragments);
   Py_DECREF(pyFunc);
   Py_DECREF(pyArgs);
 
@@ -161,45 +160,56 @@ void *ant_gateway_dfeExecute_internal(void *interpreters, void *inputTensor,
     return NULL;
   }
 
-  PyObject *pyFunc = PyObject_GetAttrString(gPyModule, "dfe_execute");
-  if (pyFunc == NULL) {
-    fprintf(stderr, "ERROR: ant_gateway_dfeExecute_internal - Null function\n");
-    return NULL;
-  } else if (!PyCallable_Check(pyFunc)) {
-    fprintf(stderr,
-            "ERROR: ant_gateway_dfeExecute_internal - Function not callable\n");
-    Py_DECREF(pyFunc);
-    return NULL;
+  // Python function is looked up only once
+  if (gPyDfeExecute == NULL) {
+    PyObject *pyFunc = PyObject_GetAttrString(gPyModule, "dfe_execute");
+    if (pyFunc == NULL) {
+      fprintf(stderr,
+              "ERROR: ant_gateway_dfeExecute_internal - Null function\n");
+      return NULL;
+    } else if (!PyCallable_Check(pyFunc)) {
+      fprintf(stderr, "ERROR: ant_gateway_dfeExecute_internal - "
+                      "Function not callable\n");
+      Py_DECREF(pyFunc);
+      return NULL;
+    }
+    gPyDfeExecute = pyFunc;
   }
 
-  PyObject *pyArgs = PyTuple_New(2);
-  // Arg 0: object interpreters
-  PyObject *pyInterpreters = (PyObject *)interpreters;
-  PyTuple_SET_ITEM(pyArgs, 0, pyInterpreters);
-
-  // Arg 1: bytebuffer input_tensor
-  PyObject *pyInputTensor = Py_BuildValue("S", inputTensor, inputTensorLength);
-  ANT_PYTHON_ASSERT(pyInputTensor);
-  PyTuple_SET_ITEM(pyArgs, 1, pyInputTensor);
-
-  // Arg 2: int start_layer_num
-  PyObject *pyStartLayerNum = PyLong_FromLong((long)startLayerNum);
-  ANT_PYTHON_ASSERT(pyStartLayerNum != NULL);
-  PyTuple_SET_ITEM(pyArgs, 2, pyStartLayerNum);
+  // Arg 1: memoryview input_tensor
+  // It refers to the caller's buffer without copy, and it is valid only while
+  // the function is called.
+  PyObject *pyInputTensor = PyMemoryView_FromMemory(
+      (char *)inputTensor, (Py_ssize_t)inputTensorLength, PyBUF_READ);
+  ANT_PYTHON_ASSERT(pyInputTensor != NULL);
+  if (pyInputTensor == NULL) {
+    return NULL;
+  }
 
-  // Arg 3: int end_layer_num
-  PyObject *pyEndLayerNum = PyLong_FromLong((long)endLayerNum);
-  ANT_PYTHON_ASSERT(pyEndLayerNum != NULL);
-  PyTuple_SET_ITEM(pyArgs, 2, pyEndLayerNum);
+  // Args: (interpreters, input_tensor, start_layer_num, end_layer_num)
+  PyObject *pyArgs = Py_BuildValue("(OOii)", (PyObject *)interpreters,
+                                   pyInputTensor, startLayerNum, endLayerNum);
+  ANT_PYTHON_ASSERT(pyArgs != NULL);
 
   // Call inner python function
-  PyObject *pyOutputTensor = PyObject_CallObject(pyFunc, pyArgs);
-  ANT_PYTHON_ASSERT(pyOutputTensor != NULL);
+  PyObject *pyOutputTensor = NULL;
+  if (pyArgs != NULL) {
+    pyOutputTensor = PyObject_CallObject(gPyDfeExecute, pyArgs);
+    ANT_PYTHON_ASSERT(pyOutputTensor != NULL);
+    Py_DECREF(pyArgs);
+  }
+
+  // Caller's buffer must not be referred after return
+  PyObject *pyReleaseResult =
+      PyObject_CallMethod(pyInputTensor, "release", NULL);
+  if (pyReleaseResult == NULL) {
+    fprintf(stderr, "ERROR: ant_gateway_dfeExecute_internal - "
+                    "Input tensor is still referred\n");
+    PyErr_Print();
+  } else {
+    Py_DECREF(pyReleaseResult);
+  }
   Py_DECREF(pyInputTensor);
-  Py_DECREF(pyStartLayerNum);
-  Py_DECREF(pyEndLayerNum);
-  Py_DECREF(pyArgs);
-  Py_DECREF(pyFunc);
 
   // Return: bytebuffer output_tensor
   void *outputTensor = (void *)pyOutputTensor;
@@ -220,3 +230,25 @@ void ant_gateway_dfeExecute_releaseOutput(void *outputTensor) {
   PyObject *pyOutputTensor = (PyObject *)outputTensor;
   Py_DECREF(pyOutputTensor);
 }
+
+char *ant_gateway_dfeGetProfile_internal(void *interpreters) {
+  ant_gateway_dfe_initOnce();
+
+  if (gPyModule == NULL) {
+    fprintf(stderr, "ERROR: ant_gateway_dfeGetProfile_internal - "
+                    "Module not imported\n");
+    return NULL;
+  }
+
+  // Return: string profile (JSON)
+  PyObject *pyProfile = PyObject_CallMethod(gPyModule, "dfe_get_profile", "(O)",
+                                            (PyObject *)interpreters);
+  ANT_PYTHON_ASSERT(pyProfile != NULL);
+  if (pyProfile == NULL) {
+    return NULL;
+  }
+  const char *profile = PyUnicode_AsUTF8(pyProfile);
+  char *result = (profile != NULL) ? strdup(profile) : NULL;
+  Py_DECREF(pyProfile);
+  return result;
+}
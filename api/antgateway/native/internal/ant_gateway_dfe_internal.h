@@ -33,4 +33,7 @@ ant_gateway_dfeExecute_getOutputBufferWithLength(void *outputTensor,
                                                  size_t *pOutputTensorLength);
 void ant_gateway_dfeExecute_releaseOutput(void *outputTensor);
 
+// Returns the profile table as JSON string. It must be freed by the caller.
+char *ant_gateway_dfeGetProfile_internal(void *interpreters);
+
 #endif /* !defined(__ANT_GATEWAY_DFE_INTERNAL_H__) */
@@ -0,0 +1,277 @@
+/* Copyright (c) 2017-2021 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "./ant_gateway_dfe_native_internal.h"
+
+#ifdef ANT_GATEWAY_DFE_TFLITE
+
+#include <tensorflow/lite/c/c_api.h>
+
+#define DFE_NATIVE_PATH_LENGTH 256
+
+// Latency profile of a fragment. Warm-up invocations are not counted, and
+// percentiles are taken from the recent samples.
+typedef struct {
+  unsigned int warmups;
+  unsigned long count;
+  double total_ms;
+  float samples_ms[DFE_PROFILE_SAMPLES];
+  unsigned int next_sample;
+  size_t output_bytes;
+} dfe_native_profile_t;
+
+// Each fragment keeps its interpreter and tensors resident from load to
+// destroy. Input and output tensors are looked up once after allocation.
+typedef struct {
+  TfLiteModel *model;
+  TfLiteInterpreter *interpreter;
+  TfLiteTensor *input;
+  const TfLiteTensor *output;
+  dfe_native_profile_t profile;
+} dfe_native_fragment_t;
+
+typedef struct {
+  int num_fragments;
+  dfe_native_fragment_t fragments[];
+} dfe_native_t;
+
+void dfe_native_destroy(void *dfeNative) {
+  dfe_native_t *dfe = (dfe_native_t *)dfeNative;
+  int i;
+  if (dfe == NULL)
+    return;
+  for (i = 0; i < dfe->num_fragments; i++) {
+    dfe_native_fragment_t *fragment = &dfe->fragments[i];
+    if (fragment->interpreter != NULL)
+      TfLiteInterpreterDelete(fragment->interpreter);
+    if (fragment->model != NULL)
+      TfLiteModelDelete(fragment->model);
+  }
+  free(dfe);
+}
+
+static bool load_fragment(dfe_native_fragment_t *fragment, const char *path,
+                          const TfLiteInterpreterOptions *options) {
+  fragment->model = TfLiteModelCreateFromFile(path);
+  if (fragment->model == NULL) {
+    fprintf(stderr, "ERROR: DFE native - Cannot load %s\n", path);
+    return false;
+  }
+  fragment->interpreter = TfLiteInterpreterCreate(fragment->model, options);
+  if (fragment->interpreter == NULL) {
+    fprintf(stderr, "ERROR: DFE native - Cannot create interpreter of %s\n",
+            path);
+    return false;
+  }
+  if (TfLiteInterpreterAllocateTensors(fragment->interpreter) != kTfLiteOk) {
+    fprintf(stderr, "ERROR: DFE native - Cannot allocate tensors of %s\n",
+            path);
+    return false;
+  }
+  fragment->input = TfLiteInterpreterGetInputTensor(fragment->interpreter, 0);
+  fragment->output = TfLiteInterpreterGetOutputTensor(fragment->interpreter, 0);
+  if (fragment->input == NULL || fragment->output == NULL ||
+      TfLiteTensorType(fragment->input) != kTfLiteFloat32 ||
+      TfLiteTensorType(fragment->output) != kTfLiteFloat32) {
+    fprintf(stderr, "ERROR: DFE native - Unsupported tensors of %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void profile_add(dfe_native_profile_t *profile, double latency_ms,
+                        size_t output_bytes) {
+  profile->output_bytes = output_bytes;
+  if (profile->warmups < DFE_PROFILE_WARMUPS) {
+    profile->warmups++;
+    return;
+  }
+  profile->count++;
+  profile->total_ms += latency_ms;
+  profile->samples_ms[profile->next_sample] = (float)latency_ms;
+  profile->next_sample = (profile->next_sample + 1) % DFE_PROFILE_SAMPLES;
+}
+
+static int compare_float(const void *a, const void *b) {
+  float fa = *(const float *)a;
+  float fb = *(const float *)b;
+  return (fa > fb) - (fa < fb);
+}
+
+// Nearest-rank percentile of sorted samples
+static double get_percentile(const float *sorted, unsigned int num_samples,
+                             int percent) {
+  unsigned int rank = (num_samples * (unsigned int)percent + 99) / 100;
+  return (rank > 0) ? (double)sorted[rank - 1] : 0.0;
+}
+
+void *ant_gateway_dfeNativeLoad_internal(const char *modelName,
+                                         int numFragments) {
+  TfLiteInterpreterOptions *options;
+  dfe_native_t *dfe;
+  bool is_loaded = true;
+  int i;
+
+  if (numFragments <= 0)
+    return NULL;
+  dfe = (dfe_native_t *)calloc(1, sizeof(dfe_native_t) +
+                                      sizeof(dfe_native_fragment_t) *
+                                          (size_t)numFragments);
+  if (dfe == NULL)
+    return NULL;
+  dfe->num_fragments = numFragments;
+
+  options = TfLiteInterpreterOptionsCreate();
+  TfLiteInterpreterOptionsSetNumThreads(options, DFE_NATIVE_NUM_THREADS);
+  for (i = 0; i < numFragments && is_loaded; i++) {
+    char path[DFE_NATIVE_PATH_LENGTH];
+    snprintf(path, DFE_NATIVE_PATH_LENGTH, "%s-%d.tflite", modelName, i);
+    is_loaded = load_fragment(&dfe->fragments[i], path, options);
+  }
+  TfLiteInterpreterOptionsDelete(options);
+
+  if (!is_loaded) {
+    dfe_native_destroy(dfe);
+    return NULL;
+  }
+  return (void *)dfe;
+}
+
+bool ant_gateway_dfeNativeExecute_internal(void *dfeNative,
+                                           const void *inputTensor,
+                                           size_t inputTensorLength,
+                                           int startLayerNum, int endLayerNum,
+                                           const void **pOutputTensor,
+                                           size_t *pOutputTensorLength) {
+  dfe_native_t *dfe = (dfe_native_t *)dfeNative;
+  dfe_native_fragment_t *fragment;
+  int i;
+
+  if (dfe == NULL || startLayerNum < 0 || endLayerNum < startLayerNum ||
+      endLayerNum >= dfe->num_fragments) {
+    fprintf(stderr, "ERROR: DFE native - Invalid fragment range %d-%d\n",
+            startLayerNum, endLayerNum);
+    return false;
+  }
+
+  // Copy input to the first fragment, and hand over each output tensor to
+  // next fragment's resident input tensor.
+  fragment = &dfe->fragments[startLayerNum];
+  if (TfLiteTensorCopyFromBuffer(fragment->input, inputTensor,
+                                 inputTensorLength) != kTfLiteOk) {
+    fprintf(stderr, "ERROR: DFE native - Input size mismatch (%zu != %zu)\n",
+            inputTensorLength, TfLiteTensorByteSize(fragment->input));
+    return false;
+  }
+  for (i = startLayerNum; i <= endLayerNum; i++) {
+    fragment = &dfe->fragments[i];
+    if (i > startLayerNum) {
+      const TfLiteTensor *prevOutput = dfe->fragments[i - 1].output;
+      if (TfLiteTensorCopyFromBuffer(
+              fragment->input, TfLiteTensorData(prevOutput),
+              TfLiteTensorByteSize(prevOutput)) != kTfLiteOk) {
+        fprintf(stderr, "ERROR: DFE native - Fragment %d input mismatch\n",
+                i);
+        return false;
+      }
+    }
+    double start_ms = now_ms();
+    if (TfLiteInterpreterInvoke(fragment->interpreter) != kTfLiteOk) {
+      fprintf(stderr, "ERROR: DFE native - Fragment %d failed\n", i);
+      return false;
+    }
+    profile_add(&fragment->profile, now_ms() - start_ms,
+                TfLiteTensorByteSize(fragment->output));
+  }
+
+  *pOutputTensor = TfLiteTensorData(fragment->output);
+  *pOutputTensorLength = TfLiteTensorByteSize(fragment->output);
+  return true;
+}
+
+char *ant_gateway_dfeNativeGetProfile_internal(void *dfeNative) {
+  dfe_native_t *dfe = (dfe_native_t *)dfeNative;
+  size_t json_size, json_length = 0;
+  char *json;
+  int i;
+
+  if (dfe == NULL)
+    return NULL;
+  json_size = DFE_PROFILE_JSON_ENTRY_LENGTH * (size_t)dfe->num_fragments + 3;
+  json = (char *)malloc(json_size);
+  if (json == NULL)
+    return NULL;
+
+  json[json_length++] = '[';
+  for (i = 0; i < dfe->num_fragments; i++) {
+    dfe_native_profile_t *profile = &dfe->fragments[i].profile;
+    float sorted[DFE_PROFILE_SAMPLES];
+    unsigned int num_samples = (profile->count < DFE_PROFILE_SAMPLES)
+                                   ? (unsigned int)profile->count
+                                   : DFE_PROFILE_SAMPLES;
+    double mean_ms =
+        (profile->count > 0) ? profile->total_ms / profile->count : 0.0;
+    memcpy(sorted, profile->samples_ms, sizeof(float) * num_samples);
+    qsort(sorted, num_samples, sizeof(float), compare_float);
+    json_length += (size_t)snprintf(
+        json + json_length, json_size - json_length,
+        "%s{\"count\":%lu,\"meanMS\":%.3f,\"p50MS\":%.3f,"
+        "\"p90MS\":%.3f,\"p99MS\":%.3f,\"outputBytes\":%zu}",
+        (i > 0) ? "," : "", profile->count, mean_ms,
+        get_percentile(sorted, num_samples, 50),
+        get_percentile(sorted, num_samples, 90),
+        get_percentile(sorted, num_samples, 99), profile->output_bytes);
+  }
+  json[json_length++] = ']';
+  json[json_length] = '\0';
+  return json;
+}
+
+#else /* !defined(ANT_GATEWAY_DFE_TFLITE) */
+
+void dfe_native_destroy(void *dfeNative) {}
+
+void *ant_gateway_dfeNativeLoad_internal(const char *modelName,
+                                         int numFragments) {
+  return NULL;
+}
+
+bool ant_gateway_dfeNativeExecute_internal(void *dfeNative,
+                                           const void *inputTensor,
+                                           size_t inputTensorLength,
+                                           int startLayerNum, int endLayerNum,
+                                           const void **pOutputTensor,
+                                           size_t *pOutputTensorLength) {
+  return false;
+}
+
+char *ant_gateway_dfeNativeGetProfile_internal(void *dfeNative) {
+  return NULL;
+}
+
+#endif /* defined(ANT_GATEWAY_DFE_TFLITE) */
@@ -0,0 +1,49 @@
+/* Copyright (c) 2017-2021 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ANT_GATEWAY_DFE_NATIVE_INTERNAL_H__
+#define __ANT_GATEWAY_DFE_NATIVE_INTERNAL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Native DFE engine: fragments are executed by TFLite C API without Python.
+// It is available only if the library is built with ANT_GATEWAY_DFE_TFLITE.
+#define DFE_NATIVE_NUM_THREADS 4
+
+// Per-fragment latency profile
+#define DFE_PROFILE_WARMUPS 3
+#define DFE_PROFILE_SAMPLES 128
+#define DFE_PROFILE_JSON_ENTRY_LENGTH 160
+
+void dfe_native_destroy(void *dfeNative);
+
+// Returns NULL if native engine is not available or a fragment fails to load.
+void *ant_gateway_dfeNativeLoad_internal(const char *modelName,
+                                         int numFragments);
+
+// Output buffer is owned by the engine and valid until next execution.
+bool ant_gateway_dfeNativeExecute_internal(void *dfeNative,
+                                           const void *inputTensor,
+                                           size_t inputTensorLength,
+                                           int startLayerNum, int endLayerNum,
+                                           const void **pOutputTensor,
+                                           size_t *pOutputTensorLength);
+
+// Returns the profile table as a JSON array of {count, meanMS, p50MS, p90MS,
+// p99MS, outputBytes} per fragment. It must be freed by the caller.
+char *ant_gateway_dfeNativeGetProfile_internal(void *dfeNative);
+
+#endif /* !defined(__ANT_GATEWAY_DFE_NATIVE_INTERNAL_H__) */
@@ -14,6 +14,11 @@
 
 # DFE: DNN Fragment Engine
 
+import collections
+import json
+import math
+import time
+
 import tensorflow as tf
 import numpy as np
 
@@ -21,12 +26,61 @@ from keras.preprocessing import image
 from keras.applications import mobilenet
 
 
+# Per-fragment latency profile
+DFE_PROFILE_WARMUPS = 3
+DFE_PROFILE_SAMPLES = 128
+
+
+class FragmentProfile:
+    # Warm-up invocations are not counted, and percentiles are taken from
+    # the recent samples.
+    def __init__(self):
+        self.warmups = 0
+        self.count = 0
+        self.total_ms = 0.0
+        self.samples_ms = collections.deque(maxlen=DFE_PROFILE_SAMPLES)
+        self.output_bytes = 0
+
+    def add(self, latency_ms, output_bytes):
+        self.output_bytes = output_bytes
+        if self.warmups < DFE_PROFILE_WARMUPS:
+            self.warmups += 1
+            return
+        self.count += 1
+        self.total_ms += latency_ms
+        self.samples_ms.append(latency_ms)
+
+    def to_dict(self):
+        # Nearest-rank percentile
+        samples = sorted(self.samples_ms)
+
+        def percentile(percent):
+            rank = int(math.ceil(len(samples) * percent / 100.0))
+            return samples[rank - 1] if rank > 0 else 0.0
+
+        return {
+            'count': self.count,
+            'meanMS': self.total_ms / self.count if self.count > 0 else 0.0,
+            'p50MS': percentile(50),
+            'p90MS': percentile(90),
+            'p99MS': percentile(99),
+            'outputBytes': self.output_bytes
+        }
+
+
+class FragmentInterpreters(list):
+    # Interpreters of the fragments with their profiles
+    def __init__(self, interpreters):
+        list.__init__(self, interpreters)
+        self.profiles = [FragmentProfile() for i in range(len(interpreters))]
+
+
 def dfe_load_and_preprocess_image(img_path):
     img = image.load_img(img_path, target_size=(224, 224))
     img_array = image.img_to_array(img)
     img_array = np.expand_dims(img_array, axis=0)
     input_tensor = mobilenet.preprocess_input(img_array)
-    return input_tensor
+    return input_tensor.astype(np.float32).tobytes()
 
 
 def dfe_load(model_name, num_fragments):
@@ -42,16 +96,19 @@ def dfe_load(model_name, num_fragments):
             model_path=fragment_file, num_threads=4)
         interpreter.allocate_tensors()
         interpreters.append(interpreter)
-    return interpreters
+    return FragmentInterpreters(interpreters)
 
 
 def dfe_execute(interpreters, input_tensor, start_layer_num, end_layer_num):
-    # Input tensor conversion (bytes -> ndarray)
+    # Input tensor conversion (memoryview -> ndarray)
+    # It refers to the caller's buffer without copy, so it must not be kept
+    # after return.
     input_shape = interpreters[start_layer_num].get_input_details()[0]['shape']
     input_tensor = np.frombuffer(input_tensor, dtype=np.float32)
     input_tensor = input_tensor.reshape(input_shape)
 
-    prev_output_tensor = input_tensor.astype(np.float32)
+    profiles = getattr(interpreters, 'profiles', None)
+    prev_output_tensor = input_tensor
     for i in range(start_layer_num, end_layer_num + 1):
         interpreter = interpreters[i]
         # Get input and output tensors.
@@ -62,12 +119,23 @@ def dfe_execute(interpreters, input_tensor, start_layer_num, end_layer_num):
         interpreter.set_tensor(input_details[0]['index'], prev_output_tensor)
 
         # Run
+        start_time = time.perf_counter()
         interpreter.invoke()
+        latency_ms = (time.perf_counter() - start_time) * 1000.0
 
         # Get output tensor
         output_data = interpreter.get_tensor(output_details[0]['index'])
         prev_output_tensor = output_data
+        if profiles is not None:
+            profiles[i].add(latency_ms, output_data.nbytes)
 
     # Output tensor conversion (ndarray -> bytes)
     output_tensor = prev_output_tensor.tobytes()
     return output_tensor
+
+
+def dfe_get_profile(interpreters):
+    # Profile table: JSON array of {count, meanMS, p50MS, p90MS, p99MS,
+    # outputBytes} per fragment
+    profiles = getattr(interpreters, 'profiles', [])
+    return json.dumps([profile.to_dict() for profile in profiles])
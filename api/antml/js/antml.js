@@ -208,6 +208,8 @@ ANTML.prototype.createMLElement = function (
     outputNamesStr;
   tensorFilter.setProperty('custom', custom);
   tensorFilter.modelPath = modelPath;
+  // Tensor names of appsink in tensors mode (see Element.connectSignal())
+  tensorFilter.outputNames = [].concat(outputNames);
   return tensorFilter;
 };
 
@@ -218,7 +220,8 @@ ANTML.prototype.createMLFragmentElement = function (
   inputNames,
   taskName,
   numFragments,
-  targetUri
+  targetUri,
+  maxInFlightFrames
 ) {
   // Checking arguments
   if (modelPath.indexOf(' ') >= 0) {
@@ -267,6 +270,10 @@ ANTML.prototype.createMLFragmentElement = function (
     numFragments +
     ' ' +
     targetUri;
+  if (maxInFlightFrames !== undefined) {
+    // Pipelined offloading: heads of next frames run while tails are executed
+    custom += ' ' + maxInFlightFrames;
+  }
   tensorFilter.setProperty('custom', custom);
   tensorFilter.modelPath = modelPath;
   return tensorFilter;
@@ -26,12 +26,38 @@
 #include "../../common/native/ant_common.h"
 #include "./internal/ant_ml_internal.h"
 
+// Returns the data of a Buffer or a typed array (e.g. a tensor of appsink in
+// tensors mode), or NULL if the value is neither of them.
+static char *get_buffer_data(jerry_value_t value, size_t *buffer_len) {
+  if (jerry_value_is_typedarray(value)) {
+    jerry_length_t byte_offset, byte_length;
+    jerry_value_t array_buffer;
+    uint8_t *data;
+    array_buffer =
+        jerry_get_typedarray_buffer(value, &byte_offset, &byte_length);
+    data = jerry_get_arraybuffer_pointer(array_buffer);
+    jerry_release_value(array_buffer);
+    if (data == NULL) {
+      return NULL;
+    }
+    *buffer_len = (size_t)byte_length;
+    return (char *)data + byte_offset;
+  } else {
+    iotjs_bufferwrap_t *buffer_wrap = iotjs_jbuffer_get_bufferwrap_ptr(value);
+    if (buffer_wrap == NULL) {
+      return NULL;
+    }
+    *buffer_len = iotjs_bufferwrap_length(buffer_wrap);
+    return buffer_wrap->buffer;
+  }
+}
+
 JS_FUNCTION(ant_ml_getMaxOfBuffer) {
   jerry_value_t argBuffer;
   iotjs_string_t argType;
 
   const char *type;
-  iotjs_bufferwrap_t *buffer_wrap;
+  char *buffer_data;
   size_t buffer_len;
 
   DJS_CHECK_ARGS(2, object, string);
@@ -39,11 +65,11 @@ JS_FUNCTION(ant_ml_getMaxOfBuffer) {
   argType = JS_GET_ARG(1, string);
 
   type = iotjs_string_data(&argType);
-  buffer_wrap = iotjs_jbuffer_get_bufferwrap_ptr(argBuffer);
-  if (buffer_wrap == NULL) {
+  buffer_data = get_buffer_data(argBuffer, &buffer_len);
+  if (buffer_data == NULL) {
+    iotjs_string_destroy(&argType);
     return JS_CREATE_ERROR(TYPE, "Invalid buffer given");
   }
-  buffer_len = iotjs_bufferwrap_length(buffer_wrap);
 
   if (buffer_len <= 0) {
     fprintf(stderr, "Invalid buffer length!: %d\n", buffer_len);
@@ -52,7 +78,7 @@ JS_FUNCTION(ant_ml_getMaxOfBuffer) {
   }
 
   if (strncmp(type, "uint8", strlen("uint8")) == 0) {
-    unsigned char *data_array = (unsigned char *)buffer_wrap->buffer;
+    unsigned char *data_array = (unsigned char *)buffer_data;
     size_t data_len = buffer_len / sizeof(unsigned char);
     int result_max_index;
     unsigned char result_value;
@@ -69,7 +95,7 @@ JS_FUNCTION(ant_ml_getMaxOfBuffer) {
     iotjs_string_destroy(&argType);
     return ret;
   } else if (strncmp(type, "int32", strlen("int32")) == 0) {
-    int32_t *data_array = (int32_t *)buffer_wrap->buffer;
+    int32_t *data_array = (int32_t *)buffer_data;
     size_t data_len = buffer_len / sizeof(int32_t);
     int result_max_index;
     int32_t result_value;
@@ -86,7 +112,7 @@ JS_FUNCTION(ant_ml_getMaxOfBuffer) {
     iotjs_string_destroy(&argType);
     return ret;
   } else if (strncmp(type, "float32", strlen("float32")) == 0) {
-    float *data_array = (float *)buffer_wrap->buffer;
+    float *data_array = (float *)buffer_data;
     size_t data_len = buffer_len / sizeof(float);
     int result_max_index;
     float result_value;
@@ -115,11 +141,11 @@ JS_FUNCTION(ant_ml_toFloatArray) {
   DJS_CHECK_ARGS(1, object);
   argBuffer = JS_GET_ARG(0, object);
 
-  iotjs_bufferwrap_t *buffer_wrap;
-  buffer_wrap = iotjs_jbuffer_get_bufferwrap_ptr(argBuffer);
-
-  float *data_array = (float *)buffer_wrap->buffer;
-  size_t buffer_len = iotjs_bufferwrap_length(buffer_wrap);
+  size_t buffer_len;
+  float *data_array = (float *)get_buffer_data(argBuffer, &buffer_len);
+  if (data_array == NULL) {
+    return JS_CREATE_ERROR(TYPE, "Invalid buffer given");
+  }
   size_t data_array_len = buffer_len / sizeof(float);
 
   jerry_value_t retArray = jerry_create_object();
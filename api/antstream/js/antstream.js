@@ -21,48 +21,218 @@ var console = require('console');
 function ANTStream() {}
 ANTStream.prototype._mIsInitialized = false;
 ANTStream.prototype.pipelines = [];
+ANTStream.prototype._mNextCallId = 0;
+ANTStream.prototype._mPendingCalls = {};
 
-ANTStream.prototype.callDbusMethod = function (message) {
+// Stream thread RPC method ids
+// It should be matched with RPC_* in ant_stream_rpc.h.
+var RPC_METHOD = {
+  STREAMAPI_QUITMAINLOOP: 0,
+  STREAMAPI_CREATEPIPELINE: 1,
+  STREAMAPI_CREATEELEMENT: 2,
+  PIPELINE_BINADD: 3,
+  PIPELINE_SETSTATE: 4,
+  PIPELINE_UNREF: 5,
+  ELEMENT_SETPROPERTY: 6,
+  ELEMENT_SETCAPSPROPERTY: 7,
+  ELEMENT_LINK: 8,
+  STREAMAPI_BUILDPIPELINE: 9,
+  STREAMAPI_SETTRACING: 10,
+  STREAMAPI_GETTRACE: 11
+};
+ANTStream.prototype.RPC_METHOD = RPC_METHOD;
+
+// Operation codes of the pipeline description in buildPipeline()
+// It should be matched with BUILD_OP_* in ant_stream_native_internal.c.
+var BUILD_OP = {
+  ELEMENT: 0,
+  PROPERTY: 1,
+  CAPS: 2,
+  LINK: 3,
+  STATE: 4
+};
+
+// Overflow policies of appsink handler queues in Element.connectSignal()
+// It should be matched with bq_policy_t in bounded_queue.h.
+var OVERFLOW_POLICY = {
+  'drop-oldest': 0,
+  'drop-newest': 1,
+  block: 2,
+  coalesce: 3
+};
+var DEFAULT_QUEUE_SIZE = 4;
+
+// Context groups of pipelines
+// It should be matched with CONTEXT_GROUP_MAX in ant_stream_native_internal.c.
+var CONTEXT_GROUP_MAX = 16;
+// Returns -1 if the group is invalid.
+function getContextGroup(options) {
+  if (options === undefined || options.group === undefined) {
+    return 0;
+  }
+  var group = Number(options.group);
+  if (!(group >= 0 && group < CONTEXT_GROUP_MAX)) {
+    console.error('ERROR: Invalid context group: ' + options.group);
+    return -1;
+  }
+  return Math.floor(group);
+}
+
+// Bus message types
+// It should be matched with BUS_MESSAGE_* in ant_stream_native_internal.h.
+var BUS_MESSAGE = [
+  'error',
+  'warning',
+  'eos',
+  'qos',
+  'latency',
+  'buffering',
+  'state-changed'
+];
+
+// Make a message object from the values of a bus message:
+// <pipeline handle> <source name> <values of the type...>
+function createBusMessage(type, values) {
+  var message = { type: type, source: values[1] };
+  switch (type) {
+    case 'error':
+    case 'warning':
+      message.message = values[2];
+      message.debug = values[3];
+      break;
+    case 'qos':
+      message.live = values[2];
+      message.jitter = values[3]; // nanoseconds
+      message.proportion = values[4];
+      message.quality = values[5];
+      message.processed = values[6];
+      message.dropped = values[7];
+      break;
+    case 'buffering':
+      message.percent = values[2];
+      break;
+    case 'state-changed':
+      message.oldState = values[2];
+      message.newState = values[3];
+      message.pendingState = values[4];
+      break;
+  }
+  return message;
+}
+
+/**
+ * Call a stream thread method.
+ * @param {int} methodId the method id (ANTStream.RPC_METHOD)
+ * @param {array} args the arguments (boolean, number or string)
+ * @return {array} the result values, or undefined on failure
+ */
+ANTStream.prototype.callRpc = function (methodId, args) {
+  if (!this._mIsInitialized) {
+    console.error('ERROR: Stream API is not initialized');
+    return undefined;
+  }
+  return native.ant_stream_callRpc(methodId, args);
+};
+
+/**
+ * Call a stream thread method without waiting for its result.
+ * Several calls can be in flight at once on the shared D-Bus connection.
+ * @param {int} methodId the method id (ANTStream.RPC_METHOD)
+ * @param {array} args the arguments (boolean, number or string)
+ * @param {function} handler the handler called with the result values
+ * @return {boolean} whether the call is sent
+ */
+ANTStream.prototype.callRpcAsync = function (methodId, args, handler) {
   if (!this._mIsInitialized) {
     console.error('ERROR: Stream API is not initialized');
     return false;
   }
-  return native.ant_stream_callDbusMethod(message);
+  var callId = this._mNextCallId++;
+  this._mPendingCalls[callId] = handler;
+  var result = native.ant_stream_callRpcAsync(callId, methodId, args);
+  if (!result) {
+    delete this._mPendingCalls[callId];
+  }
+  return result;
 };
 
+// Returns the first result value of an RPC call
+function getRpcResult(results) {
+  if (results === undefined || results.length == 0) {
+    return undefined;
+  }
+  return results[0];
+}
+
 ANTStream.prototype.isInitialized = function () {
   return this._mIsInitialized;
 };
 
 ANTStream.prototype.initialize = function () {
+  var self = this;
   this._mIsInitialized = true;
+  native.ant_stream_setRpcResultHandler(function (callId, results) {
+    var handler = self._mPendingCalls[callId];
+    delete self._mPendingCalls[callId];
+    if (typeof handler === 'function') {
+      handler(results);
+    }
+  });
+  native.ant_stream_setBusMessageHandler(function (typeId, values) {
+    var type = BUS_MESSAGE[typeId];
+    for (var i = 0; i < self.pipelines.length; i++) {
+      if (self.pipelines[i]._elementIndex === values[0]) {
+        self.pipelines[i]._onBusMessage(createBusMessage(type, values));
+        return;
+      }
+    }
+  });
   native.ant_stream_initializeStream();
 };
 ANTStream.prototype.finalize = function () {
   var ANTStream = this;
   var quitMainLoop = function () {
-    var result = Boolean(ANTStream.callDbusMethod('streamapi_quitMainLoop'));
+    var result = Boolean(
+      getRpcResult(ANTStream.callRpc(RPC_METHOD.STREAMAPI_QUITMAINLOOP, []))
+    );
     if (result) {
       this._mIsInitialized = false;
     }
     return result;
   };
-  for (var i = 0; i < this.pipelines.length; i++) {
-    this.pipelines[i].setState(this.pipelines[i].STATE_NULL);
-    this.pipelines[i].unref();
-    this.pipelines.splice(i, 1);
+  // Pipeline.unref() removes the pipeline from this.pipelines
+  while (this.pipelines.length > 0) {
+    var pipeline = this.pipelines[0];
+    pipeline.setState(pipeline.STATE_NULL);
+    pipeline.unref();
   }
   console.log('quitMainLoop()');
   quitMainLoop();
+  native.ant_stream_closeDbusConnection();
   console.log('end');
 };
-ANTStream.prototype.createPipeline = function (pipelineName) {
+/**
+ * Create an empty pipeline.
+ * @param {string} pipelineName the name of the pipeline
+ * @param {object} options (optional)
+ * - group {int}: the context group that runs the pipeline (0 ~ 15).
+ *   Each group has its own main loop thread, so pipelines in different
+ *   groups do not block each other. Group 0 is the stream thread (default).
+ * @return {Pipeline} the pipeline
+ */
+ANTStream.prototype.createPipeline = function (pipelineName, options) {
   if (!this._mIsInitialized) {
     console.error('ERROR: Stream API is not initialized');
     return undefined;
   }
+  var group = getContextGroup(options);
+  if (group < 0) {
+    return undefined;
+  }
   var elementIndex = Number(
-    this.callDbusMethod('streamapi_createPipeline\n' + pipelineName)
+    getRpcResult(
+      this.callRpc(RPC_METHOD.STREAMAPI_CREATEPIPELINE, [pipelineName, group])
+    )
   );
   var pipeline = new Pipeline(pipelineName, elementIndex);
   this.pipelines.push(pipeline);
@@ -74,13 +244,173 @@ ANTStream.prototype.createElement = function (elementName) {
     return undefined;
   }
   var elementIndex = Number(
-    this.callDbusMethod('streamapi_createElement\n' + elementName)
+    getRpcResult(
+      this.callRpc(RPC_METHOD.STREAMAPI_CREATEELEMENT, [elementName])
+    )
   );
   // TODO: embedding Pipeline.bin_add()
   // console.log("Element: " + elementName + " / " + elementIndex);
   return new Element(elementName, elementIndex);
 };
 
+/**
+ * Build a whole pipeline with one stream thread RPC call.
+ * The description is applied atomically on the thread of its context group.
+ * @param {object} description the pipeline description
+ * - name {string}: the name of the pipeline
+ * - elements {array}: element descriptions; each one has
+ *   factory {string}, properties {object} and caps {object}
+ * - links {array}: [src, dest] pairs of indices in description.elements
+ * - state {int}: the target state of the pipeline (optional)
+ * - group {int}: the context group that runs the pipeline (optional).
+ *   See createPipeline().
+ * @return {Pipeline} the pipeline whose elements are in the order of
+ * description.elements, or undefined on failure
+ */
+ANTStream.prototype.buildPipeline = function (description) {
+  if (!this._mIsInitialized) {
+    console.error('ERROR: Stream API is not initialized');
+    return undefined;
+  }
+  var elementDescs = description.elements || [];
+  var links = description.links || [];
+  var group = getContextGroup(description);
+  if (group < 0) {
+    return undefined;
+  }
+  var args = [description.name, group];
+  for (var i = 0; i < elementDescs.length; i++) {
+    args.push(BUILD_OP.ELEMENT, elementDescs[i].factory);
+  }
+  for (var i = 0; i < elementDescs.length; i++) {
+    var properties = elementDescs[i].properties || {};
+    for (var key in properties) {
+      args.push(BUILD_OP.PROPERTY, i, key, properties[key]);
+    }
+    var caps = elementDescs[i].caps || {};
+    for (var key in caps) {
+      args.push(BUILD_OP.CAPS, i, key, caps[key]);
+    }
+  }
+  for (var i = 0; i < links.length; i++) {
+    args.push(BUILD_OP.LINK, links[i][0], links[i][1]);
+  }
+  if (typeof description.state === 'number') {
+    args.push(BUILD_OP.STATE, description.state);
+  }
+
+  var elementIndices = this.callRpc(RPC_METHOD.STREAMAPI_BUILDPIPELINE, args);
+  if (
+    elementIndices === undefined ||
+    elementIndices.length != elementDescs.length + 1
+  ) {
+    console.error('ERROR: Failed to build pipeline ' + description.name);
+    return undefined;
+  }
+  var pipeline = new Pipeline(description.name, elementIndices[0]);
+  for (var i = 0; i < elementDescs.length; i++) {
+    var element = new Element(elementDescs[i].factory, elementIndices[i + 1]);
+    var properties = elementDescs[i].properties || {};
+    for (var key in properties) {
+      element.properties[key] = properties[key];
+    }
+    var caps = elementDescs[i].caps || {};
+    for (var key in caps) {
+      element.properties[key] = caps[key];
+    }
+    pipeline.elements.push(element);
+  }
+  for (var i = 0; i < links.length; i++) {
+    var srcElement = pipeline.elements[links[i][0]];
+    var destElement = pipeline.elements[links[i][1]];
+    srcElement.sinkElement = destElement;
+    destElement.srcElement = srcElement;
+  }
+  this.pipelines.push(pipeline);
+  return pipeline;
+};
+
+/**
+ * Enable or disable the pipeline tracer on the stream thread.
+ * While it is enabled, pad probes record the processing time and queue level
+ * of every element. Disabling it discards the records.
+ * @param {boolean} isEnabled
+ * @return {boolean} true on success
+ */
+ANTStream.prototype.setTracing = function (isEnabled) {
+  if (!this._mIsInitialized) {
+    console.error('ERROR: Stream API is not initialized');
+    return false;
+  }
+  return Boolean(
+    getRpcResult(
+      this.callRpc(RPC_METHOD.STREAMAPI_SETTRACING, [Boolean(isEnabled)])
+    )
+  );
+};
+
+/**
+ * Get the trace of elements recorded by the pipeline tracer.
+ * Histogram bucket 0 counts value 0, and bucket i counts values in
+ * [2^(i-1), 2^i). The last bucket also counts larger values.
+ * @param {boolean} isReset if true, the records are reset after this call
+ * @return {array} traces of elements, or undefined on failure. Each one has
+ * - name {string}: the element name
+ * - buffers {int}: the number of buffers pushed by the element
+ * - dropped {int}: the number of dropped buffers reported by QoS messages
+ * - elapsedMS {number}: the time the records are taken for
+ * - fps {number}: buffers per second
+ * - procTimeHistogram {array}: histogram of processing time in microseconds
+ * - queueLevelHistogram {array}: histogram of the number of queued buffers
+ *   (only for queue-like elements)
+ */
+ANTStream.prototype.getTrace = function (isReset) {
+  if (!this._mIsInitialized) {
+    console.error('ERROR: Stream API is not initialized');
+    return undefined;
+  }
+  var results = this.callRpc(RPC_METHOD.STREAMAPI_GETTRACE, [
+    Boolean(isReset)
+  ]);
+  if (results === undefined || results.length < 1) {
+    return undefined;
+  }
+  var numBuckets = results[0];
+  var traces = [];
+  var i = 1;
+  while (i + 4 + numBuckets * 2 <= results.length) {
+    var trace = {
+      name: results[i],
+      buffers: results[i + 1],
+      dropped: results[i + 2],
+      elapsedMS: results[i + 3] / 1000
+    };
+    trace.fps =
+      trace.elapsedMS > 0 ? (trace.buffers * 1000) / trace.elapsedMS : 0;
+    i += 4;
+    trace.procTimeHistogram = results.slice(i, i + numBuckets);
+    i += numBuckets;
+    trace.queueLevelHistogram = results.slice(i, i + numBuckets);
+    i += numBuckets;
+    traces.push(trace);
+  }
+  return traces;
+};
+
+/**
+ * Get the metrics of the event channels from native threads to JS thread
+ * (RPC results and bus messages).
+ * @return {array} metrics of channels. Each one has
+ * - name {string}: the channel name
+ * - queueDepth, queueDepthMax {int}: the number of queued events
+ * - emitted, dropped, delivered {int}: the number of events
+ * - latencyAvgUs, latencyMaxUs {number}: time from emit to delivery
+ * - handlerTimeAvgUs, handlerTimeMaxUs {number}: time spent in the handler
+ */
+ANTStream.prototype.getEventMetrics = function () {
+  return native.ant_stream_getEventMetrics();
+};
+
 /**
  * Pipeline
  * @param {string} name the name of the pipeline
@@ -98,7 +428,51 @@ function Pipeline(name, elementIndex) {
   this.STATE_READY = 2;
   this.STATE_PAUSED = 3;
   this.STATE_PLAYING = 4;
+
+  this._mMessageHandlers = {};
 }
+
+/**
+ * Set a handler of bus messages of the pipeline.
+ * An error stops only this pipeline (its state becomes STATE_NULL).
+ * @param {string} type 'error', 'warning', 'eos', 'qos', 'latency',
+ * 'buffering' or 'state-changed'
+ * @param {function} handler handler(message) where message has type and
+ * source (element name), and the following by the type:
+ * - error, warning: message, debug
+ * - qos: live, jitter (ns), proportion, quality, processed, dropped
+ * - buffering: percent
+ * - state-changed: oldState, newState, pendingState
+ * If handler is undefined, the handler of the type is removed.
+ * @return {boolean} false if the type is invalid
+ */
+Pipeline.prototype.onMessage = function (type, handler) {
+  if (BUS_MESSAGE.indexOf(type) < 0) {
+    console.error('ERROR: Invalid bus message type: ' + type);
+    return false;
+  }
+  if (typeof handler === 'function') {
+    this._mMessageHandlers[type] = handler;
+  } else {
+    delete this._mMessageHandlers[type];
+  }
+  return true;
+};
+Pipeline.prototype._onBusMessage = function (message) {
+  var handler = this._mMessageHandlers[message.type];
+  if (handler !== undefined) {
+    handler(message);
+  } else if (message.type === 'error') {
+    console.error(
+      'ERROR: Pipeline ' +
+        this.name +
+        ' is stopped by ' +
+        message.source +
+        ': ' +
+        message.message
+    );
+  }
+};
 Pipeline.prototype.binAdd = function (elementOrElements) {
   var ANTStream = require('antstream');
   if (!ANTStream.isInitialized()) {
@@ -119,8 +493,11 @@ Pipeline.prototype.binAdd = function (elementOrElements) {
     var element = elementOrElements;
     this.elements.push(element);
     var result = Boolean(
-      ANTStream.callDbusMethod(
-        'pipeline_binAdd\n' + this._elementIndex + '\n' + element._elementIndex
+      getRpcResult(
+        ANTStream.callRpc(RPC_METHOD.PIPELINE_BINADD, [
+          this._elementIndex,
+          element._elementIndex
+        ])
       )
     );
     return result;
@@ -140,8 +517,11 @@ Pipeline.prototype.setState = function (state) {
     return false;
   }
   var result = Number(
-    ANTStream.callDbusMethod(
-      'pipeline_setState\n' + this._elementIndex + '\n' + state
+    getRpcResult(
+      ANTStream.callRpc(RPC_METHOD.PIPELINE_SETSTATE, [
+        this._elementIndex,
+        state
+      ])
     )
   );
   return result;
@@ -167,11 +547,22 @@ Pipeline.prototype.linkMany = function (elements) {
   }
   return true;
 };
+/**
+ * Release the pipeline and its elements.
+ * Their handles are invalidated, so the pipeline and its elements should not
+ * be used after this call.
+ */
 Pipeline.prototype.unref = function () {
   var ANTStream = require('antstream');
   var result = Boolean(
-    ANTStream.callDbusMethod('pipeline_unref\n' + this._elementIndex)
+    getRpcResult(
+      ANTStream.callRpc(RPC_METHOD.PIPELINE_UNREF, [this._elementIndex])
+    )
   );
+  var index = ANTStream.pipelines.indexOf(this);
+  if (index >= 0) {
+    ANTStream.pipelines.splice(index, 1);
+  }
   return result;
 };
 
@@ -205,26 +596,13 @@ Element.prototype.setProperty = function (key, value) {
     console.error('ERROR: Invalid value: ' + value);
     return false;
   }
-  var type;
-  if (typeof value === 'boolean') {
-    type = 0;
-  } else if (typeof value === 'string') {
-    type = 1;
-  } else if (value === parseInt(value, 10)) {
-    type = 2;
-  } else {
-    type = 3;
-  }
   var result = Boolean(
-    ANTStream.callDbusMethod(
-      'element_setProperty\n' +
-        this._elementIndex +
-        '\n' +
-        key +
-        '\n' +
-        type +
-        '\n' +
+    getRpcResult(
+      ANTStream.callRpc(RPC_METHOD.ELEMENT_SETPROPERTY, [
+        this._elementIndex,
+        key,
         value
+      ])
     )
   );
   this.properties[key] = value;
@@ -243,19 +621,41 @@ Element.prototype.setCapsProperty = function (key, value) {
     return false;
   }
   var result = Boolean(
-    ANTStream.callDbusMethod(
-      'element_setCapsProperty\n' +
-        this._elementIndex +
-        '\n' +
-        key +
-        '\n' +
+    getRpcResult(
+      ANTStream.callRpc(RPC_METHOD.ELEMENT_SETCAPSPROPERTY, [
+        this._elementIndex,
+        key,
         value
+      ])
     )
   );
   this.properties[key] = value;
   return result;
 };
-Element.prototype.connectSignal = function (detailedSignal, handler) {
+/**
+ * Connect a handler to a signal of the element (e.g. 'new-sample' of appsink).
+ * @param {string} detailedSignal the signal name
+ * @param {function} handler handler(elementName, buffer)
+ * @param {object} options (optional)
+ * - zeroCopy {boolean}: if true, buffer is a Uint8Array backed by the
+ *   appsink buffer memory instead of a copied Buffer. The memory is held
+ *   until the Uint8Array is garbage-collected, so the handler should not
+ *   keep it longer than needed.
+ * - queueSize {int}: the number of buffers waiting for the handler
+ *   (default: 4)
+ * - overflow {string}: what to do when the queue is full (default: coalesce)
+ *   'drop-oldest', 'drop-newest', 'block' (blocks the streaming thread up to
+ *   1 second) or 'coalesce' (only the latest buffer is kept)
+ * - tensors {boolean|array}: if given, the handler is called as
+ *   handler(elementName, frame, tensors) for NNStreamer tensor streams.
+ *   frame is a Uint8Array, and tensors is an array of
+ *   { name, type, dims, data } parsed from other/tensors caps, where data is
+ *   a typed array view over frame (e.g. Float32Array for 'float32'; int64
+ *   and uint64 are viewed as Uint8Array). tensors is undefined if the caps
+ *   are not tensors. An array gives the names of tensors whose names are not
+ *   in the caps.
+ */
+Element.prototype.connectSignal = function (detailedSignal, handler, options) {
   var ANTStream = require('antstream');
   if (!ANTStream.isInitialized()) {
     console.error('ERROR: Stream API is not initialized');
@@ -270,10 +670,27 @@ Element.prototype.connectSignal = function (detailedSignal, handler) {
     console.error('ERROR: Handler already exists for ' + detailedSignal);
     return false;
   }
+  options = options || {};
+  var overflow = options.overflow || 'coalesce';
+  if (OVERFLOW_POLICY[overflow] === undefined) {
+    console.error('ERROR: Invalid overflow policy: ' + overflow);
+    return false;
+  }
+  var queueSize = options.queueSize || DEFAULT_QUEUE_SIZE;
+  var tensorNames = undefined;
+  if (Array.isArray(options.tensors)) {
+    tensorNames = options.tensors.map(String);
+  } else if (options.tensors) {
+    tensorNames = [];
+  }
   var result = native.ant_stream_elementConnectSignal(
     this._elementIndex,
     detailedSignal,
-    handler
+    handler,
+    Boolean(options.zeroCopy),
+    queueSize,
+    OVERFLOW_POLICY[overflow],
+    tensorNames
   );
   if (result) {
     this.handlers[detailedSignal] = handler;
@@ -290,8 +707,11 @@ Element.prototype.link = function (destElement) {
   destElement.srcElement = this;
 
   var result = Boolean(
-    ANTStream.callDbusMethod(
-      'element_link\n' + this._elementIndex + '\n' + destElement._elementIndex
+    getRpcResult(
+      ANTStream.callRpc(RPC_METHOD.ELEMENT_LINK, [
+        this._elementIndex,
+        destElement._elementIndex
+      ])
     )
   );
   return result;
@@ -16,97 +16,667 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <iotjs_def.h>
 #include <iotjs_uv_request.h>
 #include <modules/iotjs_module_buffer.h>
 
 #include "../../common/native/ant_common.h"
+#include "../../common/native/internal/ant_async.h"
 #include "./internal/ant_stream_native_internal.h"
+#include "./internal/ant_stream_rpc.h"
+#include "./internal/bounded_queue.h"
 #include "./internal/ll.h"
 
 ANT_API_VOID_TO_VOID(ant_stream, initializeStream);
-ANT_API_STRING_TO_STRING(ant_stream, callDbusMethod);
-
-// TODO(RedCarrottt): add a function to reset g_uv_async (hardcoded now)
-// Async handler order: gstreamer signal -> ant async -> uv async -> js
-// uv async handler
-bool g_is_async_handler_set = false;
-uv_async_t g_uv_async;
-typedef struct async_handler_args async_handler_args_t;
-struct async_handler_args {
-  char *element_name;
-  unsigned char *buffer_data;
-  uint32_t buffer_size;
+ANT_API_VOID_TO_VOID(ant_stream, closeDbusConnection);
+
+// RPC message <-> JS values
+// JS arguments are encoded as typed RPC arguments: boolean, string,
+// integer (number that fits in int32) or double (other numbers).
+static bool rpc_writer_put_js_value(rpc_writer_t *writer,
+                                    jerry_value_t js_value) {
+  if (jerry_value_is_boolean(js_value)) {
+    rpc_writer_put_boolean(writer, jerry_get_boolean_value(js_value));
+  } else if (jerry_value_is_number(js_value)) {
+    double value = jerry_get_number_value(js_value);
+    if (value >= INT32_MIN && value <= INT32_MAX &&
+        value == (double)(int32_t)value) {
+      rpc_writer_put_integer(writer, (int32_t)value);
+    } else {
+      rpc_writer_put_double(writer, value);
+    }
+  } else if (jerry_value_is_string(js_value)) {
+    iotjs_string_t value = iotjs_jval_as_string(js_value);
+    rpc_writer_put_string(writer, iotjs_string_data(&value),
+                          (uint32_t)iotjs_string_size(&value));
+    iotjs_string_destroy(&value);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static uint8_t *make_rpc_request(int method_id, jerry_value_t js_args,
+                                 size_t *request_length) {
+  rpc_writer_t writer;
+  uint32_t i;
+  uint32_t js_args_length = jerry_get_array_length(js_args);
+  rpc_writer_init(&writer, (uint16_t)method_id);
+  for (i = 0; i < js_args_length; i++) {
+    jerry_value_t js_arg = jerry_get_property_by_index(js_args, i);
+    bool result = rpc_writer_put_js_value(&writer, js_arg);
+    jerry_release_value(js_arg);
+    if (!result) {
+      fprintf(stderr, "ERROR: Invalid RPC argument at %u\n", i);
+      rpc_writer_destroy(&writer);
+      return NULL;
+    }
+  }
+  return rpc_writer_finish(&writer, request_length);
+}
+
+static jerry_value_t create_js_rpc_values(rpc_message_t *msg) {
+  jerry_value_t js_values;
+  uint32_t i;
+  js_values = jerry_create_array(msg->argc);
+  for (i = 0; i < msg->argc; i++) {
+    jerry_value_t js_value;
+    switch (msg->args[i].type) {
+    case RPC_ARG_BOOLEAN:
+      js_value = jerry_create_boolean(RPC_ARG_BOOLEAN_VALUE(msg, i));
+      break;
+    case RPC_ARG_STRING:
+      js_value = jerry_create_string_sz_from_utf8(
+          (const jerry_char_t *)RPC_ARG_STRING_VALUE(msg, i),
+          (jerry_size_t)msg->args[i].value.string.length);
+      break;
+    case RPC_ARG_INTEGER:
+      js_value = jerry_create_number(RPC_ARG_INTEGER_VALUE(msg, i));
+      break;
+    case RPC_ARG_DOUBLE:
+    default:
+      js_value = jerry_create_number(RPC_ARG_DOUBLE_VALUE(msg, i));
+      break;
+    }
+    iotjs_jval_set_property_by_index(js_values, i, js_value);
+    jerry_release_value(js_value);
+  }
+  return js_values;
+}
+
+// Returns an array of the response values, or undefined on failure.
+static jerry_value_t create_js_rpc_response(const uint8_t *response,
+                                            size_t response_length) {
+  rpc_message_t msg;
+  jerry_value_t js_response;
+  if (rpc_message_parse(response, response_length, &msg) != RPC_OK) {
+    return jerry_create_undefined();
+  }
+  js_response = create_js_rpc_values(&msg);
+  rpc_message_destroy(&msg);
+  return js_response;
+}
+
+JS_FUNCTION(ant_stream_callRpc) {
+  int argMethodId;
+  jerry_value_t argArgs;
+  uint8_t *request, *response;
+  size_t request_length, response_length;
+  jerry_value_t js_response;
+  DJS_CHECK_ARGS(2, number, array);
+  argMethodId = JS_GET_ARG(0, number);
+  argArgs = JS_GET_ARG(1, array);
+
+  request = make_rpc_request(argMethodId, argArgs, &request_length);
+  if (request == NULL) {
+    return jerry_create_undefined();
+  }
+  if (!ant_stream_callRpc_internal(request, request_length, &response,
+                                   &response_length)) {
+    return jerry_create_undefined();
+  }
+  js_response = create_js_rpc_response(response, response_length);
+  free(response);
+  return js_response;
+}
+
+// Pipelined RPC result order: stream thread reply -> ant async
+// -> js result handler (matched by call id in JS)
+// A stream thread waits if the queue is full.
+#define RPC_RESULT_QUEUE_SIZE 1024
+bool g_is_rpc_result_handler_set = false;
+typedef struct rpc_result rpc_result_t;
+struct rpc_result {
+  int call_id;
+  uint8_t *response;
+  size_t response_length;
 };
-ll_t *g_async_args_ll;
-void async_handler_args_teardown(void *item) {
-  async_handler_args_t *args_item;
-  args_item = (async_handler_args_t *)item;
-  free(args_item->element_name);
-  free(args_item->buffer_data);
-  free(args_item);
+void rpc_result_teardown(void *item) {
+  rpc_result_t *result_item;
+  result_item = (rpc_result_t *)item;
+  free(result_item->response);
+  free(result_item);
 }
-// js async handler
-jerry_value_t g_js_async_handler;
+ANT_ASYNC_DECL_FUNCS(ant_stream_rpcResult, rpc_result_teardown)
 
-static void stream_elementConnectSignal_ant_async_handler(
-    const char *element_name, unsigned char *data, uint32_t data_size) {
+static void stream_callRpcAsync_ant_async_handler(int call_id,
+                                                  const uint8_t *response,
+                                                  size_t response_length) {
   // ant async handler -> call uv async handler
-  if (g_is_async_handler_set) {
-    async_handler_args_t *args =
-        (async_handler_args_t *)malloc(sizeof(async_handler_args_t));
-    args->element_name =
-        (char *)malloc(sizeof(char) * (strlen(element_name) + 1));
-    snprintf(args->element_name, (strlen(element_name) + 1), "%s",
-             element_name);
-    args->buffer_data =
-        (unsigned char *)malloc(sizeof(unsigned char) * data_size);
-    memcpy(args->buffer_data, data, data_size);
-    args->buffer_size = data_size;
-    ll_insert_last(g_async_args_ll, args);
+  rpc_result_t *result = (rpc_result_t *)malloc(sizeof(rpc_result_t));
+  if (result == NULL)
+    return;
+  result->call_id = call_id;
+  result->response = NULL;
+  result->response_length = response_length;
+  if (response != NULL) {
+    result->response = (uint8_t *)malloc(response_length);
+    memcpy(result->response, response, response_length);
+  }
+  int zero = 0;
+  EMIT_ANT_ASYNC_EVENT(ant_stream_rpcResult, zero, (void *)result, false);
+}
 
-    uv_async_send(&g_uv_async);
+ANT_UV_HANDLER_FUNCTION(ant_stream_rpcResult) {
+  // uv async handler -> call js handler
+  uint64_t drain_start_ns = START_ANT_ASYNC_DRAIN();
+  void *e;
+  while ((e = GET_NEXT_EVENT_FROM_ANT_ASYNC(ant_stream_rpcResult,
+                                            drain_start_ns)) != NULL) {
+    ant_async_event_t *event = (ant_async_event_t *)e;
+    rpc_result_t *result = (rpc_result_t *)event->data;
+    jerry_value_t js_arg_call_id = jerry_create_number(result->call_id);
+    jerry_value_t js_arg_response =
+        create_js_rpc_response(result->response, result->response_length);
+    {
+      jerry_value_t js_handler =
+          GET_JS_HANDLER_FROM_ANT_ASYNC(ant_stream_rpcResult, event->key);
+      jerry_value_t js_args[] = {js_arg_call_id, js_arg_response};
+      iotjs_invoke_callback(js_handler, jerry_create_undefined(), js_args, 2);
+    }
+    jerry_release_value(js_arg_call_id);
+    jerry_release_value(js_arg_response);
+
+    REMOVE_FIRST_EVENT_FROM_ANT_ASYNC(ant_stream_rpcResult);
   }
 }
 
-static void stream_elementConnectSignal_uv_handler(uv_async_t *handle) {
+JS_FUNCTION(ant_stream_setRpcResultHandler) {
+  jerry_value_t argHandler;
+  DJS_CHECK_ARGS(1, function);
+  argHandler = JS_GET_ARG(0, function);
+
+  int zero = 0;
+  g_is_rpc_result_handler_set =
+      REGISTER_JS_HANDLER(ant_stream_rpcResult, zero, argHandler);
+  return jerry_create_undefined();
+}
+
+JS_FUNCTION(ant_stream_callRpcAsync) {
+  int argCallId;
+  int argMethodId;
+  jerry_value_t argArgs;
+  uint8_t *request;
+  size_t request_length;
+  bool result;
+  DJS_CHECK_ARGS(3, number, number, array);
+  argCallId = JS_GET_ARG(0, number);
+  argMethodId = JS_GET_ARG(1, number);
+  argArgs = JS_GET_ARG(2, array);
+
+  if (!g_is_rpc_result_handler_set) {
+    fprintf(stderr, "ERROR: RPC result handler is not set!\n");
+    return jerry_create_boolean(false);
+  }
+
+  request = make_rpc_request(argMethodId, argArgs, &request_length);
+  if (request == NULL) {
+    return jerry_create_boolean(false);
+  }
+  result = ant_stream_callRpcAsync_internal(
+      argCallId, request, request_length,
+      stream_callRpcAsync_ant_async_handler);
+
+  return jerry_create_boolean(result);
+}
+
+// Bus message order: pipeline bus (stream thread) -> ant async
+// -> js bus message handler (dispatched to pipelines in JS)
+// Error, warning, EOS and state change messages are never dropped: the stream
+// thread waits for a free slot if the queue is full.
+// QoS, latency and buffering messages can come in bursts, so they are kept in
+// a separate bounded queue that drops the oldest ones, and the stream thread
+// never waits for JS thread to deliver them.
+#define BUS_MESSAGE_QUEUE_SIZE 256
+#define SHEDDABLE_BUS_MESSAGE_QUEUE_SIZE 64
+typedef struct {
+  uint8_t *message;
+  size_t message_length;
+} bus_message_t;
+static void bus_message_teardown(void *item) {
+  bus_message_t *bus_message = (bus_message_t *)item;
+  free(bus_message->message);
+  free(bus_message);
+}
+ANT_ASYNC_DECL_FUNCS(ant_stream_busMessage, bus_message_teardown)
+
+bq_t *g_sheddable_bus_messages = NULL;
+uv_async_t g_sheddable_bus_message_uv_async;
+
+static bool is_sheddable_bus_message(int message_type) {
+  switch (message_type) {
+  case BUS_MESSAGE_QOS:
+  case BUS_MESSAGE_LATENCY:
+  case BUS_MESSAGE_BUFFERING:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static void stream_busMessage_ant_async_handler(int message_type,
+                                                uint8_t *message,
+                                                size_t message_length) {
+  // ant async handler -> call uv async handler
+  bus_message_t *bus_message = (bus_message_t *)malloc(sizeof(bus_message_t));
+  if (bus_message == NULL) {
+    free(message);
+    return;
+  }
+  bus_message->message = message;
+  bus_message->message_length = message_length;
+  if (is_sheddable_bus_message(message_type)) {
+    // The oldest message is dropped if the queue is full
+    bq_push(g_sheddable_bus_messages, bus_message);
+    uv_async_send(&g_sheddable_bus_message_uv_async);
+    return;
+  }
+  int zero = 0;
+  EMIT_ANT_ASYNC_EVENT(ant_stream_busMessage, zero, (void *)bus_message,
+                       false);
+}
+
+static void call_js_bus_message_handler(bus_message_t *bus_message) {
+  rpc_message_t msg;
+  if (rpc_message_parse(bus_message->message, bus_message->message_length,
+                        &msg) != RPC_OK) {
+    return;
+  }
+  int zero = 0;
+  jerry_value_t js_handler =
+      GET_JS_HANDLER_FROM_ANT_ASYNC(ant_stream_busMessage, zero);
+  jerry_value_t js_args[2];
+  js_args[0] = jerry_create_number(msg.method_id);
+  js_args[1] = create_js_rpc_values(&msg);
+  iotjs_invoke_callback(js_handler, jerry_create_undefined(), js_args, 2);
+  jerry_release_value(js_args[0]);
+  jerry_release_value(js_args[1]);
+  rpc_message_destroy(&msg);
+}
+
+static void stream_sheddableBusMessage_uv_handler(uv_async_t *handle) {
+  // uv async handler -> call js handler
+  // Messages pushed during this loop are handled by the next wakeup
+  int num_messages = bq_length(g_sheddable_bus_messages);
+  while (num_messages-- > 0) {
+    bus_message_t *bus_message =
+        (bus_message_t *)bq_pop(g_sheddable_bus_messages);
+    if (bus_message == NULL)
+      break;
+    call_js_bus_message_handler(bus_message);
+    bus_message_teardown(bus_message);
+  }
+}
+
+ANT_UV_HANDLER_FUNCTION(ant_stream_busMessage) {
   // uv async handler -> call js handler
-  jerry_value_t js_arg_element_name;
-  jerry_value_t js_arg_buffer;
-  iotjs_bufferwrap_t *buffer_wrap;
-  async_handler_args_t *async_args;
-  int last_index;
-  last_index = g_async_args_ll->len - 1;
-  if (last_index < 0) {
+  uint64_t drain_start_ns = START_ANT_ASYNC_DRAIN();
+  void *e;
+  while ((e = GET_NEXT_EVENT_FROM_ANT_ASYNC(ant_stream_busMessage,
+                                            drain_start_ns)) != NULL) {
+    ant_async_event_t *event = (ant_async_event_t *)e;
+    call_js_bus_message_handler((bus_message_t *)event->data);
+    REMOVE_FIRST_EVENT_FROM_ANT_ASYNC(ant_stream_busMessage);
+  }
+}
+
+JS_FUNCTION(ant_stream_setBusMessageHandler) {
+  jerry_value_t argHandler;
+  DJS_CHECK_ARGS(1, function);
+  argHandler = JS_GET_ARG(0, function);
+
+  // Register uv async handler
+  if (g_sheddable_bus_messages == NULL) {
+    iotjs_environment_t *env = iotjs_environment_get();
+    uv_loop_t *loop = iotjs_environment_loop(env);
+    g_sheddable_bus_messages = bq_new(SHEDDABLE_BUS_MESSAGE_QUEUE_SIZE,
+                                      BQ_DROP_OLDEST, bus_message_teardown);
+    if (g_sheddable_bus_messages == NULL) {
+      fprintf(stderr, "ERROR: Failed to create bus message queue!\n");
+      return jerry_create_undefined();
+    }
+    uv_async_init(loop, &g_sheddable_bus_message_uv_async,
+                  stream_sheddableBusMessage_uv_handler);
+  }
+
+  int zero = 0;
+  REGISTER_JS_HANDLER(ant_stream_busMessage, zero, argHandler);
+  ant_stream_setBusMessageHandler_internal(
+      stream_busMessage_ant_async_handler);
+  return jerry_create_undefined();
+}
+
+// ANTStream.getEventMetrics()
+JS_FUNCTION(ant_stream_getEventMetrics) {
+  return create_js_ant_async_metrics("ant_stream_");
+}
+
+// Appsink handlers
+// Async handler order: gstreamer signal -> ant async -> bounded queue
+// -> uv async -> js
+// Each signal connection has its own JS handler and bounded queue, and the
+// queue enforces the overflow policy given by JS. Connections are touched
+// only on JS thread, except their queues.
+typedef struct {
+  unsigned char *data;
+  uint32_t size;
+  bool is_zero_copy;
+  ant_tensors_info_t *tensors_info; // tensors mode only
+} sample_t;
+static void sample_teardown(void *item) {
+  sample_t *sample = (sample_t *)item;
+  // data is NULL if it is handed over to JS
+  if (sample->data != NULL) {
+    if (sample->is_zero_copy) {
+      ant_stream_releaseFrame_internal(sample->data);
+    } else {
+      free(sample->data);
+    }
+  }
+  ant_tensors_info_unref(sample->tensors_info);
+  free(sample);
+}
+
+// JS values describing the tensors of a tensors info. They are made only
+// when the tensors info (i.e. caps) of the samples is changed.
+typedef struct {
+  ant_tensors_info_t *info;
+  jerry_value_t names[ANT_TENSORS_MAX];
+  jerry_value_t types[ANT_TENSORS_MAX];
+  jerry_value_t dims[ANT_TENSORS_MAX];
+} tensors_meta_t;
+
+typedef struct {
+  char *element_name;
+  jerry_value_t js_handler;
+  bool is_zero_copy;
+  bool is_tensors;
+  jerry_value_t js_tensor_names; // tensor names given by JS
+  tensors_meta_t tensors_meta;
+  bq_t *queue;
+} signal_connection_t;
+static void clear_tensors_meta(tensors_meta_t *meta) {
+  uint32_t i;
+  if (meta->info == NULL)
+    return;
+  for (i = 0; i < meta->info->num_tensors; i++) {
+    jerry_release_value(meta->names[i]);
+    jerry_release_value(meta->types[i]);
+    jerry_release_value(meta->dims[i]);
+  }
+  ant_tensors_info_unref(meta->info);
+  meta->info = NULL;
+}
+static void signal_connection_teardown(void *item) {
+  signal_connection_t *connection = (signal_connection_t *)item;
+  bq_delete(connection->queue);
+  clear_tensors_meta(&connection->tensors_meta);
+  jerry_release_value(connection->js_tensor_names);
+  jerry_release_value(connection->js_handler);
+  free(connection->element_name);
+  free(connection);
+}
+
+bool g_is_signal_uv_async_initialized = false;
+uv_async_t g_signal_uv_async;
+ll_t *g_signal_connections_ll;
+
+static void stream_elementConnectSignal_ant_async_handler(
+    void *user_data, unsigned char *data, uint32_t data_size,
+    ant_tensors_info_t *tensors_info) {
+  // ant async handler -> call uv async handler
+  signal_connection_t *connection = (signal_connection_t *)user_data;
+  sample_t *sample = (sample_t *)malloc(sizeof(sample_t));
+  if (sample == NULL) {
+    if (connection->is_zero_copy) {
+      ant_stream_releaseFrame_internal(data);
+    }
+    ant_tensors_info_unref(tensors_info);
     return;
   }
-  async_args = (async_handler_args_t *)ll_get_n(g_async_args_ll, last_index);
-  if (async_args == NULL) {
+  sample->is_zero_copy = connection->is_zero_copy;
+  sample->size = data_size;
+  sample->tensors_info = tensors_info;
+  if (connection->is_zero_copy) {
+    // The frame is handed over without copying
+    sample->data = data;
+  } else {
+    sample->data = (unsigned char *)malloc(sizeof(unsigned char) * data_size);
+    if (sample->data == NULL) {
+      ant_tensors_info_unref(tensors_info);
+      free(sample);
+      return;
+    }
+    memcpy(sample->data, data, data_size);
+  }
+
+  // It may block the streaming thread by the overflow policy
+  if (bq_push(connection->queue, sample)) {
+    uv_async_send(&g_signal_uv_async);
+  }
+}
+
+static void stream_elementConnectSignal_destroy(void *user_data) {
+  // The element is freed: the connection is removed by the uv async handler
+  // after its remaining samples are handled.
+  signal_connection_t *connection = (signal_connection_t *)user_data;
+  bq_close(connection->queue);
+  uv_async_send(&g_signal_uv_async);
+}
+
+// The frame is released when JS garbage-collects its ArrayBuffer.
+static void stream_frame_free_cb(void *native_p) {
+  ant_stream_releaseFrame_internal((unsigned char *)native_p);
+}
+
+static jerry_value_t create_js_sample(sample_t *sample) {
+  if (sample->is_zero_copy) {
+    jerry_value_t js_array_buffer;
+    jerry_value_t js_frame;
+    js_array_buffer = jerry_create_arraybuffer_external(
+        (jerry_length_t)sample->size, sample->data, stream_frame_free_cb);
+    sample->data = NULL;
+    js_frame = jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8,
+                                                       js_array_buffer);
+    jerry_release_value(js_array_buffer);
+    return js_frame;
+  } else {
+    jerry_value_t js_buffer;
+    iotjs_bufferwrap_t *buffer_wrap;
+    js_buffer = iotjs_bufferwrap_create_buffer((size_t)sample->size);
+    buffer_wrap = iotjs_bufferwrap_from_jbuffer(js_buffer);
+    iotjs_bufferwrap_copy(buffer_wrap, (const char *)sample->data,
+                          (size_t)sample->size);
+    return js_buffer;
+  }
+}
+
+// Tensors mode
+// A frame is delivered as a Uint8Array with an array of tensors:
+//   { name, type, dims, data }
+// where data is a typed array view over the frame. Copied frames are also
+// delivered as ArrayBuffers so that tensors can be viewed without copying.
+static const char *g_tensor_type_names[ANT_TENSOR_TYPE_COUNT] = {
+    "int32", "uint32", "int16",   "uint16", "int8",
+    "uint8", "float64", "float32", "int64",  "uint64"};
+// 64-bit integer tensors are viewed as bytes (no BigInt64Array)
+static const struct {
+  jerry_typedarray_type_t type;
+  uint32_t element_size;
+} g_tensor_views[ANT_TENSOR_TYPE_COUNT] = {
+    {JERRY_TYPEDARRAY_INT32, 4},   {JERRY_TYPEDARRAY_UINT32, 4},
+    {JERRY_TYPEDARRAY_INT16, 2},   {JERRY_TYPEDARRAY_UINT16, 2},
+    {JERRY_TYPEDARRAY_INT8, 1},    {JERRY_TYPEDARRAY_UINT8, 1},
+    {JERRY_TYPEDARRAY_FLOAT64, 8}, {JERRY_TYPEDARRAY_FLOAT32, 4},
+    {JERRY_TYPEDARRAY_UINT8, 1},   {JERRY_TYPEDARRAY_UINT8, 1}};
+
+static void update_tensors_meta(signal_connection_t *connection,
+                                ant_tensors_info_t *info) {
+  tensors_meta_t *meta = &connection->tensors_meta;
+  uint32_t i, j;
+  if (meta->info == info)
     return;
+  clear_tensors_meta(meta);
+  meta->info = ant_tensors_info_ref(info);
+  for (i = 0; i < info->num_tensors; i++) {
+    const ant_tensor_info_t *tensor = &info->tensors[i];
+    uint32_t rank = 0;
+    // Names of the caps take precedence over the names given by JS
+    if (tensor->name[0] != '\0') {
+      meta->names[i] = jerry_create_string((const jerry_char_t *)tensor->name);
+    } else if (i < jerry_get_array_length(connection->js_tensor_names)) {
+      meta->names[i] =
+          jerry_get_property_by_index(connection->js_tensor_names, i);
+    } else {
+      meta->names[i] = jerry_create_string((const jerry_char_t *)"");
+    }
+    meta->types[i] = jerry_create_string(
+        (const jerry_char_t *)g_tensor_type_names[tensor->type]);
+    while (rank < ANT_TENSOR_RANK_MAX && tensor->dims[rank] != 0) {
+      rank++;
+    }
+    meta->dims[i] = jerry_create_array(rank);
+    for (j = 0; j < rank; j++) {
+      jerry_value_t dim = jerry_create_number((double)tensor->dims[j]);
+      jerry_release_value(jerry_set_property_by_index(meta->dims[i], j, dim));
+      jerry_release_value(dim);
+    }
   }
+}
+
+static jerry_value_t create_js_tensor_view(jerry_value_t js_array_buffer,
+                                           const ant_tensor_info_t *tensor,
+                                           const unsigned char *data) {
+  jerry_value_t js_view_buffer;
+  jerry_value_t js_view;
+  uint32_t element_size = g_tensor_views[tensor->type].element_size;
+  uint32_t offset = tensor->offset;
+  if (offset % element_size == 0) {
+    js_view_buffer = jerry_acquire_value(js_array_buffer);
+  } else {
+    // Typed arrays should be aligned: copy the tensor
+    js_view_buffer = jerry_create_arraybuffer(tensor->size);
+    jerry_arraybuffer_write(js_view_buffer, 0, data + offset, tensor->size);
+    offset = 0;
+  }
+  js_view = jerry_create_typedarray_for_arraybuffer_sz(
+      g_tensor_views[tensor->type].type, js_view_buffer, offset,
+      tensor->size / element_size);
+  jerry_release_value(js_view_buffer);
+  return js_view;
+}
 
-  js_arg_element_name =
-      jerry_create_string((const jerry_char_t *)async_args->element_name);
-  js_arg_buffer =
-      iotjs_bufferwrap_create_buffer((size_t)async_args->buffer_size);
-  buffer_wrap = iotjs_bufferwrap_from_jbuffer(js_arg_buffer);
-  iotjs_bufferwrap_copy(buffer_wrap, (const char *)async_args->buffer_data,
-                        (size_t)async_args->buffer_size);
+// Returns the array of tensors, or undefined if the frame does not match
+// the tensors info.
+static jerry_value_t create_js_tensors(signal_connection_t *connection,
+                                       jerry_value_t js_array_buffer,
+                                       const unsigned char *data,
+                                       uint32_t size,
+                                       ant_tensors_info_t *info) {
+  tensors_meta_t *meta = &connection->tensors_meta;
+  const ant_tensor_info_t *last_tensor;
+  jerry_value_t js_tensors;
+  uint32_t i;
 
-  {
-    jerry_value_t js_args[] = {js_arg_element_name, js_arg_buffer};
-    iotjs_invoke_callback(g_js_async_handler, jerry_create_undefined(), js_args,
-                          2);
+  last_tensor = &info->tensors[info->num_tensors - 1];
+  if (last_tensor->offset + last_tensor->size != size) {
+    return jerry_create_undefined();
   }
-  jerry_release_value(js_arg_element_name);
-  jerry_release_value(js_arg_buffer);
+  update_tensors_meta(connection, info);
+  js_tensors = jerry_create_array(info->num_tensors);
+  for (i = 0; i < info->num_tensors; i++) {
+    jerry_value_t js_tensor = jerry_create_object();
+    jerry_value_t js_data =
+        create_js_tensor_view(js_array_buffer, &info->tensors[i], data);
+    iotjs_jval_set_property_jval(js_tensor, "name", meta->names[i]);
+    iotjs_jval_set_property_jval(js_tensor, "type", meta->types[i]);
+    iotjs_jval_set_property_jval(js_tensor, "dims", meta->dims[i]);
+    iotjs_jval_set_property_jval(js_tensor, "data", js_data);
+    jerry_release_value(js_data);
+    jerry_release_value(jerry_set_property_by_index(js_tensors, i, js_tensor));
+    jerry_release_value(js_tensor);
+  }
+  return js_tensors;
+}
+
+// js_args: element name, frame (Uint8Array) and tensors
+static void create_js_tensors_sample(signal_connection_t *connection,
+                                     sample_t *sample, jerry_value_t *js_args) {
+  jerry_value_t js_array_buffer;
+  unsigned char *data = sample->data;
+
+  // Both pooled frames and copied frames are released by releaseFrame
+  js_array_buffer = jerry_create_arraybuffer_external(
+      (jerry_length_t)sample->size, data, stream_frame_free_cb);
+  sample->data = NULL;
+  js_args[1] = jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8,
+                                                       js_array_buffer);
+  if (sample->tensors_info != NULL) {
+    js_args[2] = create_js_tensors(connection, js_array_buffer, data,
+                                   sample->size, sample->tensors_info);
+  } else {
+    js_args[2] = jerry_create_undefined();
+  }
+  jerry_release_value(js_array_buffer);
+}
+
+static void stream_elementConnectSignal_uv_handler(uv_async_t *handle) {
+  // uv async handler -> call js handler
+  int i = 0;
+  while (i < g_signal_connections_ll->len) {
+    signal_connection_t *connection =
+        (signal_connection_t *)ll_get_n(g_signal_connections_ll, i);
+    // Samples pushed during this loop are handled by the next wakeup
+    int num_samples = bq_length(connection->queue);
+    sample_t *sample;
+    while (num_samples-- > 0 &&
+           (sample = (sample_t *)bq_pop(connection->queue)) != NULL) {
+      jerry_value_t js_args[3];
+      int num_args = 2;
+      int j;
+      js_args[0] =
+          jerry_create_string((const jerry_char_t *)connection->element_name);
+      if (connection->is_tensors) {
+        create_js_tensors_sample(connection, sample, js_args);
+        num_args = 3;
+      } else {
+        js_args[1] = create_js_sample(sample);
+      }
+      iotjs_invoke_callback(connection->js_handler, jerry_create_undefined(),
+                            js_args, num_args);
+      for (j = 0; j < num_args; j++) {
+        jerry_release_value(js_args[j]);
+      }
+      sample_teardown(sample);
+    }
 
-  {
-    int i;
-    int ll_len = g_async_args_ll->len;
-    for (i = 0; i < ll_len - 1; i++) {
-      ll_remove_first(g_async_args_ll);
+    // Closed queue gets no more samples
+    if (bq_is_closed(connection->queue) && bq_length(connection->queue) == 0) {
+      ll_remove_n(g_signal_connections_ll, i);
+    } else {
+      i++;
     }
   }
 }
@@ -115,46 +685,94 @@ JS_FUNCTION(ant_stream_elementConnectSignal) {
   int argElementIndex;
   iotjs_string_t argDetailedSignal;
   jerry_value_t argHandler;
+  bool argIsZeroCopy;
+  int argQueueSize;
+  int argOverflowPolicy;
+  bool isTensors;
+  signal_connection_t *connection;
   bool result;
-  DJS_CHECK_ARGS(3, number, string, function);
+  DJS_CHECK_ARGS(6, number, string, function, boolean, number, number);
+  // Optional: tensor names array enables tensors mode
+  isTensors = (jargc > 6 && jerry_value_is_array(jargv[6]));
   argElementIndex = JS_GET_ARG(0, number);
   argDetailedSignal = JS_GET_ARG(1, string);
   argHandler = JS_GET_ARG(2, function);
+  argIsZeroCopy = JS_GET_ARG(3, boolean);
+  argQueueSize = JS_GET_ARG(4, number);
+  argOverflowPolicy = JS_GET_ARG(5, number);
 
-  if (g_is_async_handler_set) {
-    fprintf(stderr, "ERROR: JS handler already registered!"
-                    " (unique handler constraint)");
+  if (argOverflowPolicy < BQ_DROP_OLDEST || argOverflowPolicy > BQ_COALESCE) {
+    fprintf(stderr, "ERROR: Invalid overflow policy: %d\n", argOverflowPolicy);
+    iotjs_string_destroy(&argDetailedSignal);
     return jerry_create_boolean(false);
   }
-  g_is_async_handler_set = true;
-
-  // Register JS async handler
-  g_js_async_handler = argHandler;
 
   // Register uv async handler
-  // TODO(RedCarrottt): Hardcoding: unique handler
-  {
+  if (!g_is_signal_uv_async_initialized) {
     iotjs_environment_t *env = iotjs_environment_get();
     uv_loop_t *loop = iotjs_environment_loop(env);
-    g_async_args_ll = ll_new(async_handler_args_teardown);
-    uv_async_init(loop, &g_uv_async, stream_elementConnectSignal_uv_handler);
+    g_signal_connections_ll = ll_new(signal_connection_teardown);
+    uv_async_init(loop, &g_signal_uv_async,
+                  stream_elementConnectSignal_uv_handler);
+    g_is_signal_uv_async_initialized = true;
   }
 
-  // Register ant async handler to the stream thread
-  result = ant_stream_elementConnectSignal_internal(
-      argElementIndex, iotjs_string_data(&argDetailedSignal),
-      stream_elementConnectSignal_ant_async_handler);
+  connection = (signal_connection_t *)malloc(sizeof(signal_connection_t));
+  if (connection == NULL) {
+    iotjs_string_destroy(&argDetailedSignal);
+    return jerry_create_boolean(false);
+  }
+  connection->element_name =
+      ant_stream_getElementName_internal(argElementIndex);
+  connection->js_handler = jerry_acquire_value(argHandler);
+  connection->is_zero_copy = argIsZeroCopy;
+  connection->is_tensors = isTensors;
+  connection->js_tensor_names = isTensors ? jerry_acquire_value(jargv[6])
+                                          : jerry_create_array(0);
+  memset(&connection->tensors_meta, 0, sizeof(tensors_meta_t));
+  connection->queue = bq_new(argQueueSize, (bq_policy_t)argOverflowPolicy,
+                             sample_teardown);
+  if (connection->element_name == NULL || connection->queue == NULL) {
+    result = false;
+  } else {
+    // Register ant async handler to the stream thread
+    result = ant_stream_elementConnectSignal_internal(
+        argElementIndex, iotjs_string_data(&argDetailedSignal),
+        stream_elementConnectSignal_ant_async_handler,
+        stream_elementConnectSignal_destroy, connection, argIsZeroCopy,
+        isTensors);
+  }
   iotjs_string_destroy(&argDetailedSignal);
 
+  if (result) {
+    ll_insert_last(g_signal_connections_ll, connection);
+  } else {
+    if (connection->queue != NULL) {
+      bq_delete(connection->queue);
+    }
+    jerry_release_value(connection->js_tensor_names);
+    jerry_release_value(connection->js_handler);
+    free(connection->element_name);
+    free(connection);
+  }
   return jerry_create_boolean(result);
 }
 
 jerry_value_t InitANTStreamNative() {
   jerry_value_t antStreamNative = jerry_create_object();
   REGISTER_ANT_API(antStreamNative, ant_stream, initializeStream);
-  REGISTER_ANT_API(antStreamNative, ant_stream, callDbusMethod);
+  REGISTER_ANT_API(antStreamNative, ant_stream, callRpc);
+  REGISTER_ANT_API(antStreamNative, ant_stream, callRpcAsync);
+  REGISTER_ANT_API(antStreamNative, ant_stream, setRpcResultHandler);
+  REGISTER_ANT_API(antStreamNative, ant_stream, setBusMessageHandler);
+  REGISTER_ANT_API(antStreamNative, ant_stream, closeDbusConnection);
   REGISTER_ANT_API(antStreamNative, ant_stream, elementConnectSignal);
+  REGISTER_ANT_API(antStreamNative, ant_stream, getEventMetrics);
 
+  INIT_ANT_ASYNC_WITH_QUEUE_SIZE(ant_stream_rpcResult, rpc_result_teardown,
+                                 RPC_RESULT_QUEUE_SIZE);
+  INIT_ANT_ASYNC_WITH_QUEUE_SIZE(ant_stream_busMessage, bus_message_teardown,
+                                 BUS_MESSAGE_QUEUE_SIZE);
   initANTStream();
 
   return antStreamNative;
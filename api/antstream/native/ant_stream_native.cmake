@@ -2,6 +2,8 @@ get_filename_component(MODULE_DIR ${CMAKE_CURRENT_LIST_FILE} DIRECTORY)
 
 set(MODULE_NAME "antstream")
 
+include(${MODULE_DIR}/../../common/native/ant_common.cmake)
+
 add_subdirectory(${MODULE_DIR}/internal/ ${CMAKE_BINARY_DIR}/out/ant/)
 
 list(APPEND EXTERNAL_LIBS ant_stream_native)
\ No newline at end of file
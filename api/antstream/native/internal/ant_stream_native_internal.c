@@ -34,6 +34,8 @@
 #include "../../../common/native/ant_common.h"
 
 #include "./ant_stream_native_internal.h"
+#include "./ant_stream_rpc.h"
+#include "./ant_stream_tracer.h"
 
 #define ANT_STREAMTHREAD_DBUS_BUS "org.ant.streamThread"
 #define ANT_STREAMTHREAD_DBUS_PATH "/org/ant/streamThread"
@@ -55,8 +57,8 @@ static const gchar g_introspection_xml[] =
     "<node name='" ANT_STREAMTHREAD_DBUS_PATH "'>"
     "   <interface name='" ANT_STREAMTHREAD_DBUS_INTERFACE "'>"
     "     <method name='" ANT_STREAMTHREAD_DBUS_METHOD "'>"
-    "       <arg type='s' direction='in' />"
-    "       <arg type='s' direction='out' />"
+    "       <arg type='ay' direction='in' />"
+    "       <arg type='ay' direction='out' />"
     "     </method>"
     "   </interface>"
     "</node>";
@@ -69,329 +71,1036 @@ GDBusNodeInfo *g_gdbus_introspection;
 pthread_t g_stream_thread;
 GMainLoop *g_main_loop;
 
-// TODO(RedCarrottt): element registry: hard-coded size.
-// It should be changed to a registory of dynamic size.
-#define ELEMENT_REGISTRY_SIZE 100
-int g_element_registry_index = 0;
-GstElement *g_element_registry[ELEMENT_REGISTRY_SIZE] = {
-    0,
-};
-int registerElement(GstElement *element) {
-  if (g_element_registry_index >= (ELEMENT_REGISTRY_SIZE - 1)) {
+// Element registry
+// JS refers to elements with handles. A handle is a slot index tagged with
+// the generation of the slot, so the handle of a released element is
+// rejected even after its slot is reused by another element.
+// The slot table grows on demand, and released slots are kept in a FIFO free
+// list so that a slot is reused as late as possible.
+// The registry is accessed by both stream thread and JS thread.
+#define ELEMENT_HANDLE_INDEX_BITS 16
+#define ELEMENT_HANDLE_INDEX_MASK ((1 << ELEMENT_HANDLE_INDEX_BITS) - 1)
+#define ELEMENT_HANDLE_GENERATION_MASK 0x7FFF
+#define ELEMENT_REGISTRY_INITIAL_SIZE 64
+#define ELEMENT_REGISTRY_MAX_SIZE (ELEMENT_HANDLE_INDEX_MASK + 1)
+#define ELEMENT_SLOT_NONE -1
+typedef struct {
+  GstElement *element; // NULL if the slot is free
+  int generation;
+  int next_free;
+  int group; // context group that owns the element
+} element_slot_t;
+static element_slot_t *g_element_slots = NULL;
+static int g_element_slots_size = 0;
+static int g_element_free_head = ELEMENT_SLOT_NONE;
+static int g_element_free_tail = ELEMENT_SLOT_NONE;
+static GMutex g_element_registry_mutex;
+
+static bool grow_element_registry(void) {
+  int new_size, i;
+  element_slot_t *new_slots;
+  if (g_element_slots_size >= ELEMENT_REGISTRY_MAX_SIZE)
+    return false;
+  new_size = (g_element_slots_size == 0) ? ELEMENT_REGISTRY_INITIAL_SIZE
+                                         : g_element_slots_size * 2;
+  if (new_size > ELEMENT_REGISTRY_MAX_SIZE)
+    new_size = ELEMENT_REGISTRY_MAX_SIZE;
+  new_slots = (element_slot_t *)realloc(g_element_slots,
+                                        sizeof(element_slot_t) * new_size);
+  if (new_slots == NULL)
+    return false;
+
+  // New slots are appended to the free list
+  for (i = g_element_slots_size; i < new_size; i++) {
+    new_slots[i].element = NULL;
+    new_slots[i].generation = 0;
+    new_slots[i].next_free = (i + 1 < new_size) ? i + 1 : ELEMENT_SLOT_NONE;
+  }
+  if (g_element_free_tail == ELEMENT_SLOT_NONE) {
+    g_element_free_head = g_element_slots_size;
+  } else {
+    new_slots[g_element_free_tail].next_free = g_element_slots_size;
+  }
+  g_element_free_tail = new_size - 1;
+  g_element_slots = new_slots;
+  g_element_slots_size = new_size;
+  return true;
+}
+
+static element_slot_t *get_element_slot(int handle) {
+  int index = handle & ELEMENT_HANDLE_INDEX_MASK;
+  int generation = (handle >> ELEMENT_HANDLE_INDEX_BITS);
+  if (handle < 0 || index >= g_element_slots_size)
+    return NULL;
+  if (g_element_slots[index].element == NULL ||
+      g_element_slots[index].generation != generation)
+    return NULL;
+  return &g_element_slots[index];
+}
+
+static void release_element_slot(int index) {
+  element_slot_t *slot = &g_element_slots[index];
+  ant_stream_tracer_remove_element(slot->element);
+  slot->element = NULL;
+  slot->generation = (slot->generation + 1) & ELEMENT_HANDLE_GENERATION_MASK;
+  slot->next_free = ELEMENT_SLOT_NONE;
+  if (g_element_free_tail == ELEMENT_SLOT_NONE) {
+    g_element_free_head = index;
+  } else {
+    g_element_slots[g_element_free_tail].next_free = index;
+  }
+  g_element_free_tail = index;
+}
+
+// Returns the handle of the element, or -1 on failure.
+int registerElement(GstElement *element, int group) {
+  int index, handle;
+  if (element == NULL)
+    return -1;
+  g_mutex_lock(&g_element_registry_mutex);
+  if (g_element_free_head == ELEMENT_SLOT_NONE && !grow_element_registry()) {
+    g_mutex_unlock(&g_element_registry_mutex);
     g_printerr("Element registry is full! (max size: %d)\n",
-               ELEMENT_REGISTRY_SIZE);
+               ELEMENT_REGISTRY_MAX_SIZE);
     return -1;
-  } else {
-    int index = g_element_registry_index;
-    g_element_registry[index] = element;
-    g_element_registry_index++;
-    return index;
   }
+  index = g_element_free_head;
+  g_element_free_head = g_element_slots[index].next_free;
+  if (g_element_free_head == ELEMENT_SLOT_NONE) {
+    g_element_free_tail = ELEMENT_SLOT_NONE;
+  }
+  g_element_slots[index].element = element;
+  g_element_slots[index].group = group;
+  handle = (g_element_slots[index].generation << ELEMENT_HANDLE_INDEX_BITS) |
+           index;
+  ant_stream_tracer_add_element(element);
+  g_mutex_unlock(&g_element_registry_mutex);
+  return handle;
 }
-GstElement *getElement(int index) { return g_element_registry[index]; }
 
-// RPC functions
-// TODO(RedCarrottt): hardcoded args, argv length
-#define RPC_MAX_ARGC 10
-#define MAX_ARG_LENGTH 1000
-void rpc_streamapi_quitMainLoop(int argc, char argv[][MAX_ARG_LENGTH],
-                                char *responseMessage) {
-  // Input arguments
-  if (argc != 1) {
-    g_printerr("Invalid arguments!\n");
-    return;
+// Returns NULL if the handle is invalid or stale.
+GstElement *getElement(int handle) {
+  element_slot_t *slot;
+  GstElement *element;
+  g_mutex_lock(&g_element_registry_mutex);
+  slot = get_element_slot(handle);
+  element = (slot != NULL) ? slot->element : NULL;
+  g_mutex_unlock(&g_element_registry_mutex);
+  if (element == NULL) {
+    g_printerr("Invalid element handle: %d\n", handle);
+  }
+  return element;
+}
+
+// Returns the context group of the element, or 0 if the handle is invalid.
+int getElementGroup(int handle) {
+  element_slot_t *slot;
+  int group;
+  g_mutex_lock(&g_element_registry_mutex);
+  slot = get_element_slot(handle);
+  group = (slot != NULL) ? slot->group : 0;
+  g_mutex_unlock(&g_element_registry_mutex);
+  return group;
+}
+
+void setElementGroup(int handle, int group) {
+  element_slot_t *slot;
+  g_mutex_lock(&g_element_registry_mutex);
+  slot = get_element_slot(handle);
+  if (slot != NULL) {
+    slot->group = group;
+  }
+  g_mutex_unlock(&g_element_registry_mutex);
+}
+
+// Context groups
+// Pipelines can run on their own GMainContext threads. Group 0 is the stream
+// thread, and the other groups are launched on demand. Bus watches of a
+// pipeline are attached to the context of its group, and RPC calls on the
+// pipeline and its elements are routed to the context.
+// Context groups are launched and stopped only on stream thread.
+#define CONTEXT_GROUP_MAX 16
+typedef struct {
+  GThread *thread;
+  GMainContext *context;
+  GMainLoop *loop;
+} context_group_t;
+static context_group_t g_context_groups[CONTEXT_GROUP_MAX];
+
+static bool is_valid_context_group(int group) {
+  return (group >= 0 && group < CONTEXT_GROUP_MAX);
+}
+
+static gpointer context_group_thread_fn(gpointer data) {
+  // On Context Group Thread
+  context_group_t *context_group = (context_group_t *)data;
+  g_main_context_push_thread_default(context_group->context);
+  g_main_loop_run(context_group->loop);
+  g_main_context_pop_thread_default(context_group->context);
+  return NULL;
+}
+
+// Returns the context of the group, or NULL for stream thread.
+static GMainContext *get_context_group(int group) {
+  context_group_t *context_group;
+  if (group <= 0 || group >= CONTEXT_GROUP_MAX)
+    return NULL;
+  context_group = &g_context_groups[group];
+  if (context_group->thread == NULL) {
+    gchar *thread_name = g_strdup_printf("ant-stream-%d", group);
+    context_group->context = g_main_context_new();
+    context_group->loop = g_main_loop_new(context_group->context, FALSE);
+    context_group->thread =
+        g_thread_new(thread_name, context_group_thread_fn, context_group);
+    g_free(thread_name);
+  }
+  return context_group->context;
+}
+
+static void stop_context_groups(void) {
+  int i;
+  for (i = 1; i < CONTEXT_GROUP_MAX; i++) {
+    context_group_t *context_group = &g_context_groups[i];
+    if (context_group->thread == NULL)
+      continue;
+    g_main_loop_quit(context_group->loop);
+    g_thread_join(context_group->thread);
+    g_main_loop_unref(context_group->loop);
+    g_main_context_unref(context_group->context);
+    context_group->thread = NULL;
+  }
+}
+
+// Release the slot of the element. If the element is a bin, the slots of
+// its descendants are also released since they are freed with the bin.
+void unregisterElement(int handle) {
+  element_slot_t *slot;
+  GstElement *element;
+  int i;
+  g_mutex_lock(&g_element_registry_mutex);
+  slot = get_element_slot(handle);
+  if (slot != NULL) {
+    element = slot->element;
+    release_element_slot(handle & ELEMENT_HANDLE_INDEX_MASK);
+    if (GST_IS_BIN(element)) {
+      for (i = 0; i < g_element_slots_size; i++) {
+        if (g_element_slots[i].element != NULL &&
+            gst_object_has_as_ancestor(GST_OBJECT(g_element_slots[i].element),
+                                       GST_OBJECT(element))) {
+          release_element_slot(i);
+        }
+      }
+    }
   }
+  g_mutex_unlock(&g_element_registry_mutex);
+}
 
+// RPC functions
+// Arguments are already type-checked with the signature of g_rpc_methods.
+void rpc_streamapi_quitMainLoop(rpc_message_t *request,
+                                rpc_writer_t *response) {
   // Internal
+  stop_context_groups();
   g_main_loop_quit(g_main_loop);
 
   // Response message
-  snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "true");
+  rpc_writer_put_boolean(response, true);
+}
+
+// Bus messages
+// Messages of each pipeline are delivered to the bus message handler as
+// RPC-format messages (ant_stream_rpc.h). The method id is the message type
+// (BUS_MESSAGE_*), and the arguments are
+//   <pipeline handle> <source name> <values of the type...>
+// An error stops only the pipeline that produced it.
+static ant_stream_bus_message_handler g_bus_message_handler = NULL;
+#define PIPELINE_HANDLE_KEY "ant-pipeline-handle"
+
+void ant_stream_setBusMessageHandler_internal(
+    ant_stream_bus_message_handler handler) {
+  g_bus_message_handler = handler;
 }
 
-/* This function is called when an error message is posted on the bus */
-static void error_cb(GstBus *bus, GstMessage *msg, void *data) {
-  GError *err;
-  gchar *debug_info;
+// The handle is stored with an offset, since 0 is a valid handle.
+static void set_pipeline_handle(GstElement *pipeline, int handle) {
+  g_object_set_data(G_OBJECT(pipeline), PIPELINE_HANDLE_KEY,
+                    GINT_TO_POINTER(handle + 1));
+}
 
-  /* Print error details on the screen */
-  gst_message_parse_error(msg, &err, &debug_info);
-  g_printerr("Error received from element %s: %s\n", GST_OBJECT_NAME(msg->src),
-             err->message);
-  g_printerr("Debugging information: %s\n", debug_info ? debug_info : "none");
-  g_clear_error(&err);
-  g_free(debug_info);
+static int get_pipeline_handle(GstElement *pipeline) {
+  return GPOINTER_TO_INT(
+             g_object_get_data(G_OBJECT(pipeline), PIPELINE_HANDLE_KEY)) -
+         1;
+}
 
-  g_main_loop_quit(g_main_loop);
+static void put_bus_message_header(rpc_writer_t *writer, int type,
+                                   int pipeline_handle, const char *src_name) {
+  rpc_writer_init(writer, (uint16_t)type);
+  rpc_writer_put_integer(writer, pipeline_handle);
+  rpc_writer_put_string(writer, src_name, (uint32_t)strlen(src_name));
 }
 
-void rpc_streamapi_createPipeline(int argc, char argv[][MAX_ARG_LENGTH],
-                                  char *responseMessage) {
-  // On Stream Thread
-  GstElement *pipeline;
-  GstBus *bus;
-  int element_index;
-  const char *pipeline_name;
+static void put_string(rpc_writer_t *writer, const char *value) {
+  if (value == NULL)
+    value = "";
+  rpc_writer_put_string(writer, value, (uint32_t)strlen(value));
+}
 
-  // Input arguments
-  if (argc != 2) {
-    g_printerr("Invalid arguments!\n");
+static void bus_message_cb(GstBus *bus, GstMessage *msg, gpointer data) {
+  // On Context Group Thread
+  GstElement *pipeline = (GstElement *)data;
+  const gchar *src_name;
+  int pipeline_handle;
+  int message_type;
+  rpc_writer_t writer;
+  uint8_t *message;
+  size_t message_length;
+
+  pipeline_handle = get_pipeline_handle(pipeline);
+  src_name = (GST_MESSAGE_SRC(msg) != NULL) ? GST_MESSAGE_SRC_NAME(msg) : "";
+
+  switch (GST_MESSAGE_TYPE(msg)) {
+  case GST_MESSAGE_ERROR: {
+    GError *err;
+    gchar *debug_info;
+    gst_message_parse_error(msg, &err, &debug_info);
+    g_printerr("Error received from element %s: %s\n", src_name,
+               err->message);
+    g_printerr("Debugging information: %s\n", debug_info ? debug_info : "none");
+    // Stop only this pipeline
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+
+    message_type = BUS_MESSAGE_ERROR;
+    put_bus_message_header(&writer, message_type, pipeline_handle,
+                           src_name);
+    put_string(&writer, err->message);
+    put_string(&writer, debug_info);
+    g_clear_error(&err);
+    g_free(debug_info);
+    break;
+  }
+  case GST_MESSAGE_WARNING: {
+    GError *err;
+    gchar *debug_info;
+    gst_message_parse_warning(msg, &err, &debug_info);
+    message_type = BUS_MESSAGE_WARNING;
+    put_bus_message_header(&writer, message_type, pipeline_handle,
+                           src_name);
+    put_string(&writer, err->message);
+    put_string(&writer, debug_info);
+    g_clear_error(&err);
+    g_free(debug_info);
+    break;
+  }
+  case GST_MESSAGE_EOS:
+    message_type = BUS_MESSAGE_EOS;
+    put_bus_message_header(&writer, message_type, pipeline_handle,
+                           src_name);
+    break;
+  case GST_MESSAGE_QOS: {
+    gboolean live;
+    guint64 running_time, stream_time, timestamp, duration;
+    gint64 jitter;
+    gdouble proportion;
+    gint quality;
+    GstFormat format;
+    guint64 processed, dropped;
+    gst_message_parse_qos(msg, &live, &running_time, &stream_time, &timestamp,
+                          &duration);
+    gst_message_parse_qos_values(msg, &jitter, &proportion, &quality);
+    gst_message_parse_qos_stats(msg, &format, &processed, &dropped);
+    message_type = BUS_MESSAGE_QOS;
+    put_bus_message_header(&writer, message_type, pipeline_handle,
+                           src_name);
+    rpc_writer_put_boolean(&writer, live);
+    rpc_writer_put_double(&writer, (double)jitter);
+    rpc_writer_put_double(&writer, proportion);
+    rpc_writer_put_integer(&writer, quality);
+    // -1 if unknown
+    rpc_writer_put_double(&writer, (double)(gint64)processed);
+    rpc_writer_put_double(&writer, (double)(gint64)dropped);
+    break;
+  }
+  case GST_MESSAGE_LATENCY:
+    // The latency of the pipeline should be redistributed
+    gst_bin_recalculate_latency(GST_BIN(pipeline));
+    message_type = BUS_MESSAGE_LATENCY;
+    put_bus_message_header(&writer, message_type, pipeline_handle,
+                           src_name);
+    break;
+  case GST_MESSAGE_BUFFERING: {
+    gint percent;
+    gst_message_parse_buffering(msg, &percent);
+    message_type = BUS_MESSAGE_BUFFERING;
+    put_bus_message_header(&writer, message_type, pipeline_handle,
+                           src_name);
+    rpc_writer_put_integer(&writer, percent);
+    break;
+  }
+  case GST_MESSAGE_STATE_CHANGED: {
+    GstState old_state, new_state, pending_state;
+    // Only the state changes of the pipeline itself
+    if (GST_MESSAGE_SRC(msg) != GST_OBJECT(pipeline))
+      return;
+    gst_message_parse_state_changed(msg, &old_state, &new_state,
+                                    &pending_state);
+    message_type = BUS_MESSAGE_STATE_CHANGED;
+    put_bus_message_header(&writer, message_type, pipeline_handle,
+                           src_name);
+    rpc_writer_put_integer(&writer, (int)old_state);
+    rpc_writer_put_integer(&writer, (int)new_state);
+    rpc_writer_put_integer(&writer, (int)pending_state);
+    break;
+  }
+  default:
     return;
   }
-  pipeline_name = argv[1];
 
-  // Internal
+  message = rpc_writer_finish(&writer, &message_length);
+  if (message == NULL)
+    return;
+  if (g_bus_message_handler != NULL && pipeline_handle >= 0) {
+    // The handler takes the ownership of the message
+    g_bus_message_handler(message_type, message, message_length);
+  } else {
+    free(message);
+  }
+}
+
+static GstElement *create_pipeline(const char *pipeline_name) {
+  GstElement *pipeline;
+  GstBus *bus;
+
   pipeline = gst_pipeline_new(pipeline_name);
-  element_index = registerElement(pipeline);
 
   bus = gst_element_get_bus(pipeline);
   gst_bus_add_signal_watch(bus);
-  g_signal_connect(G_OBJECT(bus), "message::error", (GCallback)error_cb, NULL);
+  g_signal_connect(G_OBJECT(bus), "message", (GCallback)bus_message_cb,
+                   pipeline);
+  gst_object_unref(bus);
+
+  return pipeline;
+}
+
+static void destroy_pipeline(GstElement *pipeline) {
+  GstBus *bus;
+
+  // A pipeline must be in NULL state to be freed: it stops the streaming
+  // threads and releases the devices of its elements.
+  gst_element_set_state(pipeline, GST_STATE_NULL);
+
+  // Pending messages should not reach the freed pipeline
+  bus = gst_element_get_bus(pipeline);
+  g_signal_handlers_disconnect_by_func(bus, (gpointer)bus_message_cb,
+                                       pipeline);
+  gst_bus_set_flushing(bus, TRUE);
+  gst_bus_remove_signal_watch(bus);
   gst_object_unref(bus);
 
+  gst_object_unref(pipeline);
+}
+
+void rpc_streamapi_createPipeline(rpc_message_t *request,
+                                  rpc_writer_t *response) {
+  // On Context Group Thread
+  GstElement *pipeline;
+  int element_index;
+  const char *pipeline_name;
+  int group;
+
+  // Input arguments
+  pipeline_name = RPC_ARG_STRING_VALUE(request, 0);
+  group = RPC_ARG_INTEGER_VALUE(request, 1);
+
+  // Internal
+  if (!is_valid_context_group(group)) {
+    g_printerr("Invalid context group: %d\n", group);
+    rpc_writer_put_integer(response, -1);
+    return;
+  }
+  // The bus watch is attached to the context of this thread
+  pipeline = create_pipeline(pipeline_name);
+  element_index = registerElement(pipeline, group);
+  if (element_index < 0) {
+    destroy_pipeline(pipeline);
+  } else {
+    set_pipeline_handle(pipeline, element_index);
+  }
+
   // Response message
-  snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "%d", element_index);
+  rpc_writer_put_integer(response, element_index);
 }
 
-void rpc_streamapi_createElement(int argc, char argv[][MAX_ARG_LENGTH],
-                                 char *responseMessage) {
+void rpc_streamapi_createElement(rpc_message_t *request,
+                                 rpc_writer_t *response) {
   // On Stream Thread
   GstElement *element;
   int element_index;
   const char *element_name;
 
   // Input arguments
-  if (argc != 2) {
-    g_printerr("Invalid arguments!\n");
-    return;
-  }
-  element_name = argv[1];
+  element_name = RPC_ARG_STRING_VALUE(request, 0);
 
   // Internal
   element = gst_element_factory_make(element_name, NULL);
-  element_index = registerElement(element);
+  element_index = registerElement(element, 0);
+  if (element_index < 0 && element != NULL) {
+    gst_object_unref(element);
+  }
 
   // Response message
-  snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "%d", element_index);
+  rpc_writer_put_integer(response, element_index);
 }
 
-void rpc_pipeline_binAdd(int argc, char argv[][MAX_ARG_LENGTH],
-                         char *responseMessage) {
-  // On Stream Thread
+void rpc_pipeline_binAdd(rpc_message_t *request, rpc_writer_t *response) {
+  // On Context Group Thread
   GstElement *pipeline, *element;
-  int pipeline_element_index;
-  int element_index;
+  int pipeline_handle, element_handle;
   gboolean result;
 
   // Input arguments
-  if (argc != 3) {
-    g_printerr("Invalid arguments!\n");
-    return;
-  }
-  sscanf(argv[1], "%d", &pipeline_element_index);
-  sscanf(argv[2], "%d", &element_index);
-  pipeline = getElement(pipeline_element_index);
-  element = getElement(element_index);
+  pipeline_handle = RPC_ARG_INTEGER_VALUE(request, 0);
+  element_handle = RPC_ARG_INTEGER_VALUE(request, 1);
+  pipeline = getElement(pipeline_handle);
+  element = getElement(element_handle);
 
   // Internal
+  if (pipeline == NULL || element == NULL) {
+    rpc_writer_put_boolean(response, false);
+    return;
+  }
   result = gst_bin_add(GST_BIN(pipeline), element);
-
-  // Response message
   if (result) {
-    snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "true");
-  } else {
-    snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "false");
+    // The element is owned by the context group of the pipeline
+    setElementGroup(element_handle, getElementGroup(pipeline_handle));
   }
+
+  // Response message
+  rpc_writer_put_boolean(response, result);
 }
 
-void rpc_pipeline_setState(int argc, char argv[][MAX_ARG_LENGTH],
-                           char *responseMessage) {
-  // On Stream Thread
+void rpc_pipeline_setState(rpc_message_t *request, rpc_writer_t *response) {
+  // On Context Group Thread
   GstElement *pipeline;
-  int pipeline_element_index;
   int state;
   GstStateChangeReturn result;
 
   // Input arguments
-  if (argc != 3) {
-    g_printerr("Invalid arguments!\n");
-    return;
-  }
-  sscanf(argv[1], "%d", &pipeline_element_index);
-  sscanf(argv[2], "%d", &state);
-  pipeline = getElement(pipeline_element_index);
+  pipeline = getElement(RPC_ARG_INTEGER_VALUE(request, 0));
+  state = RPC_ARG_INTEGER_VALUE(request, 1);
 
   // Internal
+  if (pipeline == NULL) {
+    rpc_writer_put_integer(response, (int)GST_STATE_CHANGE_FAILURE);
+    return;
+  }
   result = gst_element_set_state(pipeline, state);
 
   // Response message
-  snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "%d", (int)result);
+  rpc_writer_put_integer(response, (int)result);
 }
 
-void rpc_pipeline_unref(int argc, char argv[][MAX_ARG_LENGTH],
-                        char *responseMessage) {
-  // On Stream Thread
+void rpc_pipeline_unref(rpc_message_t *request, rpc_writer_t *response) {
+  // On Context Group Thread
   GstElement *pipeline;
-  int pipeline_element_index;
+  int pipeline_handle;
 
   // Input arguments
-  if (argc != 2) {
-    g_printerr("Invalid arguments!\n");
+  pipeline_handle = RPC_ARG_INTEGER_VALUE(request, 0);
+  pipeline = getElement(pipeline_handle);
+
+  // Internal
+  if (pipeline == NULL) {
+    rpc_writer_put_boolean(response, false);
     return;
   }
-  sscanf(argv[1], "%d", &pipeline_element_index);
-  pipeline = getElement(pipeline_element_index);
+  unregisterElement(pipeline_handle);
+  destroy_pipeline(pipeline);
+
+  // Response message
+  rpc_writer_put_boolean(response, true);
+}
+
+static void set_element_property(GstElement *element, const char *key,
+                                 const rpc_arg_t *value) {
+  switch (value->type) {
+  case RPC_ARG_BOOLEAN:
+    g_object_set(G_OBJECT(element), key, (gboolean)value->value.boolean,
+                 NULL);
+    break;
+  case RPC_ARG_STRING:
+    g_object_set(G_OBJECT(element), key, value->value.string.data, NULL);
+    break;
+  case RPC_ARG_INTEGER:
+    g_object_set(G_OBJECT(element), key, (int)value->value.integer, NULL);
+    break;
+  case RPC_ARG_DOUBLE:
+    g_object_set(G_OBJECT(element), key, value->value.number, NULL);
+    break;
+  }
+}
+
+static void set_element_caps_property(GstElement *element, const char *key,
+                                      const char *value) {
+  GstCaps *caps;
+  caps = gst_caps_from_string(value);
+  g_object_set(G_OBJECT(element), key, caps, NULL);
+  gst_caps_unref(caps);
+}
+
+void rpc_element_setProperty(rpc_message_t *request, rpc_writer_t *response) {
+  // On Context Group Thread
+  GstElement *element;
+  const char *key;
+
+  // Input arguments
+  element = getElement(RPC_ARG_INTEGER_VALUE(request, 0));
+  key = RPC_ARG_STRING_VALUE(request, 1);
 
   // Internal
-  gst_object_unref(pipeline);
+  if (element == NULL) {
+    rpc_writer_put_boolean(response, false);
+    return;
+  }
+  set_element_property(element, key, &request->args[2]);
 
   // Response message
-  snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "true");
+  rpc_writer_put_boolean(response, true);
 }
 
-void rpc_element_setProperty(int argc, char argv[][MAX_ARG_LENGTH],
-                             char *responseMessage) {
-  // On Stream Thread
+void rpc_element_setCapsProperty(rpc_message_t *request,
+                                 rpc_writer_t *response) {
+  // On Context Group Thread
   GstElement *element;
-  int element_index;
   const char *key;
-  int type;
+  const char *value;
 
   // Input arguments
-  if (argc != 5) {
-    g_printerr("Invalid arguments!\n");
+  element = getElement(RPC_ARG_INTEGER_VALUE(request, 0));
+  key = RPC_ARG_STRING_VALUE(request, 1);
+  value = RPC_ARG_STRING_VALUE(request, 2);
+
+  // Internal
+  if (element == NULL) {
+    rpc_writer_put_boolean(response, false);
     return;
   }
-  sscanf(argv[1], "%d", &element_index);
-  key = argv[2];
-  sscanf(argv[3], "%d", &type);
-  element = getElement(element_index);
+  set_element_caps_property(element, key, value);
+
+  // Response message
+  rpc_writer_put_boolean(response, true);
+}
+
+void rpc_element_link(rpc_message_t *request, rpc_writer_t *response) {
+  // On Context Group Thread
+  GstElement *src_element, *dest_element;
+  gboolean result;
+
+  // Input arguments
+  src_element = getElement(RPC_ARG_INTEGER_VALUE(request, 0));
+  dest_element = getElement(RPC_ARG_INTEGER_VALUE(request, 1));
 
   // Internal
-  switch (type) {
-  case 0: {
-    // boolean
-    gboolean value_boolean;
-    if (strncmp(argv[4], "true", MAX_ARG_LENGTH) == 0) {
-      value_boolean = TRUE;
-    } else {
-      value_boolean = FALSE;
+  if (src_element == NULL || dest_element == NULL) {
+    rpc_writer_put_boolean(response, false);
+    return;
+  }
+  result = gst_element_link(src_element, dest_element);
+
+  // Response message
+  rpc_writer_put_boolean(response, result);
+}
+
+// Batched pipeline construction
+// A whole pipeline description is sent as one message: the pipeline name and
+// its context group followed by operations. Each operation is an operation
+// code and its arguments:
+//   BUILD_OP_ELEMENT  <factory name>
+//   BUILD_OP_PROPERTY <element no> <key> <value of any type>
+//   BUILD_OP_CAPS     <element no> <key> <caps string>
+//   BUILD_OP_LINK     <src element no> <dest element no>
+//   BUILD_OP_STATE    <state>
+// Element numbers are the orders of BUILD_OP_ELEMENT in the description.
+// The description is applied atomically: if any operation fails, the pipeline
+// is destroyed and nothing is registered.
+// Response: <pipeline index> <element index>... (or no values on failure)
+// It should be matched with BUILD_OP_* in antstream.js.
+#define BUILD_OP_ELEMENT 0
+#define BUILD_OP_PROPERTY 1
+#define BUILD_OP_CAPS 2
+#define BUILD_OP_LINK 3
+#define BUILD_OP_STATE 4
+static bool check_build_op_args(rpc_message_t *request, uint32_t arg_index,
+                                const char *signature) {
+  uint32_t i;
+  for (i = 0; signature[i] != '\0'; i++) {
+    const rpc_arg_t *arg;
+    if (arg_index + i >= request->argc)
+      return false;
+    arg = &request->args[arg_index + i];
+    if ((signature[i] == 's' && arg->type != RPC_ARG_STRING) ||
+        (signature[i] == 'i' && arg->type != RPC_ARG_INTEGER))
+      return false;
+  }
+  return true;
+}
+
+static GstElement *get_build_element(GPtrArray *elements, int element_no) {
+  if (element_no < 0 || element_no >= (int)elements->len)
+    return NULL;
+  return (GstElement *)g_ptr_array_index(elements, element_no);
+}
+
+static bool apply_build_op(rpc_message_t *request, uint32_t *arg_index,
+                           GstElement *pipeline, GPtrArray *elements,
+                           int *target_state) {
+  uint32_t i = *arg_index;
+  int op = RPC_ARG_INTEGER_VALUE(request, i);
+  switch (op) {
+  case BUILD_OP_ELEMENT: {
+    GstElement *element;
+    if (!check_build_op_args(request, i + 1, "s"))
+      return false;
+    element = gst_element_factory_make(RPC_ARG_STRING_VALUE(request, i + 1),
+                                       NULL);
+    *arg_index += 2;
+    if (element == NULL) {
+      g_printerr("Cannot create element: %s\n",
+                 RPC_ARG_STRING_VALUE(request, i + 1));
+      return false;
     }
-    g_object_set(G_OBJECT(element), key, value_boolean, NULL);
-    break;
+    if (!gst_bin_add(GST_BIN(pipeline), element)) {
+      gst_object_unref(element);
+      return false;
+    }
+    g_ptr_array_add(elements, element);
+    return true;
   }
-  case 1: {
-    // string
-    const char *value_string;
-    value_string = argv[4];
-    g_object_set(G_OBJECT(element), key, value_string, NULL);
-    break;
+  case BUILD_OP_PROPERTY: {
+    GstElement *element;
+    if (!check_build_op_args(request, i + 1, "is*"))
+      return false;
+    element =
+        get_build_element(elements, RPC_ARG_INTEGER_VALUE(request, i + 1));
+    *arg_index += 4;
+    if (element == NULL)
+      return false;
+    set_element_property(element, RPC_ARG_STRING_VALUE(request, i + 2),
+                         &request->args[i + 3]);
+    return true;
   }
-  case 2: {
-    // integer
-    int value_integer;
-    sscanf(argv[4], "%d", &value_integer);
-    g_object_set(G_OBJECT(element), key, value_integer, NULL);
-    break;
+  case BUILD_OP_CAPS: {
+    GstElement *element;
+    if (!check_build_op_args(request, i + 1, "iss"))
+      return false;
+    element =
+        get_build_element(elements, RPC_ARG_INTEGER_VALUE(request, i + 1));
+    *arg_index += 4;
+    if (element == NULL)
+      return false;
+    set_element_caps_property(element, RPC_ARG_STRING_VALUE(request, i + 2),
+                              RPC_ARG_STRING_VALUE(request, i + 3));
+    return true;
   }
-  case 3: {
-    // float
-    float value_float;
-    sscanf(argv[4], "%f", &value_float);
-    g_object_set(G_OBJECT(element), key, value_float, NULL);
-    break;
+  case BUILD_OP_LINK: {
+    GstElement *src_element, *dest_element;
+    if (!check_build_op_args(request, i + 1, "ii"))
+      return false;
+    src_element =
+        get_build_element(elements, RPC_ARG_INTEGER_VALUE(request, i + 1));
+    dest_element =
+        get_build_element(elements, RPC_ARG_INTEGER_VALUE(request, i + 2));
+    *arg_index += 3;
+    if (src_element == NULL || dest_element == NULL)
+      return false;
+    return gst_element_link(src_element, dest_element);
   }
+  case BUILD_OP_STATE:
+    if (!check_build_op_args(request, i + 1, "i"))
+      return false;
+    *target_state = RPC_ARG_INTEGER_VALUE(request, i + 1);
+    *arg_index += 2;
+    return true;
+  default:
+    g_printerr("Invalid pipeline description: operation %d\n", op);
+    return false;
   }
+}
 
-  // Response message
-  snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "true");
+void rpc_streamapi_buildPipeline(rpc_message_t *request,
+                                 rpc_writer_t *response) {
+  // On Context Group Thread
+  GstElement *pipeline;
+  GPtrArray *elements;
+  int target_state = GST_STATE_VOID_PENDING;
+  bool result = true;
+  uint32_t arg_index;
+  int pipeline_handle;
+  int group;
+  GArray *handles;
+  guint i;
+
+  group = RPC_ARG_INTEGER_VALUE(request, 1);
+  if (!is_valid_context_group(group)) {
+    g_printerr("Invalid context group: %d\n", group);
+    return;
+  }
+  // The bus watch is attached to the context of this thread
+  pipeline = create_pipeline(RPC_ARG_STRING_VALUE(request, 0));
+  elements = g_ptr_array_new();
+
+  arg_index = 2;
+  while (arg_index < request->argc && result) {
+    if (request->args[arg_index].type != RPC_ARG_INTEGER) {
+      result = false;
+      break;
+    }
+    result = apply_build_op(request, &arg_index, pipeline, elements,
+                            &target_state);
+  }
+
+  if (result && target_state != GST_STATE_VOID_PENDING) {
+    result = (gst_element_set_state(pipeline, target_state) !=
+              GST_STATE_CHANGE_FAILURE);
+  }
+
+  // Register the pipeline and its elements
+  if (result) {
+    pipeline_handle = registerElement(pipeline, group);
+    result = (pipeline_handle >= 0);
+  }
+  if (result) {
+    set_pipeline_handle(pipeline, pipeline_handle);
+  }
+  if (result) {
+    handles = g_array_sized_new(FALSE, FALSE, sizeof(int), elements->len);
+    for (i = 0; i < elements->len && result; i++) {
+      int handle = registerElement(g_ptr_array_index(elements, i), group);
+      g_array_append_val(handles, handle);
+      result = (handle >= 0);
+    }
+    if (result) {
+      rpc_writer_put_integer(response, pipeline_handle);
+      for (i = 0; i < handles->len; i++) {
+        rpc_writer_put_integer(response, g_array_index(handles, int, i));
+      }
+    } else {
+      // The elements are released with the pipeline
+      unregisterElement(pipeline_handle);
+    }
+    g_array_free(handles, TRUE);
+  }
+
+  if (!result) {
+    // Roll back: unreferencing the pipeline also frees its elements
+    destroy_pipeline(pipeline);
+  }
+  g_ptr_array_free(elements, TRUE);
 }
 
-void rpc_element_setCapsProperty(int argc, char argv[][MAX_ARG_LENGTH],
-                                 char *responseMessage) {
+// Pipeline tracer
+void rpc_streamapi_setTracing(rpc_message_t *request, rpc_writer_t *response) {
   // On Stream Thread
-  GstCaps *caps;
-  GstElement *element;
-  int element_index;
-  const char *key;
-  const char *value;
+  bool is_enabled;
+  int i;
 
   // Input arguments
-  if (argc != 4) {
-    g_printerr("Invalid arguments!\n");
-    return;
+  is_enabled = RPC_ARG_BOOLEAN_VALUE(request, 0);
+
+  // Internal: trace the elements already registered
+  g_mutex_lock(&g_element_registry_mutex);
+  ant_stream_tracer_set_enabled(is_enabled);
+  if (is_enabled) {
+    for (i = 0; i < g_element_slots_size; i++) {
+      if (g_element_slots[i].element != NULL) {
+        ant_stream_tracer_add_element(g_element_slots[i].element);
+      }
+    }
   }
-  sscanf(argv[1], "%d", &element_index);
-  key = argv[2];
-  value = argv[3];
-  element = getElement(element_index);
-
-  // Internal
-  caps = gst_caps_from_string(value);
-  g_object_set(G_OBJECT(element), key, caps, NULL);
-  gst_caps_unref(caps);
+  g_mutex_unlock(&g_element_registry_mutex);
 
   // Response message
-  snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "true");
+  rpc_writer_put_boolean(response, true);
 }
 
-void rpc_element_link(int argc, char argv[][MAX_ARG_LENGTH],
-                      char *responseMessage) {
+void rpc_streamapi_getTrace(rpc_message_t *request, rpc_writer_t *response) {
   // On Stream Thread
-  GstElement *src_element, *dest_element;
-  int src_element_index;
-  int dest_element_index;
-  gboolean result;
+  bool is_reset;
 
   // Input arguments
-  if (argc != 3) {
-    g_printerr("Invalid arguments!\n");
-    return;
+  is_reset = RPC_ARG_BOOLEAN_VALUE(request, 0);
+
+  // Response message
+  ant_stream_tracer_write_report(response, is_reset);
+}
+
+// RPC dispatch table keyed by method id
+// Each method is routed to the context group thread that owns its target:
+//   RPC_ROUTE_STREAM_THREAD: always on stream thread
+//   RPC_ROUTE_GROUP_ARG:     the group given as argument 1
+//   RPC_ROUTE_ELEMENT_ARG:   the group of the element given as argument 0
+typedef enum {
+  RPC_ROUTE_STREAM_THREAD = 0,
+  RPC_ROUTE_GROUP_ARG = 1,
+  RPC_ROUTE_ELEMENT_ARG = 2
+} rpc_route_t;
+typedef void (*rpc_method_fn)(rpc_message_t *, rpc_writer_t *);
+typedef struct {
+  rpc_method_fn fn;
+  const char *signature; // see rpc_message_check_signature()
+  const char *name;
+  rpc_route_t route;
+} rpc_method_t;
+static const rpc_method_t g_rpc_methods[RPC_METHOD_COUNT] = {
+    [RPC_STREAMAPI_QUITMAINLOOP] = {rpc_streamapi_quitMainLoop, "",
+                                    "streamapi_quitMainLoop",
+                                    RPC_ROUTE_STREAM_THREAD},
+    [RPC_STREAMAPI_CREATEPIPELINE] = {rpc_streamapi_createPipeline, "si",
+                                      "streamapi_createPipeline",
+                                      RPC_ROUTE_GROUP_ARG},
+    [RPC_STREAMAPI_CREATEELEMENT] = {rpc_streamapi_createElement, "s",
+                                     "streamapi_createElement",
+                                     RPC_ROUTE_STREAM_THREAD},
+    [RPC_PIPELINE_BINADD] = {rpc_pipeline_binAdd, "ii", "pipeline_binAdd",
+                             RPC_ROUTE_ELEMENT_ARG},
+    [RPC_PIPELINE_SETSTATE] = {rpc_pipeline_setState, "ii",
+                               "pipeline_setState", RPC_ROUTE_ELEMENT_ARG},
+    [RPC_PIPELINE_UNREF] = {rpc_pipeline_unref, "i", "pipeline_unref",
+                            RPC_ROUTE_ELEMENT_ARG},
+    [RPC_ELEMENT_SETPROPERTY] = {rpc_element_setProperty, "is*",
+                                 "element_setProperty", RPC_ROUTE_ELEMENT_ARG},
+    [RPC_ELEMENT_SETCAPSPROPERTY] = {rpc_element_setCapsProperty, "iss",
+                                     "element_setCapsProperty",
+                                     RPC_ROUTE_ELEMENT_ARG},
+    [RPC_ELEMENT_LINK] = {rpc_element_link, "ii", "element_link",
+                          RPC_ROUTE_ELEMENT_ARG},
+    [RPC_STREAMAPI_BUILDPIPELINE] = {rpc_streamapi_buildPipeline, "si+",
+                                     "streamapi_buildPipeline",
+                                     RPC_ROUTE_GROUP_ARG},
+    [RPC_STREAMAPI_SETTRACING] = {rpc_streamapi_setTracing, "b",
+                                  "streamapi_setTracing",
+                                  RPC_ROUTE_STREAM_THREAD},
+    [RPC_STREAMAPI_GETTRACE] = {rpc_streamapi_getTrace, "b",
+                                "streamapi_getTrace", RPC_ROUTE_STREAM_THREAD},
+};
+
+// Returns the method of the request, or NULL if the request is invalid.
+static const rpc_method_t *get_rpc_method(rpc_message_t *request) {
+  const rpc_method_t *method;
+  if (request->method_id >= RPC_METHOD_COUNT) {
+    g_printerr("Invalid method call!: %d\n", (int)request->method_id);
+    return NULL;
   }
-  sscanf(argv[1], "%d", &src_element_index);
-  sscanf(argv[2], "%d", &dest_element_index);
-  src_element = getElement(src_element_index);
-  dest_element = getElement(dest_element_index);
+  method = &g_rpc_methods[request->method_id];
+  if (!rpc_message_check_signature(request, method->signature)) {
+    g_printerr("Invalid arguments! (%s)\n", method->name);
+    return NULL;
+  }
+  return method;
+}
 
-  // Internal
-  result = gst_element_link(src_element, dest_element);
+void handle_method_call_internal(rpc_message_t *request,
+                                 rpc_writer_t *response) {
+  const rpc_method_t *method = get_rpc_method(request);
+  if (method != NULL) {
+    method->fn(request, response);
+  }
+}
 
-  // Response message
-  if (result) {
-    snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "true");
-  } else {
-    snprintf(responseMessage, MAX_RESULT_MESSAGE_LENGTH, "false");
+// Returns the context group that should run the request.
+static int get_rpc_context_group(rpc_message_t *request) {
+  const rpc_method_t *method = get_rpc_method(request);
+  if (method == NULL)
+    return 0;
+  switch (method->route) {
+  case RPC_ROUTE_GROUP_ARG:
+    return RPC_ARG_INTEGER_VALUE(request, 1);
+  case RPC_ROUTE_ELEMENT_ARG:
+    return getElementGroup(RPC_ARG_INTEGER_VALUE(request, 0));
+  default:
+    return 0;
   }
 }
 
-void handle_method_call_internal(int argc, char argv[][MAX_ARG_LENGTH],
-                                 char *responseMessage) {
-  if (argc == 0) {
-    g_printerr("Empty arguments!\n");
-    return;
+// RPC call
+// The request is parsed once on the stream thread to find its context group,
+// and the parsed message is run on that thread. Strings of the message point
+// into request_variant, so the call keeps a reference to it.
+// A call dropped without being run (e.g. its context group is stopped) is
+// answered with an error when it is destroyed, so that the caller does not
+// wait forever.
+typedef struct {
+  GVariant *request_variant;
+  rpc_message_t request;
+  int parse_result;
+  GDBusMethodInvocation *invocation;
+  bool is_answered;
+} rpc_call_t;
+
+static rpc_call_t *create_rpc_call(GVariant *parameters,
+                                   GDBusMethodInvocation *invocation) {
+  rpc_call_t *call = g_new(rpc_call_t, 1);
+  const uint8_t *request_data;
+  gsize request_length;
+
+  // Parsing arguments: strings are not copied out of the message
+  call->request_variant = g_variant_get_child_value(parameters, 0);
+  request_data = (const uint8_t *)g_variant_get_fixed_array(
+      call->request_variant, &request_length, sizeof(uint8_t));
+  call->parse_result =
+      rpc_message_parse(request_data, (size_t)request_length, &call->request);
+  call->invocation = g_object_ref(invocation);
+  call->is_answered = false;
+  return call;
+}
+
+static void destroy_rpc_call(gpointer data) {
+  rpc_call_t *call = (rpc_call_t *)data;
+  if (!call->is_answered) {
+    g_dbus_method_invocation_return_error_literal(
+        call->invocation, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+        "RPC call is cancelled");
   }
-  if (strncmp(argv[0], "streamapi_quitMainLoop", MAX_ARG_LENGTH) == 0) {
-    rpc_streamapi_quitMainLoop(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "streamapi_createPipeline", MAX_ARG_LENGTH) ==
-             0) {
-    rpc_streamapi_createPipeline(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "streamapi_createElement", MAX_ARG_LENGTH) == 0) {
-    rpc_streamapi_createElement(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "pipeline_binAdd", MAX_ARG_LENGTH) == 0) {
-    rpc_pipeline_binAdd(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "pipeline_setState", MAX_ARG_LENGTH) == 0) {
-    rpc_pipeline_setState(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "pipeline_unref", MAX_ARG_LENGTH) == 0) {
-    rpc_pipeline_unref(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "element_setProperty", MAX_ARG_LENGTH) == 0) {
-    rpc_element_setProperty(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "element_setCapsProperty", MAX_ARG_LENGTH) == 0) {
-    rpc_element_setCapsProperty(argc, argv, responseMessage);
-  } else if (strncmp(argv[0], "element_link", MAX_ARG_LENGTH) == 0) {
-    rpc_element_link(argc, argv, responseMessage);
+  if (call->parse_result == RPC_OK)
+    rpc_message_destroy(&call->request);
+  g_variant_unref(call->request_variant);
+  g_object_unref(call->invocation);
+  g_free(call);
+}
+
+// On Stream Thread or Context Group Thread
+static void run_rpc_call(rpc_call_t *call) {
+  rpc_writer_t response;
+  uint8_t *response_data;
+  size_t response_length;
+
+  if (call->parse_result == RPC_OK) {
+    rpc_writer_init(&response, call->request.method_id);
+    handle_method_call_internal(&call->request, &response);
   } else {
-    g_printerr("Invalid method call!: %s\n", argv[0]);
+    g_printerr("Invalid RPC message! (error: %d)\n", call->parse_result);
+    rpc_writer_init(&response, RPC_METHOD_COUNT);
   }
+
+  call->is_answered = true;
+  response_data = rpc_writer_finish(&response, &response_length);
+  if (response_data == NULL) {
+    g_dbus_method_invocation_return_error_literal(
+        call->invocation, G_DBUS_ERROR, G_DBUS_ERROR_NO_MEMORY,
+        "Cannot make RPC response");
+    return;
+  }
+  g_dbus_method_invocation_return_value(
+      call->invocation,
+      g_variant_new("(@ay)", g_variant_new_from_data(
+                                 G_VARIANT_TYPE("ay"), response_data,
+                                 response_length, TRUE, free, response_data)));
+}
+
+static gboolean rpc_call_job_fn(gpointer data) {
+  // On Context Group Thread
+  run_rpc_call((rpc_call_t *)data);
+  return G_SOURCE_REMOVE;
 }
 
 static void
@@ -399,30 +1108,23 @@ handle_method_call_fn(GDBusConnection *connection, const gchar *sender,
                       const gchar *object_path, const gchar *interface_name,
                       const gchar *method_name, GVariant *parameters,
                       GDBusMethodInvocation *invocation, gpointer user_data) {
+  // On Stream Thread
   if (g_strcmp0(method_name, ANT_STREAMTHREAD_DBUS_METHOD) == 0) {
-    const gchar *inputMessage;
-    int argc = 0;
-    char argv[RPC_MAX_ARGC][MAX_ARG_LENGTH];
-    char responseMessage[MAX_RESULT_MESSAGE_LENGTH] = "";
-    g_variant_get(parameters, "(&s)", &inputMessage);
-
-    // Parsing arguments
-    {
-      char *token;
-      token = strtok((char *)inputMessage, "\n");
-      while (token != NULL) {
-        if (argc < RPC_MAX_ARGC) {
-          snprintf(argv[argc], MAX_ARG_LENGTH, "%s", token);
-        }
-        argc++;
-        token = strtok(NULL, "\n");
-      }
+    rpc_call_t *call = create_rpc_call(parameters, invocation);
+    GMainContext *context = NULL;
+
+    // Find the context group of the request
+    if (call->parse_result == RPC_OK) {
+      context = get_context_group(get_rpc_context_group(&call->request));
     }
-    // g_print("Incoming method call message:%s\n", argv[0]);
-    handle_method_call_internal(argc, argv, responseMessage);
 
-    g_dbus_method_invocation_return_value(
-        invocation, g_variant_new("(s)", responseMessage));
+    if (context == NULL) {
+      run_rpc_call(call);
+      destroy_rpc_call(call);
+    } else {
+      g_main_context_invoke_full(context, G_PRIORITY_DEFAULT, rpc_call_job_fn,
+                                 call, destroy_rpc_call);
+    }
   }
 }
 
@@ -510,74 +1212,511 @@ void ant_stream_initializeStream_internal() {
   pthread_create(&g_stream_thread, NULL, &stream_thread_fn, NULL);
 }
 
-void ant_stream_callDbusMethod_internal(const char *inputMessage,
-                                        char *resultMessage) {
-  GDBusConnection *connection;
-  GVariant *value;
-  gchar *inputMessageBuffer;
-  const gchar *resultMessageBuffer;
-  GError *gerror;
+// D-Bus client: one persistent connection per JS runtime.
+// Connecting to the peer-to-peer server requires an authentication handshake,
+// so the connection is kept open and shared by every RPC call.
+static GDBusConnection *g_gdbus_client_connection = NULL;
+static GMutex g_gdbus_client_mutex;
+
+// Reply dispatching context of asynchronous (pipelined) RPC calls.
+// Replies of in-flight calls are matched by call id on this context.
+static GMainContext *g_rpc_client_context = NULL;
+static GMainLoop *g_rpc_client_loop = NULL;
+static pthread_t g_rpc_client_thread;
+
+static GDBusConnection *get_gdbus_client_connection(void) {
+  GDBusConnection *connection = NULL;
+  GError *gerror = NULL;
 
   if (g_gdbus_address == NULL) {
     g_printerr("GDBus server is not set!");
-    return;
+    return NULL;
   }
 
-  gerror = NULL;
-  connection = g_dbus_connection_new_for_address_sync(
-      g_gdbus_address, G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
-      NULL, /* GDBusAuthObserver */
-      NULL, /* GCancellable */
-      &gerror);
+  g_mutex_lock(&g_gdbus_client_mutex);
+  if (g_gdbus_client_connection != NULL &&
+      g_dbus_connection_is_closed(g_gdbus_client_connection)) {
+    // The stream thread has been restarted: reconnect
+    g_object_unref(g_gdbus_client_connection);
+    g_gdbus_client_connection = NULL;
+  }
+  if (g_gdbus_client_connection == NULL) {
+    g_gdbus_client_connection = g_dbus_connection_new_for_address_sync(
+        g_gdbus_address, G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+        NULL, /* GDBusAuthObserver */
+        NULL, /* GCancellable */
+        &gerror);
+    if (g_gdbus_client_connection == NULL) {
+      g_printerr("Error connecting to D-Bus address %s: %s\n",
+                 g_gdbus_address, gerror->message);
+      g_error_free(gerror);
+    }
+  }
+  if (g_gdbus_client_connection != NULL) {
+    connection = g_object_ref(g_gdbus_client_connection);
+  }
+  g_mutex_unlock(&g_gdbus_client_mutex);
+
+  return connection;
+}
+
+void ant_stream_closeDbusConnection_internal() {
+  g_mutex_lock(&g_gdbus_client_mutex);
+  if (g_gdbus_client_connection != NULL) {
+    g_dbus_connection_close_sync(g_gdbus_client_connection, NULL, NULL);
+    g_object_unref(g_gdbus_client_connection);
+    g_gdbus_client_connection = NULL;
+  }
+  g_mutex_unlock(&g_gdbus_client_mutex);
+}
+
+// The request buffer is handed over to GVariant without copying.
+static GVariant *create_rpc_request_variant(uint8_t *request,
+                                            size_t request_length) {
+  return g_variant_new(
+      "(@ay)", g_variant_new_from_data(G_VARIANT_TYPE("ay"), request,
+                                       request_length, TRUE, free, request));
+}
+
+static const uint8_t *get_rpc_response_data(GVariant *value,
+                                            GVariant **response_variant,
+                                            size_t *response_length) {
+  gsize length;
+  const uint8_t *data;
+  *response_variant = g_variant_get_child_value(value, 0);
+  data = (const uint8_t *)g_variant_get_fixed_array(*response_variant, &length,
+                                                    sizeof(uint8_t));
+  *response_length = (size_t)length;
+  return data;
+}
+
+bool ant_stream_callRpc_internal(uint8_t *request, size_t request_length,
+                                 uint8_t **response, size_t *response_length) {
+  GDBusConnection *connection;
+  GVariant *value;
+  GVariant *response_variant;
+  const uint8_t *response_data;
+  GError *gerror;
+
+  connection = get_gdbus_client_connection();
   if (connection == NULL) {
-    g_printerr("Error connecting to D-Bus address %s: %s\n", g_gdbus_address,
-               gerror->message);
-    g_error_free(gerror);
-    return;
+    free(request);
+    return false;
   }
 
-  inputMessageBuffer = g_strdup_printf("%s", inputMessage);
+  gerror = NULL;
   value = g_dbus_connection_call_sync(
       connection, NULL, /* bus_name */
       ANT_STREAMTHREAD_DBUS_PATH, ANT_STREAMTHREAD_DBUS_INTERFACE,
-      ANT_STREAMTHREAD_DBUS_METHOD, g_variant_new("(s)", inputMessageBuffer),
-      G_VARIANT_TYPE("(s)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, &gerror);
+      ANT_STREAMTHREAD_DBUS_METHOD,
+      create_rpc_request_variant(request, request_length),
+      G_VARIANT_TYPE("(ay)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, &gerror);
+  g_object_unref(connection);
   if (value == NULL) {
     g_printerr("Error invoking method: %s\n", gerror->message);
     g_error_free(gerror);
-    return;
+    return false;
   }
-  g_variant_get(value, "(&s)", &resultMessageBuffer);
-  snprintf(resultMessage, MAX_RESULT_MESSAGE_LENGTH, "%s", resultMessageBuffer);
+  response_data =
+      get_rpc_response_data(value, &response_variant, response_length);
+  *response = (uint8_t *)malloc(*response_length);
+  memcpy(*response, response_data, *response_length);
+  g_variant_unref(response_variant);
   g_variant_unref(value);
+  return true;
+}
+
+static void *rpc_client_thread_fn(void *arg) {
+  // On RPC Client Thread
+  g_main_context_push_thread_default(g_rpc_client_context);
+  g_main_loop_run(g_rpc_client_loop);
+  g_main_context_pop_thread_default(g_rpc_client_context);
+  return NULL;
+}
+
+static void ensure_rpc_client_thread(void) {
+  g_mutex_lock(&g_gdbus_client_mutex);
+  if (g_rpc_client_context == NULL) {
+    g_rpc_client_context = g_main_context_new();
+    g_rpc_client_loop = g_main_loop_new(g_rpc_client_context, FALSE);
+    pthread_create(&g_rpc_client_thread, NULL, &rpc_client_thread_fn, NULL);
+  }
+  g_mutex_unlock(&g_gdbus_client_mutex);
+}
+
+typedef struct {
+  int call_id;
+  ant_stream_rpc_result_handler handler;
+  GDBusConnection *connection;
+  GVariant *parameters;
+} rpc_async_call_t;
+
+static void on_rpc_async_call_done(GObject *source, GAsyncResult *res,
+                                   gpointer user_data) {
+  // On RPC Client Thread
+  rpc_async_call_t *call = (rpc_async_call_t *)user_data;
+  GVariant *value;
+  GError *gerror = NULL;
 
+  value = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), res,
+                                        &gerror);
+  if (value == NULL) {
+    g_printerr("Error invoking method: %s\n", gerror->message);
+    g_error_free(gerror);
+    call->handler(call->call_id, NULL, 0);
+  } else {
+    GVariant *response_variant;
+    const uint8_t *response_data;
+    size_t response_length;
+    response_data =
+        get_rpc_response_data(value, &response_variant, &response_length);
+    call->handler(call->call_id, response_data, response_length);
+    g_variant_unref(response_variant);
+    g_variant_unref(value);
+  }
+  g_free(call);
+}
+
+static gboolean start_rpc_async_call(gpointer user_data) {
+  // On RPC Client Thread
+  // g_dbus_connection_call() binds its reply to the thread-default context,
+  // so it is issued here rather than on JS thread.
+  rpc_async_call_t *call = (rpc_async_call_t *)user_data;
+  GDBusConnection *connection = call->connection;
+  call->connection = NULL;
+  g_dbus_connection_call(connection, NULL, /* bus_name */
+                         ANT_STREAMTHREAD_DBUS_PATH,
+                         ANT_STREAMTHREAD_DBUS_INTERFACE,
+                         ANT_STREAMTHREAD_DBUS_METHOD, call->parameters,
+                         G_VARIANT_TYPE("(ay)"), G_DBUS_CALL_FLAGS_NONE, -1,
+                         NULL, on_rpc_async_call_done, call);
   g_object_unref(connection);
+  return G_SOURCE_REMOVE;
+}
+
+bool ant_stream_callRpcAsync_internal(int call_id, uint8_t *request,
+                                      size_t request_length,
+                                      ant_stream_rpc_result_handler handler) {
+  GDBusConnection *connection;
+  rpc_async_call_t *call;
+
+  connection = get_gdbus_client_connection();
+  if (connection == NULL) {
+    free(request);
+    return false;
+  }
+  ensure_rpc_client_thread();
+
+  call = g_new(rpc_async_call_t, 1);
+  call->call_id = call_id;
+  call->handler = handler;
+  call->connection = connection;
+  call->parameters = create_rpc_request_variant(request, request_length);
+
+  // The call is started and its reply is dispatched on the RPC client thread,
+  // so several calls can be in flight on the shared connection at once.
+  g_main_context_invoke(g_rpc_client_context, start_rpc_async_call, call);
+  return true;
+}
+
+// Zero-copy frame pool
+// A frame keeps a reference and a read mapping of an appsink buffer while
+// JS holds it, so the buffer is delivered without copying. The pool bounds
+// the number of buffers held by JS; when it is exhausted, a frame falls back
+// to a copy so that upstream buffer pools are not starved.
+#define FRAME_POOL_SIZE 8
+typedef struct {
+  GstBuffer *buffer;
+  GstMapInfo info;
+  bool is_used;
+} frame_slot_t;
+static frame_slot_t g_frame_pool[FRAME_POOL_SIZE];
+static GMutex g_frame_pool_mutex;
+
+static unsigned char *acquire_frame(GstBuffer *buffer, uint32_t *data_size) {
+  frame_slot_t *slot = NULL;
+  int i;
+
+  g_mutex_lock(&g_frame_pool_mutex);
+  for (i = 0; i < FRAME_POOL_SIZE; i++) {
+    if (!g_frame_pool[i].is_used) {
+      slot = &g_frame_pool[i];
+      slot->is_used = true;
+      break;
+    }
+  }
+  g_mutex_unlock(&g_frame_pool_mutex);
+
+  if (slot != NULL) {
+    if (!gst_buffer_map(buffer, &slot->info, GST_MAP_READ)) {
+      g_mutex_lock(&g_frame_pool_mutex);
+      slot->is_used = false;
+      g_mutex_unlock(&g_frame_pool_mutex);
+      return NULL;
+    }
+    slot->buffer = gst_buffer_ref(buffer);
+    *data_size = (uint32_t)slot->info.size;
+    return slot->info.data;
+  } else {
+    // Pool is exhausted: copy the buffer
+    GstMapInfo info;
+    unsigned char *data;
+    if (!gst_buffer_map(buffer, &info, GST_MAP_READ))
+      return NULL;
+    data = (unsigned char *)malloc(info.size);
+    if (data != NULL) {
+      memcpy(data, info.data, info.size);
+      *data_size = (uint32_t)info.size;
+    }
+    gst_buffer_unmap(buffer, &info);
+    return data;
+  }
+}
+
+void ant_stream_releaseFrame_internal(unsigned char *data) {
+  frame_slot_t *slot = NULL;
+  int i;
+
+  g_mutex_lock(&g_frame_pool_mutex);
+  for (i = 0; i < FRAME_POOL_SIZE; i++) {
+    if (g_frame_pool[i].is_used && g_frame_pool[i].info.data == data) {
+      slot = &g_frame_pool[i];
+      break;
+    }
+  }
+  g_mutex_unlock(&g_frame_pool_mutex);
+
+  if (slot != NULL) {
+    GstBuffer *buffer = slot->buffer;
+    gst_buffer_unmap(buffer, &slot->info);
+    gst_buffer_unref(buffer);
+    g_mutex_lock(&g_frame_pool_mutex);
+    slot->buffer = NULL;
+    slot->is_used = false;
+    g_mutex_unlock(&g_frame_pool_mutex);
+  } else {
+    // Copied frame
+    free(data);
+  }
+}
+
+char *ant_stream_getElementName_internal(int element_index) {
+  GstElement *element;
+  gchar *element_name;
+  char *result;
+  element = getElement(element_index);
+  if (element == NULL) {
+    return NULL;
+  }
+  element_name = gst_element_get_name(element);
+  result = strdup(element_name);
+  g_free(element_name);
+  return result;
+}
+
+// Tensors info
+// The tensor layout of NNStreamer frames is parsed from other/tensors caps
+// (dimensions, types and names) or other/tensor caps (dimension and type).
+// It is parsed only when the caps are changed.
+static const struct {
+  const char *name;
+  uint32_t element_size;
+} g_tensor_types[ANT_TENSOR_TYPE_COUNT] = {
+    [ANT_TENSOR_INT32] = {"int32", 4},     [ANT_TENSOR_UINT32] = {"uint32", 4},
+    [ANT_TENSOR_INT16] = {"int16", 2},     [ANT_TENSOR_UINT16] = {"uint16", 2},
+    [ANT_TENSOR_INT8] = {"int8", 1},       [ANT_TENSOR_UINT8] = {"uint8", 1},
+    [ANT_TENSOR_FLOAT64] = {"float64", 8},
+    [ANT_TENSOR_FLOAT32] = {"float32", 4},
+    [ANT_TENSOR_INT64] = {"int64", 8},     [ANT_TENSOR_UINT64] = {"uint64", 8},
+};
+
+ant_tensors_info_t *ant_tensors_info_ref(ant_tensors_info_t *info) {
+  g_atomic_int_inc(&info->ref_count);
+  return info;
+}
+
+void ant_tensors_info_unref(ant_tensors_info_t *info) {
+  if (info != NULL && g_atomic_int_dec_and_test(&info->ref_count)) {
+    g_free(info);
+  }
+}
+
+static int parse_tensor_type(const gchar *type_str) {
+  int i;
+  for (i = 0; i < ANT_TENSOR_TYPE_COUNT; i++) {
+    if (g_strcmp0(type_str, g_tensor_types[i].name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+// Parse "d1:d2:...", and returns the number of elements (0 on failure).
+static guint64 parse_tensor_dims(const gchar *dims_str, uint32_t *dims) {
+  gchar **dim_list;
+  guint64 num_elements = 1;
+  guint i;
+
+  dim_list = g_strsplit(dims_str, ":", ANT_TENSOR_RANK_MAX + 1);
+  if (g_strv_length(dim_list) > ANT_TENSOR_RANK_MAX) {
+    num_elements = 0;
+  }
+  for (i = 0; dim_list[i] != NULL && num_elements > 0; i++) {
+    guint64 dim = g_ascii_strtoull(g_strstrip(dim_list[i]), NULL, 10);
+    if (dim == 0 || dim > G_MAXUINT32 || num_elements > G_MAXUINT32 / dim) {
+      num_elements = 0;
+    } else {
+      dims[i] = (uint32_t)dim;
+      num_elements *= dim;
+    }
+  }
+  g_strfreev(dim_list);
+  return num_elements;
+}
+
+// Returns the tensors info, or NULL if the caps are not tensors.
+static ant_tensors_info_t *parse_tensors_info(GstCaps *caps) {
+  GstStructure *structure;
+  const gchar *dims_str, *types_str, *names_str;
+  gchar **dims_list, **types_list, **names_list = NULL;
+  ant_tensors_info_t *info;
+  guint num_tensors, num_names, i;
+  gint caps_num_tensors;
+  guint64 offset = 0;
+  bool result = true;
+
+  if (caps == NULL || gst_caps_get_size(caps) == 0)
+    return NULL;
+  structure = gst_caps_get_structure(caps, 0);
+  if (gst_structure_has_name(structure, "other/tensors")) {
+    dims_str = gst_structure_get_string(structure, "dimensions");
+    types_str = gst_structure_get_string(structure, "types");
+    names_str = gst_structure_get_string(structure, "names");
+  } else if (gst_structure_has_name(structure, "other/tensor")) {
+    dims_str = gst_structure_get_string(structure, "dimension");
+    types_str = gst_structure_get_string(structure, "type");
+    names_str = gst_structure_get_string(structure, "name");
+  } else {
+    return NULL;
+  }
+  if (dims_str == NULL || types_str == NULL)
+    return NULL;
+
+  dims_list = g_strsplit(dims_str, ",", ANT_TENSORS_MAX + 1);
+  types_list = g_strsplit(types_str, ",", ANT_TENSORS_MAX + 1);
+  num_tensors = g_strv_length(dims_list);
+  if (names_str != NULL) {
+    names_list = g_strsplit(names_str, ",", ANT_TENSORS_MAX + 1);
+  }
+  num_names = (names_list != NULL) ? g_strv_length(names_list) : 0;
+  if (num_tensors == 0 || num_tensors > ANT_TENSORS_MAX ||
+      g_strv_length(types_list) != num_tensors) {
+    result = false;
+  }
+  if (gst_structure_get_int(structure, "num_tensors", &caps_num_tensors) &&
+      caps_num_tensors != (gint)num_tensors) {
+    result = false;
+  }
+
+  info = g_new0(ant_tensors_info_t, 1);
+  info->ref_count = 1;
+  info->num_tensors = num_tensors;
+  for (i = 0; i < num_tensors && result; i++) {
+    ant_tensor_info_t *tensor = &info->tensors[i];
+    guint64 num_elements;
+    tensor->type = parse_tensor_type(g_strstrip(types_list[i]));
+    num_elements = parse_tensor_dims(dims_list[i], tensor->dims);
+    if (tensor->type < 0 || num_elements == 0) {
+      result = false;
+      break;
+    }
+    if (i < num_names) {
+      g_strlcpy(tensor->name, g_strstrip(names_list[i]), ANT_TENSOR_NAME_MAX);
+    }
+    tensor->offset = (uint32_t)offset;
+    offset += num_elements * g_tensor_types[tensor->type].element_size;
+    if (offset > G_MAXUINT32) {
+      result = false;
+      break;
+    }
+    tensor->size = (uint32_t)(offset - tensor->offset);
+  }
+  g_strfreev(dims_list);
+  g_strfreev(types_list);
+  g_strfreev(names_list);
+
+  if (!result) {
+    g_printerr("Invalid tensors caps: %s / %s\n", dims_str, types_str);
+    g_free(info);
+    return NULL;
+  }
+  return info;
 }
 
 /* The appsink has received a buffer */
-// TODO(RedCarrottt): Hardcoding: unique handler
-ant_async_handler g_ant_async_handler;
+typedef struct {
+  ant_async_handler handler;
+  ant_async_handler_destroy destroy;
+  void *user_data;
+  bool is_zero_copy;
+  bool is_tensors;
+  // Tensors mode: the last caps and its tensors info (on streaming thread)
+  GstCaps *caps;
+  ant_tensors_info_t *tensors_info;
+} signal_handler_data_t;
+
+// Returns a new reference of the tensors info of the caps, or NULL.
+static ant_tensors_info_t *get_tensors_info(signal_handler_data_t *handler_data,
+                                            GstCaps *caps) {
+  if (caps != handler_data->caps) {
+    ant_tensors_info_unref(handler_data->tensors_info);
+    gst_caps_replace(&handler_data->caps, caps);
+    handler_data->tensors_info = parse_tensors_info(caps);
+  }
+  if (handler_data->tensors_info == NULL)
+    return NULL;
+  return ant_tensors_info_ref(handler_data->tensors_info);
+}
 static GstFlowReturn gst_signal_handler_ant_async(GstElement *element,
-                                                  char *element_name) {
+                                                  gpointer data) {
   // gst signal handler -> call ant async handler
+  signal_handler_data_t *handler_data = (signal_handler_data_t *)data;
   GstSample *sample;
 
   /* Retrieve the buffer */
   g_signal_emit_by_name(element, "pull-sample", &sample);
   if (sample) {
     GstBuffer *buffer;
-    GstMapInfo info;
-    gboolean mapping_result;
-    /* The only thing we do in this example is print a * to indicate a received
-     * buffer */
+    ant_tensors_info_t *tensors_info = NULL;
     buffer = gst_sample_get_buffer(sample);
-    mapping_result = gst_buffer_map(buffer, &info, GST_MAP_READ);
-    if (mapping_result) {
-      // call ant async handler with data
-      g_ant_async_handler(element_name, info.data, info.size);
-      gst_buffer_unmap(buffer, &info);
+    if (handler_data->is_tensors) {
+      tensors_info =
+          get_tensors_info(handler_data, gst_sample_get_caps(sample));
+    }
+    if (handler_data->is_zero_copy) {
+      unsigned char *frame_data;
+      uint32_t frame_size;
+      frame_data = acquire_frame(buffer, &frame_size);
+      if (frame_data != NULL) {
+        // The frame is released by the ant async handler side
+        handler_data->handler(handler_data->user_data, frame_data, frame_size,
+                              tensors_info);
+      } else {
+        g_printerr("gst_buffer_map not successful...\n");
+        ant_tensors_info_unref(tensors_info);
+      }
     } else {
-      g_printerr("gst_buffer_map not successful...\n");
+      GstMapInfo info;
+      gboolean mapping_result;
+      mapping_result = gst_buffer_map(buffer, &info, GST_MAP_READ);
+      if (mapping_result) {
+        // call ant async handler with data
+        handler_data->handler(handler_data->user_data, info.data, info.size,
+                              tensors_info);
+        gst_buffer_unmap(buffer, &info);
+      } else {
+        g_printerr("gst_buffer_map not successful...\n");
+        ant_tensors_info_unref(tensors_info);
+      }
     }
     gst_sample_unref(sample);
     return GST_FLOW_OK;
@@ -587,24 +1726,43 @@ static GstFlowReturn gst_signal_handler_ant_async(GstElement *element,
   }
 }
 
+static void destroy_signal_handler_data(gpointer data, GClosure *closure) {
+  signal_handler_data_t *handler_data = (signal_handler_data_t *)data;
+  handler_data->destroy(handler_data->user_data);
+  gst_caps_replace(&handler_data->caps, NULL);
+  ant_tensors_info_unref(handler_data->tensors_info);
+  g_free(handler_data);
+}
+
 bool ant_stream_elementConnectSignal_internal(
-    int element_index, const char *detailed_signal,
-    ant_async_handler _ant_async_handler) {
+    int element_index, const char *detailed_signal, ant_async_handler handler,
+    ant_async_handler_destroy destroy, void *user_data, bool is_zero_copy,
+    bool is_tensors) {
   GstElement *element;
-  gchar *element_name;
+  signal_handler_data_t *handler_data;
   gulong result;
 
   element = getElement(element_index);
-  element_name = g_strdup_printf("%s", gst_element_get_name(element));
-
-  g_ant_async_handler = _ant_async_handler;
-
-  result =
-      g_signal_connect(element, detailed_signal,
-                       G_CALLBACK(gst_signal_handler_ant_async), element_name);
+  if (element == NULL) {
+    return false;
+  }
+  handler_data = g_new(signal_handler_data_t, 1);
+  handler_data->handler = handler;
+  handler_data->destroy = destroy;
+  handler_data->user_data = user_data;
+  handler_data->is_zero_copy = is_zero_copy;
+  handler_data->is_tensors = is_tensors;
+  handler_data->caps = NULL;
+  handler_data->tensors_info = NULL;
+
+  // The handler data is destroyed when the element is freed
+  result = g_signal_connect_data(element, detailed_signal,
+                                 G_CALLBACK(gst_signal_handler_ant_async),
+                                 handler_data, destroy_signal_handler_data, 0);
   if (result > 0) {
     return true;
   } else {
+    g_free(handler_data);
     return false;
   }
 }
@@ -17,18 +17,98 @@
 #define __ANT_STREAM_NATIVE_INTERNAL_H__
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 bool ant_stream_testPipeline_internal(const char *ipAddress);
 
-void ant_stream_callDbusMethod_internal(const char *inputMessage,
-                                        char *resultMessage);
+// RPC messages are made by ant_stream_rpc.h.
+// The request buffer is released by the callee, and the response buffer
+// should be released by the caller with free().
+bool ant_stream_callRpc_internal(uint8_t *request, size_t request_length,
+                                 uint8_t **response, size_t *response_length);
+typedef void (*ant_stream_rpc_result_handler)(int, const uint8_t *, size_t);
+bool ant_stream_callRpcAsync_internal(int call_id, uint8_t *request,
+                                      size_t request_length,
+                                      ant_stream_rpc_result_handler handler);
+// Bus message types
+// It should be matched with BUS_MESSAGE in antstream.js.
+enum {
+  BUS_MESSAGE_ERROR = 0,
+  BUS_MESSAGE_WARNING = 1,
+  BUS_MESSAGE_EOS = 2,
+  BUS_MESSAGE_QOS = 3,
+  BUS_MESSAGE_LATENCY = 4,
+  BUS_MESSAGE_BUFFERING = 5,
+  BUS_MESSAGE_STATE_CHANGED = 6
+};
+// Bus messages are encoded by ant_stream_rpc.h, and the handler takes the
+// ownership of the message (to be released by free()). The first argument is
+// the bus message type.
+// It is called on the thread of the pipeline's context group.
+typedef void (*ant_stream_bus_message_handler)(int, uint8_t *, size_t);
+void ant_stream_setBusMessageHandler_internal(
+    ant_stream_bus_message_handler handler);
+
+void ant_stream_closeDbusConnection_internal();
 void ant_stream_initializeStream_internal();
 
-typedef void (*ant_async_handler)(const char *, unsigned char *, uint32_t);
-bool ant_stream_elementConnectSignal_internal(int element_index,
-                                              const char *detailed_signal,
-                                              ant_async_handler handler);
+// Returns the name of the element (to be released by free()), or NULL if the
+// element index is invalid.
+char *ant_stream_getElementName_internal(int element_index);
+
+// Appsink handler: called on the streaming thread with the user data given to
+// Tensor types of NNStreamer other/tensors caps
+// It should be matched with g_tensor_type_names in ant_stream_native.c.
+enum {
+  ANT_TENSOR_INT32 = 0,
+  ANT_TENSOR_UINT32 = 1,
+  ANT_TENSOR_INT16 = 2,
+  ANT_TENSOR_UINT16 = 3,
+  ANT_TENSOR_INT8 = 4,
+  ANT_TENSOR_UINT8 = 5,
+  ANT_TENSOR_FLOAT64 = 6,
+  ANT_TENSOR_FLOAT32 = 7,
+  ANT_TENSOR_INT64 = 8,
+  ANT_TENSOR_UINT64 = 9,
+  ANT_TENSOR_TYPE_COUNT
+};
+#define ANT_TENSORS_MAX 16
+#define ANT_TENSOR_RANK_MAX 8
+#define ANT_TENSOR_NAME_MAX 64
+typedef struct {
+  int type;
+  uint32_t dims[ANT_TENSOR_RANK_MAX]; // innermost first, 0 if not used
+  char name[ANT_TENSOR_NAME_MAX];     // empty if not given by the caps
+  uint32_t offset;                    // byte offset in the frame
+  uint32_t size;                      // byte size
+} ant_tensor_info_t;
+// Tensor layout parsed from the caps of the frames. It is immutable and
+// shared by the frames with the same caps.
+typedef struct {
+  int ref_count;
+  uint32_t num_tensors;
+  ant_tensor_info_t tensors[ANT_TENSORS_MAX];
+} ant_tensors_info_t;
+ant_tensors_info_t *ant_tensors_info_ref(ant_tensors_info_t *info);
+void ant_tensors_info_unref(ant_tensors_info_t *info);
+
+// ant_stream_elementConnectSignal_internal().
+// In zero-copy mode, the handler takes the ownership of the data, and it
+// should be released by ant_stream_releaseFrame_internal(). Otherwise, the
+// data is valid only during the handler call.
+// In tensors mode, the tensor layout of the frame is also given, and the
+// handler takes its reference (to be released by ant_tensors_info_unref()).
+// It is NULL if the caps of the frame are not other/tensor(s).
+typedef void (*ant_async_handler)(void *, unsigned char *, uint32_t,
+                                  ant_tensors_info_t *);
+// Called when the signal is disconnected (i.e. the element is freed)
+typedef void (*ant_async_handler_destroy)(void *);
+bool ant_stream_elementConnectSignal_internal(
+    int element_index, const char *detailed_signal, ant_async_handler handler,
+    ant_async_handler_destroy destroy, void *user_data, bool is_zero_copy,
+    bool is_tensors);
+void ant_stream_releaseFrame_internal(unsigned char *data);
 
 void initANTStream(void);
 
@@ -0,0 +1,302 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "./ant_stream_rpc.h"
+
+#define RPC_WRITER_INITIAL_CAPACITY 64
+
+// Message parser
+// Every read is bounds-checked and done with memcpy(), since the message
+// buffer of GVariant is not guaranteed to be aligned.
+typedef struct {
+  const uint8_t *data;
+  size_t length;
+  size_t offset;
+} rpc_reader_t;
+
+static bool rpc_reader_read(rpc_reader_t *reader, void *dest, size_t size) {
+  if (reader->length - reader->offset < size)
+    return false;
+  memcpy(dest, reader->data + reader->offset, size);
+  reader->offset += size;
+  return true;
+}
+
+static int rpc_reader_read_arg(rpc_reader_t *reader, rpc_arg_t *arg) {
+  uint8_t type;
+  if (!rpc_reader_read(reader, &type, sizeof(type)))
+    return RPC_ERR_TRUNCATED;
+
+  switch (type) {
+  case RPC_ARG_BOOLEAN: {
+    uint8_t value;
+    if (!rpc_reader_read(reader, &value, sizeof(value)))
+      return RPC_ERR_TRUNCATED;
+    arg->value.boolean = (value != 0);
+    break;
+  }
+  case RPC_ARG_INTEGER:
+    if (!rpc_reader_read(reader, &arg->value.integer, sizeof(int32_t)))
+      return RPC_ERR_TRUNCATED;
+    break;
+  case RPC_ARG_DOUBLE:
+    if (!rpc_reader_read(reader, &arg->value.number, sizeof(double)))
+      return RPC_ERR_TRUNCATED;
+    break;
+  case RPC_ARG_STRING: {
+    uint32_t length;
+    if (!rpc_reader_read(reader, &length, sizeof(length)))
+      return RPC_ERR_TRUNCATED;
+    // string bytes and its NUL terminator
+    if (reader->length - reader->offset < (size_t)length + 1)
+      return RPC_ERR_TRUNCATED;
+    if (reader->data[reader->offset + length] != '\0')
+      return RPC_ERR_STRING;
+    arg->value.string.data = (const char *)(reader->data + reader->offset);
+    arg->value.string.length = length;
+    reader->offset += (size_t)length + 1;
+    break;
+  }
+  default:
+    return RPC_ERR_TYPE;
+  }
+  arg->type = (rpc_arg_type_t)type;
+  return RPC_OK;
+}
+
+int rpc_message_parse(const uint8_t *data, size_t length, rpc_message_t *msg) {
+  rpc_reader_t reader = {data, length, 0};
+  uint32_t message_length;
+  uint32_t i;
+
+  msg->args = msg->inline_args;
+  msg->argc = 0;
+
+  // Header
+  if (data == NULL || length < RPC_HEADER_LENGTH)
+    return RPC_ERR_TRUNCATED;
+  rpc_reader_read(&reader, &message_length, sizeof(message_length));
+  rpc_reader_read(&reader, &msg->method_id, sizeof(msg->method_id));
+  rpc_reader_read(&reader, &msg->argc, sizeof(msg->argc));
+  if ((size_t)message_length != length)
+    return RPC_ERR_LENGTH;
+
+  // Each argument takes at least 2 bytes. It bounds the allocation size of
+  // a malformed message.
+  if (msg->argc > (length - RPC_HEADER_LENGTH) / 2) {
+    msg->argc = 0;
+    return RPC_ERR_TRUNCATED;
+  }
+  if (msg->argc > RPC_INLINE_ARGS) {
+    msg->args = (rpc_arg_t *)malloc(sizeof(rpc_arg_t) * msg->argc);
+    if (msg->args == NULL) {
+      msg->args = msg->inline_args;
+      msg->argc = 0;
+      return RPC_ERR_OMEM;
+    }
+  }
+
+  // Arguments
+  for (i = 0; i < msg->argc; i++) {
+    int res = rpc_reader_read_arg(&reader, &msg->args[i]);
+    if (res != RPC_OK) {
+      rpc_message_destroy(msg);
+      return res;
+    }
+  }
+  if (reader.offset != length) {
+    rpc_message_destroy(msg);
+    return RPC_ERR_LENGTH;
+  }
+  return RPC_OK;
+}
+
+void rpc_message_destroy(rpc_message_t *msg) {
+  if (msg->args != msg->inline_args) {
+    free(msg->args);
+  }
+  msg->args = msg->inline_args;
+  msg->argc = 0;
+}
+
+bool rpc_message_check_signature(const rpc_message_t *msg,
+                                 const char *signature) {
+  uint32_t i;
+  for (i = 0; signature[i] != '\0' && signature[i] != '+'; i++) {
+    rpc_arg_type_t type;
+    if (i >= msg->argc)
+      return false;
+    type = msg->args[i].type;
+    switch (signature[i]) {
+    case 'b':
+      if (type != RPC_ARG_BOOLEAN)
+        return false;
+      break;
+    case 's':
+      if (type != RPC_ARG_STRING)
+        return false;
+      break;
+    case 'i':
+      if (type != RPC_ARG_INTEGER)
+        return false;
+      break;
+    case 'd':
+      if (type != RPC_ARG_DOUBLE)
+        return false;
+      break;
+    case '*':
+      break;
+    default:
+      return false;
+    }
+  }
+  return (signature[i] == '+') || (i == msg->argc);
+}
+
+// Message writer
+static bool rpc_writer_reserve(rpc_writer_t *writer, size_t size) {
+  size_t new_capacity;
+  uint8_t *new_data;
+  if (writer->is_failed)
+    return false;
+  if (writer->capacity - writer->length >= size)
+    return true;
+
+  new_capacity = writer->capacity;
+  while (new_capacity - writer->length < size) {
+    new_capacity *= 2;
+  }
+  new_data = (uint8_t *)realloc(writer->data, new_capacity);
+  if (new_data == NULL) {
+    writer->is_failed = true;
+    return false;
+  }
+  writer->data = new_data;
+  writer->capacity = new_capacity;
+  return true;
+}
+
+static void rpc_writer_write(rpc_writer_t *writer, const void *src,
+                             size_t size) {
+  memcpy(writer->data + writer->length, src, size);
+  writer->length += size;
+}
+
+void rpc_writer_init(rpc_writer_t *writer, uint16_t method_id) {
+  uint32_t zero = 0;
+  writer->data = (uint8_t *)malloc(RPC_WRITER_INITIAL_CAPACITY);
+  writer->length = 0;
+  writer->capacity = RPC_WRITER_INITIAL_CAPACITY;
+  writer->argc = 0;
+  writer->is_failed = (writer->data == NULL);
+  if (writer->is_failed)
+    return;
+
+  // message length and argc are filled by rpc_writer_finish()
+  rpc_writer_write(writer, &zero, sizeof(zero));
+  rpc_writer_write(writer, &method_id, sizeof(method_id));
+  rpc_writer_write(writer, &zero, sizeof(zero));
+}
+
+void rpc_writer_put_boolean(rpc_writer_t *writer, bool value) {
+  uint8_t type = RPC_ARG_BOOLEAN;
+  uint8_t value_u8 = value ? 1 : 0;
+  if (!rpc_writer_reserve(writer, 2))
+    return;
+  rpc_writer_write(writer, &type, sizeof(type));
+  rpc_writer_write(writer, &value_u8, sizeof(value_u8));
+  writer->argc++;
+}
+
+void rpc_writer_put_integer(rpc_writer_t *writer, int32_t value) {
+  uint8_t type = RPC_ARG_INTEGER;
+  if (!rpc_writer_reserve(writer, 1 + sizeof(value)))
+    return;
+  rpc_writer_write(writer, &type, sizeof(type));
+  rpc_writer_write(writer, &value, sizeof(value));
+  writer->argc++;
+}
+
+void rpc_writer_put_double(rpc_writer_t *writer, double value) {
+  uint8_t type = RPC_ARG_DOUBLE;
+  if (!rpc_writer_reserve(writer, 1 + sizeof(value)))
+    return;
+  rpc_writer_write(writer, &type, sizeof(type));
+  rpc_writer_write(writer, &value, sizeof(value));
+  writer->argc++;
+}
+
+void rpc_writer_put_string(rpc_writer_t *writer, const char *value,
+                           uint32_t length) {
+  uint8_t type = RPC_ARG_STRING;
+  uint8_t nul = '\0';
+  if (!rpc_writer_reserve(writer, 1 + sizeof(length) + (size_t)length + 1))
+    return;
+  rpc_writer_write(writer, &type, sizeof(type));
+  rpc_writer_write(writer, &length, sizeof(length));
+  rpc_writer_write(writer, value, length);
+  rpc_writer_write(writer, &nul, sizeof(nul));
+  writer->argc++;
+}
+
+void rpc_writer_put_arg(rpc_writer_t *writer, const rpc_arg_t *arg) {
+  switch (arg->type) {
+  case RPC_ARG_BOOLEAN:
+    rpc_writer_put_boolean(writer, arg->value.boolean);
+    break;
+  case RPC_ARG_STRING:
+    rpc_writer_put_string(writer, arg->value.string.data,
+                          arg->value.string.length);
+    break;
+  case RPC_ARG_INTEGER:
+    rpc_writer_put_integer(writer, arg->value.integer);
+    break;
+  case RPC_ARG_DOUBLE:
+    rpc_writer_put_double(writer, arg->value.number);
+    break;
+  }
+}
+
+uint8_t *rpc_writer_finish(rpc_writer_t *writer, size_t *length) {
+  uint8_t *data;
+  uint32_t message_length;
+  if (writer->is_failed || writer->length > UINT32_MAX) {
+    rpc_writer_destroy(writer);
+    return NULL;
+  }
+  message_length = (uint32_t)writer->length;
+  memcpy(writer->data, &message_length, sizeof(message_length));
+  memcpy(writer->data + sizeof(uint32_t) + sizeof(uint16_t), &writer->argc,
+         sizeof(writer->argc));
+
+  data = writer->data;
+  *length = writer->length;
+  writer->data = NULL;
+  writer->length = 0;
+  writer->capacity = 0;
+  writer->is_failed = true;
+  return data;
+}
+
+void rpc_writer_destroy(rpc_writer_t *writer) {
+  free(writer->data);
+  writer->data = NULL;
+  writer->length = 0;
+  writer->capacity = 0;
+  writer->is_failed = true;
+}
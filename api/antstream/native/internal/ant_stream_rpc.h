@@ -0,0 +1,135 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ANT_STREAM_RPC_H__
+#define __ANT_STREAM_RPC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream thread RPC message format
+// Both ends of the RPC are in the same process, so all the numbers are
+// encoded in host byte order.
+//
+// message := header arg*
+// header  := u32 message length | u16 method id | u32 argc
+// arg     := u8 type | payload
+// payload := (boolean) u8
+//          | (integer) i32
+//          | (double)  f64
+//          | (string)  u32 length | bytes | '\0'
+//
+// String payloads keep their NUL terminator, so the parser can return
+// pointers into the message without copying.
+// A response uses the same format; its method id is the one of the request.
+
+// RPC method ids
+// It should be matched with RPC_METHOD_* in antstream.js.
+enum {
+  RPC_STREAMAPI_QUITMAINLOOP = 0,
+  RPC_STREAMAPI_CREATEPIPELINE = 1,
+  RPC_STREAMAPI_CREATEELEMENT = 2,
+  RPC_PIPELINE_BINADD = 3,
+  RPC_PIPELINE_SETSTATE = 4,
+  RPC_PIPELINE_UNREF = 5,
+  RPC_ELEMENT_SETPROPERTY = 6,
+  RPC_ELEMENT_SETCAPSPROPERTY = 7,
+  RPC_ELEMENT_LINK = 8,
+  RPC_STREAMAPI_BUILDPIPELINE = 9,
+  RPC_STREAMAPI_SETTRACING = 10,
+  RPC_STREAMAPI_GETTRACE = 11,
+  RPC_METHOD_COUNT
+};
+
+// RPC argument types
+// The values are the same as the property types of Element.setProperty().
+typedef enum {
+  RPC_ARG_BOOLEAN = 0,
+  RPC_ARG_STRING = 1,
+  RPC_ARG_INTEGER = 2,
+  RPC_ARG_DOUBLE = 3
+} rpc_arg_type_t;
+
+typedef struct {
+  rpc_arg_type_t type;
+  union {
+    bool boolean;
+    int32_t integer;
+    double number;
+    struct {
+      const char *data; // NUL-terminated, points into the message
+      uint32_t length;
+    } string;
+  } value;
+} rpc_arg_t;
+
+// Parse result codes
+#define RPC_OK 0
+#define RPC_ERR_TRUNCATED -1 /* Message is shorter than it declares */
+#define RPC_ERR_LENGTH -2    /* Length field does not match the message */
+#define RPC_ERR_TYPE -3      /* Unknown argument type */
+#define RPC_ERR_STRING -4    /* String is not NUL-terminated */
+#define RPC_ERR_OMEM -5      /* Out of memory */
+
+#define RPC_HEADER_LENGTH 10
+#define RPC_INLINE_ARGS 8
+
+typedef struct {
+  uint16_t method_id;
+  uint32_t argc;
+  rpc_arg_t *args;
+  // Small messages are parsed without heap allocation
+  rpc_arg_t inline_args[RPC_INLINE_ARGS];
+} rpc_message_t;
+
+// Parse a message. On success, the message must be released by
+// rpc_message_destroy(), and it is valid while data is alive.
+int rpc_message_parse(const uint8_t *data, size_t length, rpc_message_t *msg);
+void rpc_message_destroy(rpc_message_t *msg);
+
+// Check the types of arguments with a signature.
+// 'b': boolean, 's': string, 'i': integer, 'd': double, '*': any type,
+// and a trailing '+' allows any number of additional arguments.
+bool rpc_message_check_signature(const rpc_message_t *msg,
+                                 const char *signature);
+
+#define RPC_ARG_BOOLEAN_VALUE(msg, i) ((msg)->args[(i)].value.boolean)
+#define RPC_ARG_INTEGER_VALUE(msg, i) ((msg)->args[(i)].value.integer)
+#define RPC_ARG_DOUBLE_VALUE(msg, i) ((msg)->args[(i)].value.number)
+#define RPC_ARG_STRING_VALUE(msg, i) ((msg)->args[(i)].value.string.data)
+
+// Message writer
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+  uint32_t argc;
+  bool is_failed;
+} rpc_writer_t;
+
+void rpc_writer_init(rpc_writer_t *writer, uint16_t method_id);
+void rpc_writer_put_boolean(rpc_writer_t *writer, bool value);
+void rpc_writer_put_integer(rpc_writer_t *writer, int32_t value);
+void rpc_writer_put_double(rpc_writer_t *writer, double value);
+void rpc_writer_put_string(rpc_writer_t *writer, const char *value,
+                           uint32_t length);
+void rpc_writer_put_arg(rpc_writer_t *writer, const rpc_arg_t *arg);
+// Finish the message and take its ownership (to be released by free()).
+// Returns NULL if the writer failed to allocate memory.
+uint8_t *rpc_writer_finish(rpc_writer_t *writer, size_t *length);
+void rpc_writer_destroy(rpc_writer_t *writer);
+
+#endif /* !defined(__ANT_STREAM_RPC_H__) */
@@ -0,0 +1,297 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#include <string.h>
+
+#include "./ant_stream_tracer.h"
+
+// Ring buffer of recent values
+// Writers on streaming threads only take a position with an atomic
+// increment, so a reader may see a value being overwritten. It is fine for
+// statistics.
+#define TRACER_RING_SIZE 1024 // should be power of 2
+typedef struct {
+  guint32 values[TRACER_RING_SIZE];
+  gint count; // number of written values (atomic)
+} tracer_ring_t;
+
+static void tracer_ring_put(tracer_ring_t *ring, guint32 value) {
+  guint position = (guint)g_atomic_int_add(&ring->count, 1);
+  ring->values[position & (TRACER_RING_SIZE - 1)] = value;
+}
+
+static int get_histogram_bucket(guint32 value) {
+  int bucket = 0;
+  while (value > 0 && bucket < TRACER_HISTOGRAM_BUCKETS - 1) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void tracer_ring_write_histogram(tracer_ring_t *ring,
+                                        rpc_writer_t *writer) {
+  int histogram[TRACER_HISTOGRAM_BUCKETS] = {
+      0,
+  };
+  guint count = (guint)g_atomic_int_get(&ring->count);
+  guint i;
+  if (count > TRACER_RING_SIZE)
+    count = TRACER_RING_SIZE;
+  for (i = 0; i < count; i++) {
+    histogram[get_histogram_bucket(ring->values[i])]++;
+  }
+  for (i = 0; i < TRACER_HISTOGRAM_BUCKETS; i++) {
+    rpc_writer_put_integer(writer, histogram[i]);
+  }
+}
+
+// Trace entry of an element
+// It is referenced by the tracer and its pad probes.
+typedef struct {
+  GstElement *element;
+  gchar *name;
+  gint ref_count;
+  bool has_queue_level;
+  bool has_src_pads;
+  GSList *probes; // tracer_probe_t
+
+  // Written by streaming threads
+  gint last_sink_us; // truncated to 32 bits
+  gint num_buffers;
+  gint num_dropped;
+  tracer_ring_t proctime;
+  tracer_ring_t queue_level;
+
+  // Only for pipelines
+  GstBus *bus;
+  gulong qos_handler_id;
+} tracer_entry_t;
+
+typedef struct {
+  GstPad *pad;
+  gulong probe_id;
+} tracer_probe_t;
+
+static GPtrArray *g_tracer_entries = NULL; // NULL if tracing is disabled
+static gint64 g_tracer_start_us;
+static GMutex g_tracer_mutex;
+
+static guint32 get_now_us(void) { return (guint32)g_get_monotonic_time(); }
+
+static void tracer_entry_unref(gpointer data) {
+  tracer_entry_t *entry = (tracer_entry_t *)data;
+  if (g_atomic_int_dec_and_test(&entry->ref_count)) {
+    gst_object_unref(entry->element);
+    g_free(entry->name);
+    g_free(entry);
+  }
+}
+
+static GstPadProbeReturn tracer_sink_probe(GstPad *pad, GstPadProbeInfo *info,
+                                           gpointer data) {
+  tracer_entry_t *entry = (tracer_entry_t *)data;
+  g_atomic_int_set(&entry->last_sink_us, (gint)get_now_us());
+  if (!entry->has_src_pads) {
+    g_atomic_int_inc(&entry->num_buffers);
+  }
+  if (entry->has_queue_level) {
+    guint level = 0;
+    g_object_get(G_OBJECT(entry->element), "current-level-buffers", &level,
+                 NULL);
+    tracer_ring_put(&entry->queue_level, level);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn tracer_src_probe(GstPad *pad, GstPadProbeInfo *info,
+                                          gpointer data) {
+  tracer_entry_t *entry = (tracer_entry_t *)data;
+  guint32 last_sink_us = (guint32)g_atomic_int_get(&entry->last_sink_us);
+  g_atomic_int_inc(&entry->num_buffers);
+  // Source elements have no processing time
+  if (last_sink_us != 0) {
+    tracer_ring_put(&entry->proctime, get_now_us() - last_sink_us);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+static void tracer_qos_cb(GstBus *bus, GstMessage *msg, gpointer data) {
+  GstFormat format;
+  guint64 processed, dropped;
+  guint i;
+
+  // QoS messages carry the accumulated number of dropped buffers
+  gst_message_parse_qos_stats(msg, &format, &processed, &dropped);
+  if (dropped == (guint64)-1)
+    return;
+  g_mutex_lock(&g_tracer_mutex);
+  for (i = 0; g_tracer_entries != NULL && i < g_tracer_entries->len; i++) {
+    tracer_entry_t *entry =
+        (tracer_entry_t *)g_ptr_array_index(g_tracer_entries, i);
+    if (GST_OBJECT(entry->element) == GST_MESSAGE_SRC(msg)) {
+      g_atomic_int_set(&entry->num_dropped, (gint)dropped);
+      break;
+    }
+  }
+  g_mutex_unlock(&g_tracer_mutex);
+}
+
+static void tracer_add_probe(tracer_entry_t *entry, GstPad *pad) {
+  tracer_probe_t *probe;
+  bool is_sink = (GST_PAD_DIRECTION(pad) == GST_PAD_SINK);
+  probe = g_new(tracer_probe_t, 1);
+  probe->pad = (GstPad *)gst_object_ref(pad);
+  g_atomic_int_inc(&entry->ref_count);
+  probe->probe_id = gst_pad_add_probe(
+      pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      is_sink ? tracer_sink_probe : tracer_src_probe, entry,
+      tracer_entry_unref);
+  entry->probes = g_slist_prepend(entry->probes, probe);
+}
+
+static void tracer_remove_entry(tracer_entry_t *entry) {
+  GSList *item;
+  for (item = entry->probes; item != NULL; item = item->next) {
+    tracer_probe_t *probe = (tracer_probe_t *)item->data;
+    gst_pad_remove_probe(probe->pad, probe->probe_id);
+    gst_object_unref(probe->pad);
+    g_free(probe);
+  }
+  g_slist_free(entry->probes);
+  entry->probes = NULL;
+  if (entry->bus != NULL) {
+    g_signal_handler_disconnect(entry->bus, entry->qos_handler_id);
+    gst_object_unref(entry->bus);
+    entry->bus = NULL;
+  }
+  tracer_entry_unref(entry);
+}
+
+void ant_stream_tracer_set_enabled(bool is_enabled) {
+  g_mutex_lock(&g_tracer_mutex);
+  if (is_enabled && g_tracer_entries == NULL) {
+    g_tracer_entries = g_ptr_array_new();
+    g_tracer_start_us = g_get_monotonic_time();
+  } else if (!is_enabled && g_tracer_entries != NULL) {
+    guint i;
+    for (i = 0; i < g_tracer_entries->len; i++) {
+      tracer_remove_entry(
+          (tracer_entry_t *)g_ptr_array_index(g_tracer_entries, i));
+    }
+    g_ptr_array_free(g_tracer_entries, TRUE);
+    g_tracer_entries = NULL;
+  }
+  g_mutex_unlock(&g_tracer_mutex);
+}
+
+bool ant_stream_tracer_is_enabled(void) {
+  bool is_enabled;
+  g_mutex_lock(&g_tracer_mutex);
+  is_enabled = (g_tracer_entries != NULL);
+  g_mutex_unlock(&g_tracer_mutex);
+  return is_enabled;
+}
+
+void ant_stream_tracer_add_element(GstElement *element) {
+  tracer_entry_t *entry;
+  GList *item;
+  guint i;
+
+  g_mutex_lock(&g_tracer_mutex);
+  if (g_tracer_entries == NULL) {
+    g_mutex_unlock(&g_tracer_mutex);
+    return;
+  }
+  for (i = 0; i < g_tracer_entries->len; i++) {
+    tracer_entry_t *traced =
+        (tracer_entry_t *)g_ptr_array_index(g_tracer_entries, i);
+    if (traced->element == element) {
+      g_mutex_unlock(&g_tracer_mutex);
+      return;
+    }
+  }
+
+  entry = g_new0(tracer_entry_t, 1);
+  entry->element = (GstElement *)gst_object_ref(element);
+  entry->name = gst_element_get_name(element);
+  entry->ref_count = 1;
+  entry->has_queue_level = (g_object_class_find_property(
+                                G_OBJECT_GET_CLASS(element),
+                                "current-level-buffers") != NULL);
+
+  // Pads that exist now are traced
+  GST_OBJECT_LOCK(element);
+  entry->has_src_pads = (element->numsrcpads > 0);
+  for (item = element->pads; item != NULL; item = item->next) {
+    tracer_add_probe(entry, GST_PAD(item->data));
+  }
+  GST_OBJECT_UNLOCK(element);
+
+  // Elements in a pipeline post QoS messages on the pipeline bus
+  if (GST_IS_PIPELINE(element)) {
+    entry->bus = gst_element_get_bus(element);
+    entry->qos_handler_id = g_signal_connect(
+        G_OBJECT(entry->bus), "message::qos", (GCallback)tracer_qos_cb, NULL);
+  }
+
+  g_ptr_array_add(g_tracer_entries, entry);
+  g_mutex_unlock(&g_tracer_mutex);
+}
+
+void ant_stream_tracer_remove_element(GstElement *element) {
+  guint i;
+  g_mutex_lock(&g_tracer_mutex);
+  for (i = 0; g_tracer_entries != NULL && i < g_tracer_entries->len; i++) {
+    tracer_entry_t *entry =
+        (tracer_entry_t *)g_ptr_array_index(g_tracer_entries, i);
+    if (entry->element == element) {
+      g_ptr_array_remove_index(g_tracer_entries, i);
+      tracer_remove_entry(entry);
+      break;
+    }
+  }
+  g_mutex_unlock(&g_tracer_mutex);
+}
+
+void ant_stream_tracer_write_report(rpc_writer_t *writer, bool is_reset) {
+  gint64 now_us = g_get_monotonic_time();
+  guint i;
+
+  g_mutex_lock(&g_tracer_mutex);
+  rpc_writer_put_integer(writer, TRACER_HISTOGRAM_BUCKETS);
+  for (i = 0; g_tracer_entries != NULL && i < g_tracer_entries->len; i++) {
+    tracer_entry_t *entry =
+        (tracer_entry_t *)g_ptr_array_index(g_tracer_entries, i);
+    rpc_writer_put_string(writer, entry->name, (uint32_t)strlen(entry->name));
+    rpc_writer_put_integer(writer, g_atomic_int_get(&entry->num_buffers));
+    rpc_writer_put_integer(writer, g_atomic_int_get(&entry->num_dropped));
+    rpc_writer_put_double(writer, (double)(now_us - g_tracer_start_us));
+    tracer_ring_write_histogram(&entry->proctime, writer);
+    tracer_ring_write_histogram(&entry->queue_level, writer);
+    if (is_reset) {
+      g_atomic_int_set(&entry->num_buffers, 0);
+      g_atomic_int_set(&entry->proctime.count, 0);
+      g_atomic_int_set(&entry->queue_level.count, 0);
+    }
+  }
+  if (is_reset) {
+    g_tracer_start_us = now_us;
+  }
+  g_mutex_unlock(&g_tracer_mutex);
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ANT_STREAM_TRACER_H__
+#define __ANT_STREAM_TRACER_H__
+
+#include <gst/gst.h>
+#include <stdbool.h>
+
+#include "./ant_stream_rpc.h"
+
+// Stream pipeline tracer
+// When tracing is enabled, pad probes on registered elements record the
+// following into per-element ring buffers without locking:
+// - processing time: from a buffer arriving at a sink pad to the next
+//   buffer pushed from a src pad of the element
+// - queue level: the number of buffers in the element on buffer arrival
+//   (only for elements with "current-level-buffers" property, e.g. queue)
+// Buffer counts are kept with atomic counters, and dropped buffers are
+// counted from QoS messages of the elements (accumulated, not reset).
+//
+// Report (RPC response): <bucket count> then for each element:
+//   <name> <buffers> <dropped> <elapsed us (double)>
+//   <processing time histogram: bucket count ints>
+//   <queue level histogram: bucket count ints>
+// Histogram bucket 0 counts value 0, and bucket i counts values in
+// [2^(i-1), 2^i). The last bucket also counts larger values.
+// Processing time is in microseconds.
+#define TRACER_HISTOGRAM_BUCKETS 24
+
+// Tracer functions are called on stream thread. add/remove_element are also
+// called by the element registry.
+void ant_stream_tracer_set_enabled(bool is_enabled);
+bool ant_stream_tracer_is_enabled(void);
+void ant_stream_tracer_add_element(GstElement *element);
+void ant_stream_tracer_remove_element(GstElement *element);
+// Write the report and optionally reset the records
+void ant_stream_tracer_write_report(rpc_writer_t *writer, bool is_reset);
+
+#endif /* !defined(__ANT_STREAM_TRACER_H__) */
@@ -0,0 +1,155 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "./bounded_queue.h"
+
+bq_t *bq_new(int capacity, bq_policy_t policy, bq_teardown_fn item_teardown) {
+  bq_t *queue;
+  if (policy == BQ_COALESCE || capacity < 1) {
+    capacity = 1;
+  }
+  queue = (bq_t *)malloc(sizeof(bq_t));
+  if (queue == NULL)
+    return NULL;
+  queue->items = (void **)malloc(sizeof(void *) * capacity);
+  if (queue->items == NULL) {
+    free(queue);
+    return NULL;
+  }
+  queue->capacity = capacity;
+  queue->head = 0;
+  queue->len = 0;
+  queue->policy = policy;
+  queue->is_closed = false;
+  queue->num_dropped = 0;
+  queue->item_teardown = item_teardown;
+  pthread_mutex_init(&queue->mutex, NULL);
+  pthread_cond_init(&queue->not_full, NULL);
+  return queue;
+}
+
+void bq_delete(bq_t *queue) {
+  void *item;
+  while ((item = bq_pop(queue)) != NULL) {
+    queue->item_teardown(item);
+  }
+  pthread_cond_destroy(&queue->not_full);
+  pthread_mutex_destroy(&queue->mutex);
+  free(queue->items);
+  free(queue);
+}
+
+static void *bq_pop_locked(bq_t *queue) {
+  void *item;
+  if (queue->len == 0)
+    return NULL;
+  item = queue->items[queue->head];
+  queue->head = (queue->head + 1) % queue->capacity;
+  queue->len--;
+  return item;
+}
+
+static void bq_wait_not_full_locked(bq_t *queue) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += BQ_BLOCK_TIMEOUT_MS / 1000;
+  deadline.tv_nsec += (BQ_BLOCK_TIMEOUT_MS % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  while (queue->len == queue->capacity && !queue->is_closed) {
+    if (pthread_cond_timedwait(&queue->not_full, &queue->mutex, &deadline) ==
+        ETIMEDOUT)
+      break;
+  }
+}
+
+bool bq_push(bq_t *queue, void *item) {
+  void *dropped_item = NULL;
+  bool result = true;
+
+  pthread_mutex_lock(&queue->mutex);
+  if (queue->len == queue->capacity && queue->policy == BQ_BLOCK) {
+    bq_wait_not_full_locked(queue);
+  }
+  if (queue->is_closed) {
+    dropped_item = item;
+    result = false;
+  } else if (queue->len == queue->capacity) {
+    switch (queue->policy) {
+    case BQ_DROP_OLDEST:
+    case BQ_COALESCE:
+      dropped_item = bq_pop_locked(queue);
+      break;
+    case BQ_DROP_NEWEST:
+    case BQ_BLOCK: // timed out
+      dropped_item = item;
+      result = false;
+      break;
+    }
+  }
+  if (result) {
+    queue->items[(queue->head + queue->len) % queue->capacity] = item;
+    queue->len++;
+  }
+  if (dropped_item != NULL) {
+    queue->num_dropped++;
+  }
+  pthread_mutex_unlock(&queue->mutex);
+
+  if (dropped_item != NULL) {
+    queue->item_teardown(dropped_item);
+  }
+  return result;
+}
+
+void *bq_pop(bq_t *queue) {
+  void *item;
+  pthread_mutex_lock(&queue->mutex);
+  item = bq_pop_locked(queue);
+  if (item != NULL) {
+    pthread_cond_signal(&queue->not_full);
+  }
+  pthread_mutex_unlock(&queue->mutex);
+  return item;
+}
+
+void bq_close(bq_t *queue) {
+  pthread_mutex_lock(&queue->mutex);
+  queue->is_closed = true;
+  pthread_cond_broadcast(&queue->not_full);
+  pthread_mutex_unlock(&queue->mutex);
+}
+
+bool bq_is_closed(bq_t *queue) {
+  bool is_closed;
+  pthread_mutex_lock(&queue->mutex);
+  is_closed = queue->is_closed;
+  pthread_mutex_unlock(&queue->mutex);
+  return is_closed;
+}
+
+int bq_length(bq_t *queue) {
+  int len;
+  pthread_mutex_lock(&queue->mutex);
+  len = queue->len;
+  pthread_mutex_unlock(&queue->mutex);
+  return len;
+}
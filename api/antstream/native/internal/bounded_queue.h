@@ -0,0 +1,65 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BOUNDED_QUEUE_H__
+#define __BOUNDED_QUEUE_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+
+// Bounded FIFO queue between a producer thread and a consumer thread
+// What to do when an item is pushed into a full queue:
+typedef enum {
+  BQ_DROP_OLDEST = 0, // drop the oldest item in the queue
+  BQ_DROP_NEWEST = 1, // drop the pushed item
+  BQ_BLOCK = 2,       // wait until the consumer pops an item
+  BQ_COALESCE = 3     // keep only the latest item (capacity is 1)
+} bq_policy_t;
+
+// A blocked producer gives up and drops its item after this timeout, so that
+// a stalled consumer cannot block the producer forever.
+#define BQ_BLOCK_TIMEOUT_MS 1000
+
+typedef void (*bq_teardown_fn)(void *);
+
+typedef struct {
+  void **items;
+  int capacity;
+  int head;
+  int len;
+  bq_policy_t policy;
+  bool is_closed;
+  unsigned long num_dropped;
+  bq_teardown_fn item_teardown; // called with dropped or remaining items
+  pthread_mutex_t mutex;
+  pthread_cond_t not_full;
+} bq_t;
+
+bq_t *bq_new(int capacity, bq_policy_t policy, bq_teardown_fn item_teardown);
+// Free the queue and its remaining items
+void bq_delete(bq_t *queue);
+
+// Returns true if the item is enqueued. Otherwise, the item is dropped and
+// released by item_teardown.
+bool bq_push(bq_t *queue, void *item);
+// Returns NULL if the queue is empty
+void *bq_pop(bq_t *queue);
+
+// After closing, pushed items are dropped and blocked producers are woken up.
+void bq_close(bq_t *queue);
+bool bq_is_closed(bq_t *queue);
+int bq_length(bq_t *queue);
+
+#endif /* !defined(__BOUNDED_QUEUE_H__) */
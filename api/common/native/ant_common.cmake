@@ -0,0 +1,7 @@
+get_filename_component(ANT_COMMON_DIR ${CMAKE_CURRENT_LIST_FILE} DIRECTORY)
+
+# Shared by native modules: built once by the first module that includes it
+if(NOT TARGET ant_common)
+  add_subdirectory(${ANT_COMMON_DIR}/internal/ ${CMAKE_BINARY_DIR}/out/ant_common/)
+  list(APPEND EXTERNAL_LIBS ant_common)
+endif()
@@ -0,0 +1,383 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ant_async.h"
+
+// #define DEBUG_PRINT_ANT_ASYNC_NAME
+
+// ant_async list (JS thread only)
+static ant_async_t *g_ant_async_list = NULL;
+static void insert_ant_async_to_list(ant_async_t *ant_async) {
+  ant_async->next = g_ant_async_list;
+  g_ant_async_list = ant_async;
+}
+static bool has_name_prefix(ant_async_t *ant_async, const char *name_prefix) {
+  return strncmp(ant_async->name, name_prefix, strlen(name_prefix)) == 0;
+}
+void destroy_ant_asyncs(const char *name_prefix) {
+  ant_async_t **link = &g_ant_async_list;
+  while (*link != NULL) {
+    ant_async_t *ant_async = *link;
+    if (has_name_prefix(ant_async, name_prefix)) {
+      *link = ant_async->next;
+      destroy_ant_async(ant_async);
+    } else {
+      link = &ant_async->next;
+    }
+  }
+}
+
+// Per-wakeup time budget
+static unsigned int g_ant_async_budget_us = ANT_ASYNC_DEFAULT_BUDGET_US;
+void set_ant_async_budget(unsigned int budget_us) {
+  g_ant_async_budget_us = budget_us;
+}
+unsigned int get_ant_async_budget(void) { return g_ant_async_budget_us; }
+
+static uint64_t get_monotonic_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Completion of sync mode events
+// The sender waits on the futex without any per-event initialization. The
+// wakeup may reach an address that is no longer waited on, and it is
+// harmless since futex waiters always re-check the word.
+#define ANT_ASYNC_RESEND_TIMEOUT_SEC 1
+static void wait_ant_async_sync(ant_async_t *ant_async,
+                                ant_async_sync_t *sync) {
+  struct timespec timeout;
+  while (__atomic_load_n(&sync->is_done, __ATOMIC_ACQUIRE) == 0) {
+    // emit uv_async event again in case JS thread missed it
+    uv_async_send(&ant_async->uv_async);
+    timeout.tv_sec = ANT_ASYNC_RESEND_TIMEOUT_SEC;
+    timeout.tv_nsec = 0;
+    syscall(SYS_futex, &sync->is_done, FUTEX_WAIT_PRIVATE, 0, &timeout, NULL,
+            0);
+  }
+}
+static void complete_ant_async_sync(ant_async_sync_t *sync) {
+  __atomic_store_n(&sync->is_done, 1, __ATOMIC_RELEASE);
+  syscall(SYS_futex, &sync->is_done, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+// ant_async
+ant_async_t *create_ant_async(uv_async_cb uv_handler_fn,
+                              ant_async_destroyer_t event_queue_data_destroyer,
+                              const char *name, size_t queue_size) {
+  // ant_async
+  ant_async_t *ant_async = (ant_async_t *)malloc(sizeof(ant_async_t));
+  size_t i;
+
+  // ant_async->uv_async
+  iotjs_environment_t *env = iotjs_environment_get();
+  uv_loop_t *loop = iotjs_environment_loop(env);
+  uv_async_init(loop, &ant_async->uv_async, uv_handler_fn);
+
+  // ant_async->handler_map
+  ant_async->handler_map = hashmap_new();
+
+  // ant_async->event_queue and its node pool
+  ant_async->event_queue = lfr_new(queue_size);
+  queue_size = lfr_capacity(ant_async->event_queue);
+  ant_async->event_pool = lfr_new(queue_size);
+  ant_async->event_nodes =
+      (ant_async_event_t *)malloc(sizeof(ant_async_event_t) * queue_size);
+  for (i = 0; i < queue_size; i++) {
+    ant_async->event_nodes[i].is_pooled = true;
+    lfr_push(ant_async->event_pool, &ant_async->event_nodes[i]);
+  }
+  ant_async->event_data_destroyer = event_queue_data_destroyer;
+
+  // ant_async->metrics
+  memset(&ant_async->metrics, 0, sizeof(ant_async_metrics_t));
+  ant_async->delivery_start_ns = 0;
+
+  // ant_async->name
+  ant_async->name = (char *)malloc(strlen(name) + 1);
+  strncpy(ant_async->name, name, strlen(name) + 1);
+
+  insert_ant_async_to_list(ant_async);
+  return ant_async;
+}
+static int __destroy_handler_map_node(any_t not_used, any_t js_handler) {
+  jerry_release_value((jerry_value_t)js_handler);
+  return MAP_OK;
+}
+void destroy_ant_async(ant_async_t *ant_async) {
+  // ant_async->uv_async
+  uv_close((uv_handle_t *)&(ant_async->uv_async), NULL);
+
+  // ant_async->handler_map
+  hashmap_iterate(ant_async->handler_map, __destroy_handler_map_node, NULL);
+  hashmap_free(ant_async->handler_map);
+
+  // ant_async->event_queue
+  while (get_first_event_from_ant_async(ant_async) != NULL) {
+    remove_first_event_from_ant_async(ant_async);
+  }
+  lfr_delete(ant_async->event_queue);
+  lfr_delete(ant_async->event_pool);
+  free(ant_async->event_nodes);
+
+  // ant_async->name
+#ifdef DEBUG_PRINT_ANT_ASYNC_NAME
+  printf("Destroy ant async: %s\n", ant_async->name);
+#endif
+  free(ant_async->name);
+
+  // ant_async
+  free(ant_async);
+}
+bool add_js_handler_to_ant_async(ant_async_t *ant_async, int key,
+                                 jerry_value_t js_handler) {
+  // Remove if js_handler has already existed in the hashmap entry
+  jerry_value_t old_handler = get_js_handler_from_ant_async(ant_async, key);
+  if (!jerry_value_is_undefined(old_handler)) {
+    remove_js_handler_from_ant_async(ant_async, key);
+  }
+
+  jerry_acquire_value(js_handler);
+  return (hashmap_put(ant_async->handler_map, (unsigned int)key,
+                      (any_t)js_handler) == MAP_OK);
+}
+bool remove_js_handler_from_ant_async(ant_async_t *ant_async, int key) {
+  jerry_value_t js_handler;
+  int res = hashmap_get(ant_async->handler_map, (unsigned int)key,
+                        (any_t *)&js_handler);
+  if (res != MAP_OK)
+    return false;
+  jerry_release_value(js_handler);
+  return (hashmap_remove(ant_async->handler_map, (unsigned int)key) == MAP_OK);
+}
+jerry_value_t get_js_handler_from_ant_async(ant_async_t *ant_async, int key) {
+  jerry_value_t js_handler;
+  int res = hashmap_get(ant_async->handler_map, (unsigned int)key,
+                        (any_t *)&js_handler);
+  if (res != MAP_OK)
+    return jerry_create_undefined();
+  return js_handler;
+}
+bool emit_ant_async_event(ant_async_t *ant_async, int key, void *event_data,
+                          bool sync_mode) {
+  // acquire ant_async_event
+  ant_async_event_t *ant_async_event =
+      acquire_ant_async_event(ant_async, key, event_data);
+  ant_async_sync_t sync;
+  if (ant_async_event == NULL) {
+    if (ant_async->event_data_destroyer != NULL)
+      ant_async->event_data_destroyer(event_data);
+    return false;
+  }
+
+  if (!sync_mode) {
+    // async mode: do not wait JS thread's processing
+    enqueue_event_to_ant_async(ant_async, ant_async_event);
+    uv_async_send(&ant_async->uv_async);
+    return true;
+  }
+
+  // sync mode: wait until JS thread removes the event.
+  sync.is_done = 0;
+  ant_async_event->sync = &sync;
+  enqueue_event_to_ant_async(ant_async, ant_async_event);
+  wait_ant_async_sync(ant_async, &sync);
+  return true;
+}
+bool try_emit_ant_async_event(ant_async_t *ant_async, int key,
+                              void *event_data) {
+  ant_async_event_t *ant_async_event =
+      acquire_ant_async_event(ant_async, key, event_data);
+  if (ant_async_event != NULL) {
+    // Counted before the push, so that the queue depth never underflows
+    ant_async_event->emit_time_ns = get_monotonic_time_ns();
+    __atomic_fetch_add(&ant_async->metrics.emitted, 1, __ATOMIC_RELAXED);
+    if (lfr_push(ant_async->event_queue, (void *)ant_async_event)) {
+      uv_async_send(&ant_async->uv_async);
+      return true;
+    }
+    __atomic_fetch_sub(&ant_async->metrics.emitted, 1, __ATOMIC_RELAXED);
+    release_ant_async_event(ant_async, ant_async_event);
+  }
+
+  // The queue is full: drop the event
+  __atomic_fetch_add(&ant_async->metrics.dropped, 1, __ATOMIC_RELAXED);
+  if (ant_async->event_data_destroyer != NULL)
+    ant_async->event_data_destroyer(event_data);
+  return false;
+}
+
+// event_queue in ant_handler
+void enqueue_event_to_ant_async(ant_async_t *ant_async,
+                                ant_async_event_t *ant_async_event) {
+  if (ant_async_event == NULL)
+    return;
+  ant_async_event->emit_time_ns = get_monotonic_time_ns();
+  __atomic_fetch_add(&ant_async->metrics.emitted, 1, __ATOMIC_RELAXED);
+  while (!lfr_push(ant_async->event_queue, (void *)ant_async_event)) {
+    // The queue is full: wait for JS thread to drain it
+    uv_async_send(&ant_async->uv_async);
+    usleep(100);
+  }
+}
+ant_async_event_t *get_first_event_from_ant_async(ant_async_t *ant_async) {
+  ant_async_event_t *ant_async_event =
+      (ant_async_event_t *)lfr_peek(ant_async->event_queue);
+  if (ant_async_event != NULL)
+    ant_async->delivery_start_ns = get_monotonic_time_ns();
+  return ant_async_event;
+}
+uint64_t start_ant_async_drain(void) { return get_monotonic_time_ns(); }
+ant_async_event_t *get_next_event_from_ant_async(ant_async_t *ant_async,
+                                                 uint64_t drain_start_ns) {
+  ant_async_event_t *ant_async_event =
+      get_first_event_from_ant_async(ant_async);
+  uint64_t elapsed_ns;
+  if (ant_async_event == NULL || g_ant_async_budget_us == 0)
+    return ant_async_event;
+
+  elapsed_ns = ant_async->delivery_start_ns - drain_start_ns;
+  if (elapsed_ns >= (uint64_t)g_ant_async_budget_us * 1000ULL) {
+    // Yield to the loop, and deliver the rest on the next iteration
+    uv_async_send(&ant_async->uv_async);
+    return NULL;
+  }
+  return ant_async_event;
+}
+static void update_ant_async_metrics(ant_async_t *ant_async,
+                                     ant_async_event_t *ant_async_event) {
+  ant_async_metrics_t *metrics = &ant_async->metrics;
+  uint64_t now_ns = get_monotonic_time_ns();
+  uint64_t latency_ns =
+      ant_async->delivery_start_ns - ant_async_event->emit_time_ns;
+  uint64_t handler_time_ns = now_ns - ant_async->delivery_start_ns;
+  uint64_t queue_depth =
+      __atomic_load_n(&metrics->emitted, __ATOMIC_RELAXED) -
+      metrics->delivered;
+
+  if (queue_depth > metrics->queue_depth_max)
+    metrics->queue_depth_max = (uint32_t)queue_depth;
+  metrics->delivered++;
+  metrics->latency_sum_ns += latency_ns;
+  if (latency_ns > metrics->latency_max_ns)
+    metrics->latency_max_ns = latency_ns;
+  metrics->handler_time_sum_ns += handler_time_ns;
+  if (handler_time_ns > metrics->handler_time_max_ns)
+    metrics->handler_time_max_ns = handler_time_ns;
+}
+void remove_first_event_from_ant_async(ant_async_t *ant_async) {
+  ant_async_event_t *ant_async_event =
+      (ant_async_event_t *)lfr_pop(ant_async->event_queue);
+  ant_async_sync_t *sync;
+  if (ant_async_event == NULL)
+    return;
+
+  update_ant_async_metrics(ant_async, ant_async_event);
+  if (ant_async->event_data_destroyer != NULL) {
+    ant_async->event_data_destroyer(ant_async_event->data);
+  }
+  sync = ant_async_event->sync;
+  release_ant_async_event(ant_async, ant_async_event);
+
+  // wake up ant_async sender thread
+  if (sync != NULL) {
+    complete_ant_async_sync(sync);
+  }
+}
+
+// ant_event
+ant_async_event_t *acquire_ant_async_event(ant_async_t *ant_async, int key,
+                                           void *data) {
+  ant_async_event_t *ant_async_event =
+      (ant_async_event_t *)lfr_pop(ant_async->event_pool);
+  if (ant_async_event == NULL) {
+    // The pool is exhausted
+    ant_async_event = (ant_async_event_t *)malloc(sizeof(ant_async_event_t));
+    if (ant_async_event == NULL)
+      return NULL;
+    ant_async_event->is_pooled = false;
+  }
+  ant_async_event->key = key;
+  ant_async_event->data = data;
+  ant_async_event->sync = NULL;
+  return ant_async_event;
+}
+void release_ant_async_event(ant_async_t *ant_async,
+                             ant_async_event_t *ant_async_event) {
+  if (ant_async_event->is_pooled) {
+    // The pool has room for all the pooled nodes
+    lfr_push(ant_async->event_pool, (void *)ant_async_event);
+  } else {
+    free(ant_async_event);
+  }
+}
+
+// Metrics
+static double ns_to_us(uint64_t ns) { return (double)ns / 1000.0; }
+static double average_us(uint64_t sum_ns, uint64_t count) {
+  return (count > 0) ? ns_to_us(sum_ns) / (double)count : 0.0;
+}
+static jerry_value_t create_js_metrics_item(ant_async_t *ant_async) {
+  ant_async_metrics_t *metrics = &ant_async->metrics;
+  jerry_value_t js_item = jerry_create_object();
+  uint64_t emitted = __atomic_load_n(&metrics->emitted, __ATOMIC_RELAXED);
+  uint64_t dropped = __atomic_load_n(&metrics->dropped, __ATOMIC_RELAXED);
+  jerry_value_t js_name =
+      jerry_create_string((const jerry_char_t *)ant_async->name);
+
+  iotjs_jval_set_property_jval(js_item, "name", js_name);
+  jerry_release_value(js_name);
+  iotjs_jval_set_property_number(js_item, "queueDepth",
+                                 (double)(emitted - metrics->delivered));
+  iotjs_jval_set_property_number(js_item, "queueDepthMax",
+                                 (double)metrics->queue_depth_max);
+  iotjs_jval_set_property_number(js_item, "emitted", (double)emitted);
+  iotjs_jval_set_property_number(js_item, "dropped", (double)dropped);
+  iotjs_jval_set_property_number(js_item, "delivered",
+                                 (double)metrics->delivered);
+  iotjs_jval_set_property_number(
+      js_item, "latencyAvgUs",
+      average_us(metrics->latency_sum_ns, metrics->delivered));
+  iotjs_jval_set_property_number(js_item, "latencyMaxUs",
+                                 ns_to_us(metrics->latency_max_ns));
+  iotjs_jval_set_property_number(
+      js_item, "handlerTimeAvgUs",
+      average_us(metrics->handler_time_sum_ns, metrics->delivered));
+  iotjs_jval_set_property_number(js_item, "handlerTimeMaxUs",
+                                 ns_to_us(metrics->handler_time_max_ns));
+  return js_item;
+}
+jerry_value_t create_js_ant_async_metrics(const char *name_prefix) {
+  jerry_value_t js_metrics = jerry_create_array(0);
+  uint32_t index = 0;
+  ant_async_t *ant_async;
+  for (ant_async = g_ant_async_list; ant_async != NULL;
+       ant_async = ant_async->next) {
+    jerry_value_t js_item;
+    if (!has_name_prefix(ant_async, name_prefix))
+      continue;
+    js_item = create_js_metrics_item(ant_async);
+    iotjs_jval_set_property_by_index(js_metrics, index++, js_item);
+    jerry_release_value(js_item);
+  }
+  return js_metrics;
+}
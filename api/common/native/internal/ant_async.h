@@ -0,0 +1,247 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ANT_ASYNC_H__
+#define __ANT_ASYNC_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <iotjs_def.h>
+#include <iotjs_uv_request.h>
+#include <modules/iotjs_module_buffer.h>
+
+#include "./hashmap.h"
+#include "./lf_ring.h"
+
+// ANT async: native-to-JS event bridge shared by native modules
+// Each ant_async is a channel of events of one type (e.g.
+// ocf_adapter_discovery) with its own event queue, JS handlers (by key),
+// payload destroyer and metrics.
+//
+// ANT async handler procedure:
+// 1. [External thread]
+//    an event occurs -> type_ant_handler() -> uv_async_send()
+// 2. [JS thread]
+//    uv async event occurs -> type_uv_handler() -> g_type_async.js_handler()
+
+// Event queue of an ant_async
+// Events are passed through a bounded lock-free ring from external threads
+// (multiple producers) to JS thread (single consumer). Event nodes are taken
+// from a lock-free pool of the same size, and they are allocated only when
+// the pool is exhausted. If the ring is full, the producer of emit() waits
+// until JS thread drains it, so events must not be emitted on JS thread.
+// try_emit() drops the event instead, for threads that JS thread may wait
+// for.
+#define ANT_ASYNC_EVENT_QUEUE_SIZE 256
+
+// Per-wakeup time budget
+// A uv handler drains events until the budget of the wakeup runs out, and the
+// rest of the events are delivered on the next loop iteration. It keeps a
+// burst of events from starving timers and I/O of the loop. At least one
+// event is delivered per wakeup. 0 means no budget.
+#define ANT_ASYNC_DEFAULT_BUDGET_US 10000
+
+typedef void (*ant_async_destroyer_t)(void *);
+
+// Metrics of an ant_async
+// Counters of emitters are updated atomically, and the others are updated
+// only on JS thread.
+// - latency: from emit to the start of its delivery
+// - handler time: from the start of its delivery to its removal
+typedef struct {
+  uint64_t emitted;
+  uint64_t dropped;
+  uint64_t delivered;
+  uint32_t queue_depth_max;
+  uint64_t latency_sum_ns;
+  uint64_t latency_max_ns;
+  uint64_t handler_time_sum_ns;
+  uint64_t handler_time_max_ns;
+} ant_async_metrics_t;
+
+struct ant_async_event_s;
+struct ant_async_s {
+  // libuv async
+  uv_async_t uv_async;
+
+  // js_handler map
+  map_t handler_map;
+
+  // event_queue and event node pool
+  lfr_t *event_queue;
+  lfr_t *event_pool;
+  struct ant_async_event_s *event_nodes;
+  ant_async_destroyer_t event_data_destroyer;
+
+  // metrics
+  ant_async_metrics_t metrics;
+  uint64_t delivery_start_ns;
+
+  char *name;
+  struct ant_async_s *next; // ant_async list
+};
+typedef struct ant_async_s ant_async_t;
+
+// Completion of a sync mode event. It is on the stack of the sender, and the
+// sender sleeps on the futex until JS thread completes its own event.
+struct ant_async_sync_s {
+  uint32_t is_done; // futex word: 0 -> 1
+};
+typedef struct ant_async_sync_s ant_async_sync_t;
+
+struct ant_async_event_s {
+  int key;
+  void *data;
+  uint64_t emit_time_ns;
+
+  bool is_pooled;
+  ant_async_sync_t *sync; // NULL in async mode
+};
+typedef struct ant_async_event_s ant_async_event_t;
+
+// ant_async list
+// All the ant_asyncs are listed for metrics. They are created and destroyed
+// on JS thread. destroy_ant_asyncs() destroys the ant_asyncs whose names
+// start with the prefix (e.g. "ocf_").
+void destroy_ant_asyncs(const char *name_prefix);
+
+// Per-wakeup time budget of all the ant_asyncs
+void set_ant_async_budget(unsigned int budget_us);
+unsigned int get_ant_async_budget(void);
+
+// ant_async
+ant_async_t *create_ant_async(uv_async_cb uv_handler_fn,
+                              ant_async_destroyer_t event_queue_data_destroyer,
+                              const char *name, size_t queue_size);
+void destroy_ant_async(ant_async_t *ant_async);
+bool add_js_handler_to_ant_async(ant_async_t *ant_async, int key,
+                                 jerry_value_t js_handler);
+bool remove_js_handler_from_ant_async(ant_async_t *ant_async, int key);
+jerry_value_t get_js_handler_from_ant_async(ant_async_t *ant_async, int key);
+// In sync mode, it returns after JS thread removes the event.
+bool emit_ant_async_event(ant_async_t *ant_async, int key, void *event_data,
+                          bool sync_mode);
+// It never blocks. If the queue is full, the event data is destroyed and it
+// returns false.
+bool try_emit_ant_async_event(ant_async_t *ant_async, int key,
+                              void *event_data);
+
+// event_queue in ant_async
+void enqueue_event_to_ant_async(ant_async_t *ant_async,
+                                ant_async_event_t *ant_async_event);
+// On JS thread: get_first_event_from_ant_async() peeks the first event, and
+// remove_first_event_from_ant_async() destroys its data, wakes up its sync
+// mode sender, and returns its node to the pool.
+ant_async_event_t *get_first_event_from_ant_async(ant_async_t *ant_async);
+void remove_first_event_from_ant_async(ant_async_t *ant_async);
+// On JS thread: a uv handler starts a drain, and then gets events until it
+// returns NULL. If the budget runs out before the queue is empty, it returns
+// NULL and schedules another wakeup for the rest.
+uint64_t start_ant_async_drain(void);
+ant_async_event_t *get_next_event_from_ant_async(ant_async_t *ant_async,
+                                                 uint64_t drain_start_ns);
+
+// ant_event
+ant_async_event_t *acquire_ant_async_event(ant_async_t *ant_async, int key,
+                                           void *data);
+void release_ant_async_event(ant_async_t *ant_async,
+                             ant_async_event_t *ant_async_event);
+
+// Metrics of the ant_asyncs whose names start with the prefix, as an array of
+//   { name, queueDepth, queueDepthMax, emitted, dropped, delivered,
+//     latencyAvgUs, latencyMaxUs, handlerTimeAvgUs, handlerTimeMaxUs }
+jerry_value_t create_js_ant_async_metrics(const char *name_prefix);
+
+/** declaration macros **/
+#define ANT_ASYNC(type) g_##type##_async
+#define ANT_ASYNC_DECL(type) ant_async_t *ANT_ASYNC(type);
+
+#define REGISTER_JS_HANDLER_FUNC(type, event_queue_item_destroyer)             \
+  bool register_js_handler_for_##type(int key, jerry_value_t js_handler) {     \
+    bool res = add_js_handler_to_ant_async(ANT_ASYNC(type), key, js_handler);  \
+    return res;                                                                \
+  }
+#define REGISTER_JS_HANDLER_FDECL(type)                                        \
+  bool register_js_handler_for_##type(int key, jerry_value_t js_handler);
+#define UNREGISTER_JS_HANDLER_FUNC(type)                                       \
+  bool unregister_js_handler_for_##type(int key) {                             \
+    return remove_js_handler_from_ant_async(ANT_ASYNC(type), key);             \
+  }
+#define UNREGISTER_JS_HANDLER_FDECL(type)                                      \
+  bool unregister_js_handler_for_##type(int key);
+
+#define EMIT_ANT_ASYNC_EVENT_FUNC(type)                                        \
+  bool emit_ant_async_event_for_##type(int key, void *event_data,              \
+                                       bool sync_mode) {                       \
+    return emit_ant_async_event(ANT_ASYNC(type), key, event_data, sync_mode);  \
+  }
+#define EMIT_ANT_ASYNC_EVENT_FDECL(type)                                       \
+  bool emit_ant_async_event_for_##type(int key, void *event_data,              \
+                                       bool sync_mode)
+#define TRY_EMIT_ANT_ASYNC_EVENT_FUNC(type)                                    \
+  bool try_emit_ant_async_event_for_##type(int key, void *event_data) {        \
+    return try_emit_ant_async_event(ANT_ASYNC(type), key, event_data);         \
+  }
+#define TRY_EMIT_ANT_ASYNC_EVENT_FDECL(type)                                   \
+  bool try_emit_ant_async_event_for_##type(int key, void *event_data)
+
+#define ANT_ASYNC_DECL_FUNCS(type, event_queue_item_destroyer)                 \
+  ANT_ASYNC_DECL(type)                                                         \
+  REGISTER_JS_HANDLER_FUNC(type, event_queue_item_destroyer)                   \
+  UNREGISTER_JS_HANDLER_FUNC(type)                                             \
+  EMIT_ANT_ASYNC_EVENT_FUNC(type)                                              \
+  TRY_EMIT_ANT_ASYNC_EVENT_FUNC(type)
+#define ANT_ASYNC_DECL_IN_HEADER(type)                                         \
+  REGISTER_JS_HANDLER_FDECL(type);                                             \
+  UNREGISTER_JS_HANDLER_FDECL(type);                                           \
+  EMIT_ANT_ASYNC_EVENT_FDECL(type);                                            \
+  TRY_EMIT_ANT_ASYNC_EVENT_FDECL(type);
+
+#define ANT_UV_HANDLER_FUNCTION(type)                                          \
+  static void uv_handler_for_##type(uv_async_t *handle)
+/** declaration macros (end) **/
+
+/** function-call macros **/
+#define INIT_ANT_ASYNC(type, event_queue_data_destroyer)                       \
+  INIT_ANT_ASYNC_WITH_QUEUE_SIZE(type, event_queue_data_destroyer,             \
+                                 ANT_ASYNC_EVENT_QUEUE_SIZE)
+#define INIT_ANT_ASYNC_WITH_QUEUE_SIZE(type, event_queue_data_destroyer,       \
+                                       queue_size)                             \
+  ANT_ASYNC(type) = create_ant_async(                                          \
+      uv_handler_for_##type, event_queue_data_destroyer, #type, queue_size);
+#define REGISTER_JS_HANDLER(type, key, js_handler)                             \
+  register_js_handler_for_##type(key, js_handler)
+
+#define EMIT_ANT_ASYNC_EVENT(type, key, event_data, sync_mode)                 \
+  emit_ant_async_event_for_##type(key, event_data, sync_mode)
+#define TRY_EMIT_ANT_ASYNC_EVENT(type, key, event_data)                        \
+  try_emit_ant_async_event_for_##type(key, event_data)
+
+#define GET_FIRST_EVENT_FROM_ANT_ASYNC(type)                                   \
+  get_first_event_from_ant_async(ANT_ASYNC(type))
+#define START_ANT_ASYNC_DRAIN() start_ant_async_drain()
+#define GET_NEXT_EVENT_FROM_ANT_ASYNC(type, drain_start_ns)                    \
+  get_next_event_from_ant_async(ANT_ASYNC(type), drain_start_ns)
+#define GET_JS_HANDLER_FROM_ANT_ASYNC(type, key)                               \
+  get_js_handler_from_ant_async(ANT_ASYNC(type), key)
+#define REMOVE_FIRST_EVENT_FROM_ANT_ASYNC(type)                                \
+  remove_first_event_from_ant_async(ANT_ASYNC(type))
+#define UNREGISTER_JS_HANDLER(type, key) unregister_js_handler_for_##type(key)
+/** function-call macros (end) **/
+
+#endif /* !defined(__ANT_ASYNC_H__) */
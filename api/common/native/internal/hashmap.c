@@ -0,0 +1,371 @@
+/* Copyright (c) 2015 Matthew Johnston. All rights reserved.
+ *
+ * See: https://gist.github.com/warmwaffles/6fb6786be7c86ed51fce
+ *
+ * Generic map implementation. This class is thread-safe.
+ * free() must be invoked when only one thread has access to the hashmap.
+ *
+ * The map is an open-addressing table of power-of-two size with linear
+ * probing. Writers (put, remove, get_one, iterate) are serialized by a mutex,
+ * while get() does not take any lock, so the OCF thread can look up handlers
+ * while JS thread is adding or removing them.
+ *  - A slot is published by storing its data first, and then its tag
+ *    (state and key) with release order. Removal leaves a tombstone, so that
+ *    the probe sequences of readers are never broken.
+ *  - Growing or purging tombstones builds a new table, and swaps the table
+ *    pointer. The old table is freed after no reader is in the map.
+ */
+
+#include "./hashmap.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INITIAL_SIZE 64
+
+// Slot states are kept in the upper half of the tag
+#define SLOT_EMPTY 0ULL
+#define SLOT_FULL 1ULL
+#define SLOT_TOMBSTONE 2ULL
+#define SLOT_TAG(state, key) (((state) << 32) | (uint64_t)(key))
+#define SLOT_STATE(tag) ((tag) >> 32)
+#define SLOT_KEY(tag) ((unsigned int)((tag)&0xffffffffULL))
+
+// We need to keep keys and values
+typedef struct _hashmap_element {
+  uint64_t tag;
+  any_t data;
+} hashmap_element;
+
+typedef struct _hashmap_table {
+  unsigned int mask;
+  unsigned int shift;
+  int used; // full and tombstone slots
+  struct _hashmap_table *retired_next;
+  hashmap_element data[];
+} hashmap_table;
+
+// A hashmap has a table and current size.
+// Old tables are retired until no reader can see them.
+typedef struct _hashmap_map {
+  hashmap_table *table;
+  int size;
+  int readers;
+  hashmap_table *retired;
+  pthread_mutex_t lock;
+} hashmap_map;
+
+static hashmap_table *hashmap_table_new(unsigned int table_size) {
+  hashmap_table *t = (hashmap_table *)calloc(
+      1, sizeof(hashmap_table) + sizeof(hashmap_element) * table_size);
+  unsigned int bits = 0;
+  if (!t)
+    return NULL;
+  while ((1U << bits) < table_size)
+    bits++;
+  t->mask = table_size - 1;
+  t->shift = 32 - bits;
+  t->used = 0;
+  t->retired_next = NULL;
+  return t;
+}
+
+/*
+ * Return an empty hashmap, or NULL on failure.
+ */
+map_t hashmap_new() {
+  hashmap_map *m = (hashmap_map *)malloc(sizeof(hashmap_map));
+  if (!m)
+    return NULL;
+
+  m->table = hashmap_table_new(INITIAL_SIZE);
+  if (!m->table) {
+    free(m);
+    return NULL;
+  }
+
+  pthread_mutex_init(&m->lock, NULL);
+  m->size = 0;
+  m->readers = 0;
+  m->retired = NULL;
+
+  return m;
+}
+
+/*
+ * Hashing function for an integer
+ */
+static inline unsigned int hashmap_hash_int(hashmap_table *t,
+                                            unsigned int key) {
+  /* Knuth's Multiplicative Method, taking the upper bits */
+  return (unsigned int)((key * 2654435769U) >> t->shift) & t->mask;
+}
+
+/*
+ * Free the retired tables if no reader is in the map. Called with the lock.
+ */
+static void hashmap_reclaim(hashmap_map *m) {
+  hashmap_table *t;
+  if (m->retired == NULL || __atomic_load_n(&m->readers, __ATOMIC_SEQ_CST) > 0)
+    return;
+  while (m->retired != NULL) {
+    t = m->retired;
+    m->retired = t->retired_next;
+    free(t);
+  }
+}
+
+/*
+ * Return the slot of the key, or the slot to put the key into.
+ * Called with the lock.
+ */
+static hashmap_element *hashmap_find_slot(hashmap_table *t, unsigned int key) {
+  hashmap_element *reusable = NULL;
+  unsigned int curr = hashmap_hash_int(t, key);
+  unsigned int i;
+
+  /* Linear probing */
+  for (i = 0; i <= t->mask; i++) {
+    hashmap_element *e = &t->data[curr];
+    uint64_t state = SLOT_STATE(e->tag);
+    if (state == SLOT_EMPTY)
+      return (reusable != NULL) ? reusable : e;
+    if (state == SLOT_FULL && SLOT_KEY(e->tag) == key)
+      return e;
+    if (state == SLOT_TOMBSTONE && reusable == NULL)
+      reusable = e;
+    curr = (curr + 1) & t->mask;
+  }
+  return reusable;
+}
+
+/*
+ * Build a new table of the given size without tombstones, and publish it.
+ * Called with the lock.
+ */
+static int hashmap_rehash(hashmap_map *m, unsigned int table_size) {
+  hashmap_table *old_table = m->table;
+  hashmap_table *new_table = hashmap_table_new(table_size);
+  unsigned int i;
+  if (!new_table)
+    return MAP_OMEM;
+
+  for (i = 0; i <= old_table->mask; i++) {
+    hashmap_element *e = &old_table->data[i];
+    if (SLOT_STATE(e->tag) == SLOT_FULL) {
+      hashmap_element *slot = hashmap_find_slot(new_table, SLOT_KEY(e->tag));
+      slot->data = e->data;
+      slot->tag = e->tag;
+      new_table->used++;
+    }
+  }
+
+  __atomic_store_n(&m->table, new_table, __ATOMIC_SEQ_CST);
+  old_table->retired_next = m->retired;
+  m->retired = old_table;
+  hashmap_reclaim(m);
+  return MAP_OK;
+}
+
+/*
+ * Add a pointer to the hashmap with some key
+ */
+int hashmap_put(map_t in, unsigned int key, any_t value) {
+  hashmap_map *m = (hashmap_map *)in;
+  hashmap_table *t;
+  hashmap_element *slot;
+  uint64_t tag;
+
+  /* Lock for concurrency */
+  pthread_mutex_lock(&m->lock);
+
+  /* Keep the load factor of full and tombstone slots under 3/4 */
+  t = m->table;
+  if ((unsigned int)(t->used + 1) * 4 > (t->mask + 1) * 3) {
+    unsigned int table_size = t->mask + 1;
+    if ((unsigned int)(m->size + 1) * 2 > table_size)
+      table_size *= 2;
+    if (hashmap_rehash(m, table_size) != MAP_OK) {
+      pthread_mutex_unlock(&m->lock);
+      return MAP_OMEM;
+    }
+    t = m->table;
+  }
+
+  /* Find a place to put our value */
+  slot = hashmap_find_slot(t, key);
+  tag = slot->tag;
+  __atomic_store_n(&slot->data, value, __ATOMIC_RELEASE);
+  if (SLOT_STATE(tag) != SLOT_FULL) {
+    if (SLOT_STATE(tag) == SLOT_EMPTY)
+      t->used++;
+    __atomic_store_n(&slot->tag, SLOT_TAG(SLOT_FULL, key), __ATOMIC_RELEASE);
+    __atomic_store_n(&m->size, m->size + 1, __ATOMIC_RELAXED);
+  }
+
+  /* Unlock */
+  pthread_mutex_unlock(&m->lock);
+
+  return MAP_OK;
+}
+
+/*
+ * Get your pointer out of the hashmap with a key. It does not take the lock.
+ */
+int hashmap_get(map_t in, unsigned int key, any_t *arg) {
+  hashmap_map *m = (hashmap_map *)in;
+  hashmap_table *t;
+  unsigned int curr;
+  unsigned int i;
+  int result = MAP_MISSING;
+  uint64_t want = SLOT_TAG(SLOT_FULL, key);
+
+  *arg = NULL;
+
+  /* Pin the table against reclamation */
+  __atomic_fetch_add(&m->readers, 1, __ATOMIC_SEQ_CST);
+  t = __atomic_load_n(&m->table, __ATOMIC_SEQ_CST);
+
+  /* Linear probing, until an empty slot */
+  curr = hashmap_hash_int(t, key);
+  for (i = 0; i <= t->mask; i++) {
+    hashmap_element *e = &t->data[curr];
+    uint64_t tag = __atomic_load_n(&e->tag, __ATOMIC_ACQUIRE);
+    if (tag == want) {
+      any_t data = __atomic_load_n(&e->data, __ATOMIC_ACQUIRE);
+      // The slot might have been removed while reading the data
+      if (__atomic_load_n(&e->tag, __ATOMIC_ACQUIRE) == want) {
+        *arg = data;
+        result = MAP_OK;
+      }
+      break;
+    }
+    if (SLOT_STATE(tag) == SLOT_EMPTY)
+      break;
+    curr = (curr + 1) & t->mask;
+  }
+
+  __atomic_fetch_sub(&m->readers, 1, __ATOMIC_SEQ_CST);
+  return result;
+}
+
+/*
+ * Get a random element from the hashmap
+ */
+int hashmap_get_one(map_t in, any_t *arg, int remove) {
+  hashmap_map *m = (hashmap_map *)in;
+  hashmap_table *t;
+  unsigned int i;
+
+  /* On empty hashmap return immediately */
+  if (hashmap_length(m) <= 0)
+    return MAP_MISSING;
+
+  /* Lock for concurrency */
+  pthread_mutex_lock(&m->lock);
+
+  t = m->table;
+  for (i = 0; i <= t->mask; i++) {
+    hashmap_element *e = &t->data[i];
+    if (SLOT_STATE(e->tag) == SLOT_FULL) {
+      *arg = e->data;
+      if (remove) {
+        __atomic_store_n(&e->tag, SLOT_TAG(SLOT_TOMBSTONE, 0),
+                         __ATOMIC_RELEASE);
+        __atomic_store_n(&m->size, m->size - 1, __ATOMIC_RELAXED);
+      }
+      break;
+    }
+  }
+
+  /* Unlock */
+  pthread_mutex_unlock(&m->lock);
+
+  return MAP_OK;
+}
+
+/*
+ * Iterate the function parameter over each element in the hashmap.  The
+ * additional any_t argument is passed to the function as its first
+ * argument and the hashmap element is the second.
+ */
+int hashmap_iterate(map_t in, PFany f, any_t item) {
+  hashmap_map *m = (hashmap_map *)in;
+  hashmap_table *t;
+  unsigned int i;
+
+  /* On empty hashmap, return immediately */
+  if (hashmap_length(m) <= 0)
+    return MAP_MISSING;
+
+  /* Lock for concurrency */
+  pthread_mutex_lock(&m->lock);
+
+  t = m->table;
+  for (i = 0; i <= t->mask; i++) {
+    hashmap_element *e = &t->data[i];
+    if (SLOT_STATE(e->tag) == SLOT_FULL) {
+      int status = f(item, e->data);
+      if (status != MAP_OK) {
+        pthread_mutex_unlock(&m->lock);
+        return status;
+      }
+    }
+  }
+
+  /* Unlock */
+  pthread_mutex_unlock(&m->lock);
+
+  return MAP_OK;
+}
+
+/*
+ * Remove an element with that key from the map
+ */
+int hashmap_remove(map_t in, unsigned int key) {
+  hashmap_map *m = (hashmap_map *)in;
+  hashmap_element *slot;
+  int result = MAP_MISSING;
+
+  /* Lock for concurrency */
+  pthread_mutex_lock(&m->lock);
+
+  slot = hashmap_find_slot(m->table, key);
+  if (slot != NULL && slot->tag == SLOT_TAG(SLOT_FULL, key)) {
+    /* Leave a tombstone; the data is kept for racing readers */
+    __atomic_store_n(&slot->tag, SLOT_TAG(SLOT_TOMBSTONE, 0),
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&m->size, m->size - 1, __ATOMIC_RELAXED);
+    result = MAP_OK;
+  }
+  hashmap_reclaim(m);
+
+  /* Unlock */
+  pthread_mutex_unlock(&m->lock);
+
+  return result;
+}
+
+/* Deallocate the hashmap */
+void hashmap_free(map_t in) {
+  hashmap_map *m = (hashmap_map *)in;
+  while (m->retired != NULL) {
+    hashmap_table *t = m->retired;
+    m->retired = t->retired_next;
+    free(t);
+  }
+  free(m->table);
+  pthread_mutex_destroy(&m->lock);
+  free(m);
+}
+
+/* Return the length of the hashmap */
+int hashmap_length(map_t in) {
+  hashmap_map *m = (hashmap_map *)in;
+  if (m != NULL)
+    return __atomic_load_n(&m->size, __ATOMIC_RELAXED);
+  else
+    return 0;
+}
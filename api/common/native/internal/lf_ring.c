@@ -0,0 +1,122 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "lf_ring.h"
+
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CAS_WEAK(p, expected, desired)                                         \
+  __atomic_compare_exchange_n((p), (expected), (desired), true,                \
+                              __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+
+lfr_t *lfr_new(size_t capacity) {
+  lfr_t *ring;
+  size_t size = 2;
+  size_t i;
+
+  while (size < capacity) {
+    size <<= 1;
+  }
+  if (posix_memalign((void **)&ring, 64, sizeof(lfr_t)) != 0)
+    return NULL;
+  ring->cells = (lfr_cell_t *)malloc(sizeof(lfr_cell_t) * size);
+  if (ring->cells == NULL) {
+    free(ring);
+    return NULL;
+  }
+  for (i = 0; i < size; i++) {
+    ring->cells[i].sequence = i;
+    ring->cells[i].item = NULL;
+  }
+  ring->mask = size - 1;
+  ring->push_position = 0;
+  ring->pop_position = 0;
+  return ring;
+}
+
+void lfr_delete(lfr_t *ring) {
+  if (ring == NULL)
+    return;
+  free(ring->cells);
+  free(ring);
+}
+
+bool lfr_push(lfr_t *ring, void *item) {
+  size_t position = LOAD_RELAXED(&ring->push_position);
+  lfr_cell_t *cell;
+  for (;;) {
+    intptr_t diff;
+    cell = &ring->cells[position & ring->mask];
+    diff = (intptr_t)LOAD_ACQUIRE(&cell->sequence) - (intptr_t)position;
+    if (diff == 0) {
+      // The cell is free at this position: take it
+      if (CAS_WEAK(&ring->push_position, &position, position + 1))
+        break;
+    } else if (diff < 0) {
+      // The cell is not yet popped since the last round
+      return false;
+    } else {
+      // Another producer has taken the cell
+      position = LOAD_RELAXED(&ring->push_position);
+    }
+  }
+  cell->item = item;
+  STORE_RELEASE(&cell->sequence, position + 1);
+  return true;
+}
+
+void *lfr_pop(lfr_t *ring) {
+  size_t position = LOAD_RELAXED(&ring->pop_position);
+  lfr_cell_t *cell;
+  void *item;
+  for (;;) {
+    intptr_t diff;
+    cell = &ring->cells[position & ring->mask];
+    diff = (intptr_t)LOAD_ACQUIRE(&cell->sequence) - (intptr_t)(position + 1);
+    if (diff == 0) {
+      if (CAS_WEAK(&ring->pop_position, &position, position + 1))
+        break;
+    } else if (diff < 0) {
+      // The cell is not yet pushed
+      return NULL;
+    } else {
+      position = LOAD_RELAXED(&ring->pop_position);
+    }
+  }
+  item = cell->item;
+  // The cell becomes free for the next round
+  STORE_RELEASE(&cell->sequence, position + ring->mask + 1);
+  return item;
+}
+
+void *lfr_peek(lfr_t *ring) {
+  size_t position = LOAD_RELAXED(&ring->pop_position);
+  lfr_cell_t *cell = &ring->cells[position & ring->mask];
+  if (LOAD_ACQUIRE(&cell->sequence) != position + 1)
+    return NULL;
+  return cell->item;
+}
+
+bool lfr_is_empty(lfr_t *ring) {
+  size_t position = LOAD_ACQUIRE(&ring->pop_position);
+  lfr_cell_t *cell = &ring->cells[position & ring->mask];
+  return (LOAD_ACQUIRE(&cell->sequence) != position + 1);
+}
+
+size_t lfr_capacity(lfr_t *ring) { return ring->mask + 1; }
@@ -0,0 +1,53 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LF_RING_H__
+#define __LF_RING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bounded lock-free ring of pointers (multi-producer, multi-consumer)
+// Each cell has a sequence number that tells whether it is ready to be
+// written or read at the current position, so that both push and pop are
+// O(1) and take no lock. The capacity is rounded up to a power of two.
+typedef struct {
+  size_t sequence;
+  void *item;
+} lfr_cell_t;
+
+typedef struct {
+  lfr_cell_t *cells;
+  size_t mask;
+  // Producer and consumer positions are on separate cache lines
+  size_t push_position __attribute__((aligned(64)));
+  size_t pop_position __attribute__((aligned(64)));
+} lfr_t;
+
+lfr_t *lfr_new(size_t capacity);
+// Remaining items are not released.
+void lfr_delete(lfr_t *ring);
+
+// Returns false if the ring is full
+bool lfr_push(lfr_t *ring, void *item);
+// Returns NULL if the ring is empty
+void *lfr_pop(lfr_t *ring);
+// Returns the first item without removing it, or NULL if the ring is empty.
+// It should be called only by a single consumer.
+void *lfr_peek(lfr_t *ring);
+bool lfr_is_empty(lfr_t *ring);
+size_t lfr_capacity(lfr_t *ring);
+
+#endif /* !defined(__LF_RING_H__) */
@@ -0,0 +1,271 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "slab.h"
+
+// Alignment of objects
+typedef union {
+  void *p;
+  long long ll;
+  long double ld;
+} slab_align_t;
+
+// Every object has a header in front of it. The header tells the slab of the
+// object (NULL for a heap buffer of slab_pool_alloc()), and whether the
+// object is allocated from the heap.
+typedef union {
+  struct {
+    slab_t *slab;
+    bool is_heap;
+  } info;
+  slab_align_t align;
+} slab_header_t;
+
+typedef struct slab_chunk_s {
+  struct slab_chunk_s *next;
+  slab_align_t objects[];
+} slab_chunk_t;
+
+typedef struct slab_free_object_s {
+  struct slab_free_object_s *next;
+} slab_free_object_t;
+
+struct slab_s {
+  char *name;
+  size_t object_size;
+  size_t stride; // header + object, aligned
+  size_t objects_per_chunk;
+  size_t max_chunks;
+
+  pthread_mutex_t mutex;
+  slab_chunk_t *chunks;
+  slab_free_object_t *free_list;
+  slab_stats_t stats;
+
+  struct slab_s *next;
+};
+
+// Slab list: for stats by name
+static slab_t *g_slab_list = NULL;
+static pthread_mutex_t g_slab_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t align_size(size_t size) {
+  size_t align = sizeof(slab_align_t);
+  return (size + align - 1) / align * align;
+}
+
+slab_t *slab_new(const char *name, size_t object_size,
+                 size_t objects_per_chunk, size_t max_chunks) {
+  slab_t *slab = (slab_t *)calloc(1, sizeof(slab_t));
+  if (slab == NULL)
+    return NULL;
+  slab->name = (char *)malloc(strlen(name) + 1);
+  if (slab->name == NULL) {
+    free(slab);
+    return NULL;
+  }
+  strncpy(slab->name, name, strlen(name) + 1);
+  if (object_size < sizeof(slab_free_object_t))
+    object_size = sizeof(slab_free_object_t);
+  slab->object_size = object_size;
+  slab->stride = sizeof(slab_header_t) + align_size(object_size);
+  slab->objects_per_chunk = (objects_per_chunk > 0) ? objects_per_chunk : 1;
+  slab->max_chunks = max_chunks;
+  pthread_mutex_init(&slab->mutex, NULL);
+  slab->stats.name = slab->name;
+  slab->stats.object_size = object_size;
+
+  pthread_mutex_lock(&g_slab_list_mutex);
+  slab->next = g_slab_list;
+  g_slab_list = slab;
+  pthread_mutex_unlock(&g_slab_list_mutex);
+  return slab;
+}
+
+void slab_delete(slab_t *slab) {
+  slab_t **link;
+  slab_chunk_t *chunk;
+  if (slab == NULL)
+    return;
+
+  pthread_mutex_lock(&g_slab_list_mutex);
+  for (link = &g_slab_list; *link != NULL; link = &(*link)->next) {
+    if (*link == slab) {
+      *link = slab->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_slab_list_mutex);
+
+  chunk = slab->chunks;
+  while (chunk != NULL) {
+    slab_chunk_t *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  pthread_mutex_destroy(&slab->mutex);
+  free(slab->name);
+  free(slab);
+}
+
+// It should be called with the lock of the slab.
+static bool grow_slab(slab_t *slab) {
+  slab_chunk_t *chunk;
+  size_t i;
+  if (slab->max_chunks > 0 && slab->stats.chunks >= slab->max_chunks)
+    return false;
+  chunk = (slab_chunk_t *)malloc(sizeof(slab_chunk_t) +
+                                 slab->stride * slab->objects_per_chunk);
+  if (chunk == NULL)
+    return false;
+  chunk->next = slab->chunks;
+  slab->chunks = chunk;
+
+  // Push the objects in reverse order, so that they are taken in order.
+  for (i = slab->objects_per_chunk; i > 0; i--) {
+    uint8_t *slot = (uint8_t *)chunk->objects + slab->stride * (i - 1);
+    slab_free_object_t *object =
+        (slab_free_object_t *)(slot + sizeof(slab_header_t));
+    ((slab_header_t *)slot)->info.slab = slab;
+    ((slab_header_t *)slot)->info.is_heap = false;
+    object->next = slab->free_list;
+    slab->free_list = object;
+  }
+  slab->stats.chunks++;
+  slab->stats.capacity += slab->objects_per_chunk;
+  return true;
+}
+
+static void *alloc_from_heap(slab_t *slab, size_t size) {
+  slab_header_t *header =
+      (slab_header_t *)malloc(sizeof(slab_header_t) + size);
+  if (header == NULL)
+    return NULL;
+  header->info.slab = slab;
+  header->info.is_heap = true;
+  return (void *)(header + 1);
+}
+
+void *slab_alloc(slab_t *slab) {
+  slab_free_object_t *object;
+  pthread_mutex_lock(&slab->mutex);
+  if (slab->free_list == NULL && !grow_slab(slab)) {
+    // The slab is full: fall back to the heap
+    object = (slab_free_object_t *)alloc_from_heap(slab, slab->object_size);
+    if (object != NULL)
+      slab->stats.fallbacks++;
+  } else {
+    object = slab->free_list;
+    slab->free_list = object->next;
+  }
+  if (object != NULL) {
+    slab->stats.in_use++;
+    if (slab->stats.in_use > slab->stats.in_use_max)
+      slab->stats.in_use_max = slab->stats.in_use;
+  }
+  pthread_mutex_unlock(&slab->mutex);
+  return (void *)object;
+}
+
+void slab_free(void *ptr) {
+  slab_header_t *header;
+  slab_t *slab;
+  if (ptr == NULL)
+    return;
+  header = (slab_header_t *)ptr - 1;
+  slab = header->info.slab;
+  if (header->info.is_heap) {
+    if (slab != NULL) {
+      pthread_mutex_lock(&slab->mutex);
+      slab->stats.in_use--;
+      pthread_mutex_unlock(&slab->mutex);
+    }
+    free(header);
+    return;
+  }
+
+  pthread_mutex_lock(&slab->mutex);
+  slab_free_object_t *object = (slab_free_object_t *)ptr;
+  object->next = slab->free_list;
+  slab->free_list = object;
+  slab->stats.in_use--;
+  pthread_mutex_unlock(&slab->mutex);
+}
+
+void slab_get_stats(slab_t *slab, slab_stats_t *stats) {
+  pthread_mutex_lock(&slab->mutex);
+  *stats = slab->stats;
+  pthread_mutex_unlock(&slab->mutex);
+}
+
+size_t slab_get_stats_by_prefix(const char *name_prefix, slab_stats_t *stats,
+                                size_t max_count) {
+  size_t count = 0;
+  slab_t *slab;
+  pthread_mutex_lock(&g_slab_list_mutex);
+  for (slab = g_slab_list; slab != NULL && count < max_count;
+       slab = slab->next) {
+    if (strncmp(slab->name, name_prefix, strlen(name_prefix)) != 0)
+      continue;
+    slab_get_stats(slab, &stats[count++]);
+  }
+  pthread_mutex_unlock(&g_slab_list_mutex);
+  return count;
+}
+
+bool slab_pool_init(slab_pool_t *pool, const char *name,
+                    const size_t *class_sizes, size_t classes_count,
+                    size_t objects_per_chunk, size_t max_chunks) {
+  char slab_name[64];
+  size_t i;
+  memset(pool, 0, sizeof(slab_pool_t));
+  if (classes_count > SLAB_POOL_MAX_CLASSES)
+    classes_count = SLAB_POOL_MAX_CLASSES;
+  for (i = 0; i < classes_count; i++) {
+    snprintf(slab_name, sizeof(slab_name), "%s_%zu", name, class_sizes[i]);
+    pool->slabs[i] =
+        slab_new(slab_name, class_sizes[i], objects_per_chunk, max_chunks);
+    if (pool->slabs[i] == NULL) {
+      slab_pool_destroy(pool);
+      return false;
+    }
+    pool->class_sizes[i] = class_sizes[i];
+    pool->classes_count = i + 1;
+  }
+  return true;
+}
+
+void slab_pool_destroy(slab_pool_t *pool) {
+  size_t i;
+  for (i = 0; i < pool->classes_count; i++) {
+    slab_delete(pool->slabs[i]);
+    pool->slabs[i] = NULL;
+  }
+  pool->classes_count = 0;
+}
+
+void *slab_pool_alloc(slab_pool_t *pool, size_t size) {
+  size_t i;
+  for (i = 0; i < pool->classes_count; i++) {
+    if (size <= pool->class_sizes[i])
+      return slab_alloc(pool->slabs[i]);
+  }
+  return alloc_from_heap(NULL, size);
+}
@@ -0,0 +1,75 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SLAB_H__
+#define __SLAB_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Slab: pool of fixed-size objects
+// Objects are carved from chunks of objects_per_chunk objects, and a freed
+// object goes back to the free list of its slab, not to the heap. Chunks are
+// kept until slab_delete(), so that a long session of event payloads does
+// not fragment the heap. A slab grows up to max_chunks chunks; beyond that,
+// objects are allocated from the heap and counted as fallbacks.
+// alloc and free can be called on any thread.
+typedef struct slab_s slab_t;
+
+typedef struct {
+  const char *name;
+  size_t object_size;
+  size_t capacity;   // objects in chunks
+  size_t in_use;     // objects allocated now (including fallbacks)
+  size_t in_use_max; // high-water mark of in_use
+  size_t chunks;
+  size_t fallbacks; // objects allocated from the heap so far
+} slab_stats_t;
+
+slab_t *slab_new(const char *name, size_t object_size,
+                 size_t objects_per_chunk, size_t max_chunks);
+// Objects still in use must not be accessed after it.
+void slab_delete(slab_t *slab);
+
+void *slab_alloc(slab_t *slab);
+// It finds the slab of the object by itself. NULL is ignored.
+void slab_free(void *object);
+
+void slab_get_stats(slab_t *slab, slab_stats_t *stats);
+// Fill stats of the slabs whose name starts with name_prefix, and returns
+// the number of them.
+size_t slab_get_stats_by_prefix(const char *name_prefix, slab_stats_t *stats,
+                                size_t max_count);
+
+// Slab pool: slabs of size classes for variable-size buffers
+// A buffer larger than the largest class is allocated from the heap.
+#define SLAB_POOL_MAX_CLASSES 8
+typedef struct {
+  size_t classes_count;
+  size_t class_sizes[SLAB_POOL_MAX_CLASSES];
+  slab_t *slabs[SLAB_POOL_MAX_CLASSES];
+} slab_pool_t;
+
+// class_sizes should be in ascending order.
+// Each slab is named "<name>_<class size>".
+bool slab_pool_init(slab_pool_t *pool, const char *name,
+                    const size_t *class_sizes, size_t classes_count,
+                    size_t objects_per_chunk, size_t max_chunks);
+void slab_pool_destroy(slab_pool_t *pool);
+// The buffer is freed by slab_free().
+void *slab_pool_alloc(slab_pool_t *pool, size_t size);
+
+#endif /* !defined(__SLAB_H__) */
@@ -323,6 +323,22 @@ OCFAdapter.prototype.repSetBufferAndString = function (
   this.repSet(KEY_STRING_VALUE, stringValue);
 };
 
+/**
+ * OCFAdapter.repSetObject
+ * @param {Object} value
+ * @returns {Boolean} isSuccess
+ * Writes the whole root object of OCRepresentation from the own properties
+ * of the given object on one native call. It is the same as calling
+ * repStartRootObject(), repSet() for each property and repEndRootObject().
+ */
+OCFAdapter.prototype.repSetObject = function (value) {
+  if (typeof value !== 'object' || value === null) {
+    console.log('repSetObject(): Invalid value type (' + typeof value + ')');
+    return false;
+  }
+  return native.ocf_adapter_repSetObject(value);
+};
+
 /**
  * OCFAdapter.repEndRootObject
  * Finish writing OCRepresentation of OCF thread.
@@ -346,14 +362,9 @@ OCFAdapter.prototype.sendResponse = function (
     if (typeof responsePayload !== 'object') {
       throw 'Invalid responsePayload: ' + responsePayload;
     }
-    this.repStartRootObject();
-    for (var key in responsePayload) {
-      if (responsePayload.hasOwnProperty(key)) {
-        var value = responsePayload[key];
-        this.repSet(key, value);
-      }
-    }
-    this.repEndRootObject();
+    // The payload is encoded on the same native call.
+    native.ocf_adapter_sendResponse(ocfRequest, statusCode, responsePayload);
+    return;
   }
   native.ocf_adapter_sendResponse(ocfRequest, statusCode);
 };
@@ -414,20 +425,102 @@ OCFAdapter.prototype.isDiscovering = function () {
  * OCFAdapter.discovery
  * @param {String} resourceType Type of resource to find on the network
  * @param {Function} discoveryHandler called whenever one OCFResource is
- * discovered
+ * discovered. It is called with (endpoint, uri, types, interfaceMask,
+ * deviceId, change). change is 'new', 'changed' or 'removed' compared with
+ * the discovery cache, and endpoint is undefined if the resource is removed.
+ * @param {Object} options (optional)
+ *  - batch {Boolean}: if true, discoveryHandler is called with an array of
+ *    discovered resources ({endpoint, uri, types, interfaceMask, deviceId,
+ *    change}) per event loop wakeup, instead of once per resource.
+ *  - incremental {Boolean}: if true, only the resources that are new or
+ *    changed since the last discovery are reported, and the resources not
+ *    found for cacheTTLMs are reported as removed.
+ *  - cacheTTLMs {Number}: time to keep a discovered resource in the
+ *    discovery cache (default: 60000)
  * @returns {Boolean} isSuccess
  */
-OCFAdapter.prototype.discovery = function (resourceType, discoveryHandler) {
-  return native.ocf_adapter_discovery(resourceType, discoveryHandler);
+OCFAdapter.prototype.discovery = function (
+  resourceType,
+  discoveryHandler,
+  options
+) {
+  var isBatch = false;
+  var isIncremental = false;
+  var cacheTTLMs = DISCOVERY_CACHE_DEFAULT_TTL_MS;
+  if (options !== undefined) {
+    isBatch = options.batch === true;
+    isIncremental = options.incremental === true;
+    if (options.cacheTTLMs !== undefined) {
+      if (typeof options.cacheTTLMs !== 'number' || !(options.cacheTTLMs > 0)) {
+        console.error('discovery(): Invalid cacheTTLMs: ' + options.cacheTTLMs);
+        return false;
+      }
+      cacheTTLMs = options.cacheTTLMs;
+    }
+  }
+  return native.ocf_adapter_discovery(
+    resourceType,
+    discoveryHandler,
+    isBatch,
+    isIncremental,
+    cacheTTLMs
+  );
+};
+var DISCOVERY_CACHE_DEFAULT_TTL_MS = 60000;
+/**
+ * OCFAdapter.clearDiscoveryCache
+ * Forget all the resources discovered so far, so that the next incremental
+ * discovery reports all the resources as new.
+ */
+OCFAdapter.prototype.clearDiscoveryCache = function () {
+  native.ocf_adapter_clearDiscoveryCache();
 };
 /**
  * OCFAdapter.discoveryAll
  * @param {Function} discoveryHandler Handler function for discovery response
+ * @param {Object} options (optional) same as OCFAdapter.discovery
  * @returns {Boolean} isSuccess
  * Search all resources regardless of any type on the network.
  */
-OCFAdapter.prototype.discoveryAll = function (discoveryHandler) {
-  return native.ocf_adapter_discovery(' ', discoveryHandler);
+OCFAdapter.prototype.discoveryAll = function (discoveryHandler, options) {
+  return this.discovery(' ', discoveryHandler, options);
+};
+/**
+ * OCFAdapter.setEventBudget
+ * @param {Number} budgetMs Time budget of OCF event delivery per event loop
+ * wakeup in milliseconds. The rest of the events are delivered on the next
+ * iteration, so that a burst of discovery or observe events does not starve
+ * timers. 0 means no budget. (default: 10)
+ * @returns {Boolean} isSuccess
+ */
+OCFAdapter.prototype.setEventBudget = function (budgetMs) {
+  if (typeof budgetMs !== 'number' || budgetMs < 0) {
+    console.error('Error: invalid event budget ' + budgetMs);
+    return false;
+  }
+  native.ocf_adapter_setEventBudget(Math.round(budgetMs * 1000));
+  return true;
+};
+/**
+ * OCFAdapter.getEventMetrics
+ * @returns {Array} metrics of OCF event channels: [{name, queueDepth,
+ * queueDepthMax, emitted, dropped, delivered, latencyAvgUs, latencyMaxUs,
+ * handlerTimeAvgUs, handlerTimeMaxUs}, ...]
+ * Latency is from the event on OCF thread to the start of its delivery on
+ * JS thread, and handler time is the time spent delivering it.
+ */
+OCFAdapter.prototype.getEventMetrics = function () {
+  return native.ocf_adapter_getEventMetrics();
+};
+/**
+ * OCFAdapter.getMemoryStats
+ * @returns {Array} stats of the slabs of OCF event payloads: [{name,
+ * objectSize, capacity, inUse, inUseMax, chunks, fallbacks}, ...]
+ * inUseMax is the high-water mark of the objects in use, and fallbacks is the
+ * number of objects allocated from the heap since the slab was full.
+ */
+OCFAdapter.prototype.getMemoryStats = function () {
+  return native.ocf_adapter_getMemoryStats();
 };
 
 var makeRequest = function (requestId, query, qos, endpoint, uri, userHandler) {
@@ -458,22 +551,24 @@ var oaPutResponseHandler = function (requestId, response) {
   return oaResponseHandler(requestId, response, gPutRequestList, true);
 };
 var oaResponseHandler = function (requestId, response, requestList, isOneway) {
-  var request = undefined;
+  var index = -1;
   for (var i = 0; i < requestList.length; i++) {
     var item = requestList[i];
     if (item !== undefined && item.id == requestId) {
-      request = item;
+      index = i;
       break;
     }
   }
-  if (request !== undefined) {
-    var userHandler = request.userHandler;
-    if (userHandler !== undefined) {
-      userHandler(response);
-      if (isOneway) {
-        requestList.splice(requestId, 1);
-      }
-    }
+  if (index < 0) {
+    return;
+  }
+  var request = requestList[index];
+  // One-way request is done on its response, even if it has no user handler.
+  if (isOneway) {
+    requestList.splice(index, 1);
+  }
+  if (request.userHandler !== undefined) {
+    request.userHandler(response);
   }
 };
 var responseTimeoutMs = 2000;
@@ -483,7 +578,7 @@ var requestListCleanerFn = function () {
   var now = new Date();
   for (var i = 0; i < gOnewayRequestLists.length; i++) {
     var requestList = gOnewayRequestLists[i];
-    for (var j = 0; j < requestList.length; j++) {
+    for (var j = requestList.length - 1; j >= 0; j--) {
       var request = requestList[j];
       if (request === undefined) continue;
       if (now - request.timestamp > responseTimeoutMs) {
@@ -790,14 +885,7 @@ OCFAdapter.prototype.post = function (
   );
   if (isSuccess) {
     if (requestPayload !== undefined) {
-      this.repStartRootObject();
-      for (var key in requestPayload) {
-        if (requestPayload.hasOwnProperty(key)) {
-          var value = requestPayload[key];
-          this.repSet(key, value);
-        }
-      }
-      this.repEndRootObject();
+      this.repSetObject(requestPayload);
     }
     isSuccess &= this.finishPost();
   }
@@ -846,14 +934,7 @@ OCFAdapter.prototype.put = function (
   );
   if (isSuccess) {
     if (requestPayload !== undefined) {
-      this.repStartRootObject();
-      for (var key in requestPayload) {
-        if (requestPayload.hasOwnProperty(key)) {
-          var value = requestPayload[key];
-          this.repSet(key, value);
-        }
-      }
-      this.repEndRootObject();
+      this.repSetObject(requestPayload);
     }
     isSuccess &= this.finishPut();
   }
@@ -949,5 +1030,24 @@ OCFResource.prototype.setHandler = function (method, handler) {
   gOCFResourceHandlerId++;
 };
 
+/**
+ * OCFResource.setCachedRepresentation
+ * @param {Object} payload
+ * @returns {Boolean} isChanged
+ * Switches the resource to the cached representation mode, and updates the
+ * cached values with the own properties of the payload. From then on, GET
+ * requests including periodic observe notifications are answered by OCF
+ * thread from the cached values without calling the JS handler of GET.
+ * Only the changed values need to be passed, and it returns false if none of
+ * them is changed. It replaces the GET handler set with setHandler().
+ */
+OCFResource.prototype.setCachedRepresentation = function (payload) {
+  if (typeof payload !== 'object' || payload === null) {
+    console.error('setCachedRepresentation(): Invalid payload: ' + payload);
+    return false;
+  }
+  return native.ocf_resource_setCachedRepresentation(this, payload);
+};
+
 module.exports = new OCF();
 module.exports.OCF = OCF;
@@ -13,12 +13,16 @@
  * limitations under the License.
  */
 
+#include <errno.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -31,16 +35,17 @@
 #include <port/oc_clock.h>
 
 #include "../../../common/native/ant_common.h"
-#include "./ant_async.h"
+#include "../../../common/native/internal/ant_async.h"
 
 #include "./ocf_adapter_internal.h"
 
 // OCF thread
+// OCF thread sleeps in epoll_wait() until the next timer of IoTivity expires
+// or the eventfd is written by signal_event_loop().
 static pthread_t g_ocf_thread;
-static pthread_mutex_t mutex;
-static pthread_cond_t cv;
-static struct timespec ts;
-static int g_thread_quit = 0;
+static volatile sig_atomic_t g_thread_quit = 0;
+static int g_event_fd = -1;
+static int g_epoll_fd = -1;
 
 static void *ocf_thread_fn(void *arg);
 static void signal_event_loop(void);
@@ -70,6 +75,24 @@ static void oa_prepare_client(void) {
 
 // OCFAdapter.start()
 void ocf_adapter_start_internal(void) {
+  // The fds are kept open after OCF thread terminates, since other threads
+  // may still call signal_event_loop().
+  if (g_epoll_fd < 0) {
+    struct epoll_event ev;
+    g_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    g_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_event_fd < 0 || g_epoll_fd < 0) {
+      fprintf(stderr, "OCF event loop cannot be created: %s\n",
+              strerror(errno));
+      return;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = g_event_fd;
+    epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, g_event_fd, &ev);
+  }
+
+  g_thread_quit = 0;
   pthread_create(&g_ocf_thread, NULL, &ocf_thread_fn, NULL);
 }
 
@@ -97,35 +120,202 @@ bool ocf_adapter_addResource_internal(void *ocf_resource_nobject) {
   return oc_add_resource((oc_resource_t *)ocf_resource_nobject);
 }
 
+// Post and put requests
+// JS thread does not call IoTivity to build a post or put request, since OCF
+// thread may be serving a request on the same encoder. Instead, initPost() (or
+// initPut()) and repSet*() record the request and its representation, post()
+// (or put()) queues it, and OCF thread builds and sends it between two
+// oc_main_poll() calls. JS thread never waits for OCF thread.
+enum oa_rep_value_type_e {
+  OA_REP_VALUE_BOOLEAN,
+  OA_REP_VALUE_INT,
+  OA_REP_VALUE_DOUBLE,
+  OA_REP_VALUE_STRING,
+  OA_REP_VALUE_BYTE_ARRAY
+};
+typedef struct oa_rep_value_s {
+  char *key;
+  int type;
+  union {
+    bool boolean;
+    int integer;
+    double number;
+  } scalar;
+  uint8_t *bytes;
+  size_t length;
+  struct oa_rep_value_s *next;
+} oa_rep_value_t;
+
+typedef struct oa_pending_request_s {
+  bool is_put;
+  int request_id;
+  bool is_payload_buffer;
+  oc_endpoint_t endpoint;
+  char *uri;
+  char *query;
+  oc_qos_t qos;
+  bool has_payload;
+  bool is_invalid; // a value cannot be recorded
+  oa_rep_value_t *values;
+  oa_rep_value_t *last_value;
+  struct oa_pending_request_s *next;
+} oa_pending_request_t;
+
+// The request between initPost() and post() on JS thread
+static oa_pending_request_t *g_building_request = NULL;
+// The requests queued to OCF thread
+static oa_pending_request_t *g_pending_requests_head = NULL;
+static oa_pending_request_t *g_pending_requests_tail = NULL;
+static pthread_mutex_t g_pending_requests_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static char *copy_string(const char *str) {
+  size_t len = strlen(str) + 1;
+  char *new_str = (char *)malloc(sizeof(char) * len);
+  if (new_str != NULL)
+    strncpy(new_str, str, len);
+  return new_str;
+}
+
+static void destroy_pending_request(oa_pending_request_t *request) {
+  oa_rep_value_t *v = request->values;
+  while (v != NULL) {
+    oa_rep_value_t *next = v->next;
+    free(v->key);
+    free(v->bytes);
+    free(v);
+    v = next;
+  }
+  free(request->uri);
+  free(request->query);
+  free(request);
+}
+
+static oa_rep_value_t *record_rep_value(const char *key, int type,
+                                        const void *bytes, size_t length) {
+  oa_pending_request_t *request = g_building_request;
+  oa_rep_value_t *v = (oa_rep_value_t *)calloc(1, sizeof(oa_rep_value_t));
+  if (v != NULL) {
+    v->key = copy_string(key);
+    if (bytes != NULL) {
+      v->bytes = (uint8_t *)malloc(length + 1);
+      if (v->bytes != NULL) {
+        memcpy(v->bytes, bytes, length);
+        v->bytes[length] = '\0';
+      }
+    }
+  }
+  if (v == NULL || v->key == NULL || (bytes != NULL && v->bytes == NULL)) {
+    if (v != NULL) {
+      free(v->key);
+      free(v);
+    }
+    request->is_invalid = true;
+    return NULL;
+  }
+  v->type = type;
+  v->length = length;
+  if (request->last_value == NULL)
+    request->values = v;
+  else
+    request->last_value->next = v;
+  request->last_value = v;
+  return v;
+}
+
+// Encoders of OCRepresentation
+static void encode_rep_key(const char *key) {
+  g_err |= cbor_encode_text_string(&root_map, key, strlen(key));
+}
+
+static void encode_rep_values(oa_rep_value_t *values) {
+  oc_rep_start_root_object();
+  for (oa_rep_value_t *v = values; v != NULL; v = v->next) {
+    encode_rep_key(v->key);
+    switch (v->type) {
+    case OA_REP_VALUE_BOOLEAN:
+      g_err |= cbor_encode_boolean(&root_map, v->scalar.boolean);
+      break;
+    case OA_REP_VALUE_INT:
+      g_err |= cbor_encode_int(&root_map, v->scalar.integer);
+      break;
+    case OA_REP_VALUE_DOUBLE:
+      g_err |= cbor_encode_double(&root_map, v->scalar.number);
+      break;
+    case OA_REP_VALUE_STRING:
+      g_err |= cbor_encode_text_string(&root_map, (const char *)v->bytes,
+                                       v->length);
+      break;
+    case OA_REP_VALUE_BYTE_ARRAY:
+      g_err |= cbor_encode_byte_string(&root_map, v->bytes, v->length);
+      break;
+    }
+  }
+  oc_rep_end_root_object();
+}
+
+// The representation is recorded between initPost() and post() (or initPut()
+// and put()), and encoded right away otherwise (e.g. sendResponse()).
 void ocf_adapter_repStartRootObject_internal(void) {
+  if (g_building_request != NULL) {
+    g_building_request->has_payload = true;
+    return;
+  }
   oc_rep_start_root_object();
 }
 void ocf_adapter_repSetBoolean_internal(const char *key, bool value) {
-  g_err |= cbor_encode_text_string(&root_map, key, strlen(key));
+  if (g_building_request != NULL) {
+    oa_rep_value_t *v = record_rep_value(key, OA_REP_VALUE_BOOLEAN, NULL, 0);
+    if (v != NULL)
+      v->scalar.boolean = value;
+    return;
+  }
+  encode_rep_key(key);
   g_err |= cbor_encode_boolean(&root_map, value);
 }
 void ocf_adapter_repSetInt_internal(const char *key, int value) {
-  g_err |= cbor_encode_text_string(&root_map, key, strlen(key));
+  if (g_building_request != NULL) {
+    oa_rep_value_t *v = record_rep_value(key, OA_REP_VALUE_INT, NULL, 0);
+    if (v != NULL)
+      v->scalar.integer = value;
+    return;
+  }
+  encode_rep_key(key);
   g_err |= cbor_encode_int(&root_map, value);
 }
 void ocf_adapter_repSetDouble_internal(const char *key, double value) {
-  g_err |= cbor_encode_text_string(&root_map, key, strlen(key));
+  if (g_building_request != NULL) {
+    oa_rep_value_t *v = record_rep_value(key, OA_REP_VALUE_DOUBLE, NULL, 0);
+    if (v != NULL)
+      v->scalar.number = value;
+    return;
+  }
+  encode_rep_key(key);
   g_err |= cbor_encode_double(&root_map, value);
 }
 void ocf_adapter_repSetString_internal(const char *key, const char *value) {
-  g_err |= cbor_encode_text_string(&root_map, key, strlen(key));
-  if ((const char *)value != NULL) {
-    g_err |= cbor_encode_text_string(&root_map, value, strlen(value));
-  } else {
-    g_err |= cbor_encode_text_string(&root_map, "", 0);
+  if (value == NULL)
+    value = "";
+  if (g_building_request != NULL) {
+    record_rep_value(key, OA_REP_VALUE_STRING, value, strlen(value));
+    return;
   }
+  encode_rep_key(key);
+  g_err |= cbor_encode_text_string(&root_map, value, strlen(value));
 }
 void ocf_adapter_repSetByteArray_internal(const char *key, const uint8_t *value,
                                           size_t value_length) {
-  g_err |= cbor_encode_text_string(&root_map, key, strlen(key));
+  if (g_building_request != NULL) {
+    record_rep_value(key, OA_REP_VALUE_BYTE_ARRAY, value, value_length);
+    return;
+  }
+  encode_rep_key(key);
   g_err |= cbor_encode_byte_string(&root_map, value, value_length);
 }
-void ocf_adapter_repEndRootObject_internal(void) { oc_rep_end_root_object(); }
+void ocf_adapter_repEndRootObject_internal(void) {
+  if (g_building_request != NULL)
+    return;
+  oc_rep_end_root_object();
+}
 void ocf_adapter_sendResponse_internal(void *ocf_request_nobject,
                                        int status_code) {
   oc_request_t *request = (oc_request_t *)ocf_request_nobject;
@@ -147,33 +337,261 @@ static bool check_valid_resource_type(const char *resource_type) {
   return false;
 }
 
+// Event payload pools
+// Chunks of the slabs are kept for the lifetime of the process, since events
+// can still be in flight after OCFAdapter.deinitialize().
+#define OA_EVENT_SLAB_CHUNK_OBJECTS 64
+#define OA_EVENT_SLAB_MAX_CHUNKS 16
+static slab_t *g_discovery_event_slab = NULL;
+static slab_t *g_response_event_slab = NULL;
+static slab_pool_t g_payload_pool;
+static const size_t g_payload_class_sizes[] = {128, 512, 2048, 8192};
+
+void ocf_adapter_initEventPools_internal(void) {
+  if (g_discovery_event_slab != NULL)
+    return;
+  g_discovery_event_slab =
+      slab_new("ocf_discovery_event", sizeof(oa_discovery_event_data_t),
+               OA_EVENT_SLAB_CHUNK_OBJECTS, OA_EVENT_SLAB_MAX_CHUNKS);
+  g_response_event_slab =
+      slab_new("ocf_response_event", sizeof(oa_client_response_event_data_t),
+               OA_EVENT_SLAB_CHUNK_OBJECTS, OA_EVENT_SLAB_MAX_CHUNKS);
+  slab_pool_init(&g_payload_pool, "ocf_payload", g_payload_class_sizes,
+                 sizeof(g_payload_class_sizes) / sizeof(size_t),
+                 OA_EVENT_SLAB_CHUNK_OBJECTS, OA_EVENT_SLAB_MAX_CHUNKS);
+}
+
+oa_discovery_event_data_t *
+oa_new_discovery_event_data(const char *device_id, const char *uri,
+                            const char **types, int types_count) {
+  size_t strings_size = strlen(device_id) + 1 + strlen(uri) + 1;
+  for (int i = 0; i < types_count; i++) {
+    strings_size += strlen(types[i]) + 1;
+  }
+
+  oa_discovery_event_data_t *event_data =
+      (oa_discovery_event_data_t *)slab_alloc(g_discovery_event_slab);
+  if (event_data == NULL)
+    return NULL;
+  if (strings_size <= OA_DISCOVERY_INLINE_STRINGS_SIZE) {
+    event_data->strings = event_data->inline_strings;
+  } else {
+    event_data->strings = (char *)oa_alloc_payload(strings_size);
+    if (event_data->strings == NULL) {
+      slab_free(event_data);
+      return NULL;
+    }
+  }
+
+  // Pack the strings
+  char *cursor = event_data->strings;
+  size_t len = strlen(device_id) + 1;
+  event_data->device_id = (char *)memcpy(cursor, device_id, len);
+  cursor += len;
+  len = strlen(uri) + 1;
+  event_data->uri = (char *)memcpy(cursor, uri, len);
+  cursor += len;
+  for (int i = 0; i < types_count; i++) {
+    len = strlen(types[i]) + 1;
+    event_data->types[i] = (char *)memcpy(cursor, types[i], len);
+    cursor += len;
+  }
+  event_data->types_count = types_count;
+  return event_data;
+}
+
+void *oa_alloc_response_event_data(void) {
+  return slab_alloc(g_response_event_slab);
+}
+
+void *oa_alloc_payload(size_t size) {
+  return slab_pool_alloc(&g_payload_pool, size);
+}
+
 bool g_is_discovering = false;
+bool g_is_discovery_batch = false;
+bool g_is_discovery_incremental = false;
 bool ocf_adapter_isDiscovering_internal(void) { return g_is_discovering; }
+bool ocf_adapter_isDiscoveryBatch_internal(void) {
+  return g_is_discovery_batch;
+}
 void ocf_adapter_stopDiscovery_internal(void) { g_is_discovering = false; }
+
+// Discovery cache
+// Discovered resources are kept by device id and URI with the signature of
+// their types, interface mask and endpoint. In incremental mode, a resource
+// is reported only if it is new or its signature is changed, and the
+// resources not seen for the TTL are reported as removed.
+#define OA_DISCOVERY_CACHE_BUCKETS 256
+typedef struct oa_discovery_cache_entry_s {
+  char *device_id;
+  char *uri;
+  uint32_t key_hash;
+  uint32_t signature;
+  oc_clock_time_t last_seen;
+  struct oa_discovery_cache_entry_s *next;
+} oa_discovery_cache_entry_t;
+
+static oa_discovery_cache_entry_t
+    *g_discovery_cache[OA_DISCOVERY_CACHE_BUCKETS];
+static pthread_mutex_t g_discovery_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static oc_clock_time_t g_discovery_cache_ttl = 0;
+
+// FNV-1a
+static uint32_t hash_string(uint32_t hash, const char *str) {
+  if (str == NULL)
+    return hash;
+  while (*str != '\0') {
+    hash ^= (uint8_t)*str++;
+    hash *= 16777619u;
+  }
+  // Separator not to mix up the boundaries of strings
+  hash ^= 0xff;
+  hash *= 16777619u;
+  return hash;
+}
+#define HASH_SEED 2166136261u
+
+static uint32_t get_discovery_signature(oc_string_array_t types,
+                                        oc_interface_mask_t iface_mask,
+                                        oc_endpoint_t *endpoint) {
+  uint32_t signature = HASH_SEED;
+  for (int i = 0; i < (int)oc_string_array_get_allocated_size(types); i++) {
+    signature = hash_string(signature, oc_string_array_get_item(types, i));
+  }
+  signature ^= (uint32_t)iface_mask;
+  signature *= 16777619u;
+  for (oc_endpoint_t *ep = endpoint; ep != NULL; ep = ep->next) {
+    oc_string_t ep_ocs;
+    if (oc_endpoint_to_string(ep, &ep_ocs) == 0) {
+      signature = hash_string(signature, oc_string(ep_ocs));
+      oc_free_string(&ep_ocs);
+    }
+  }
+  return signature;
+}
+
+// On OCF thread: update the cache, and returns the change of the resource
+// or -1 if it is not changed.
+static int update_discovery_cache(const char *di, const char *uri,
+                                  uint32_t signature) {
+  uint32_t key_hash = hash_string(hash_string(HASH_SEED, di), uri);
+  oa_discovery_cache_entry_t **bucket =
+      &g_discovery_cache[key_hash % OA_DISCOVERY_CACHE_BUCKETS];
+  oa_discovery_cache_entry_t *entry;
+  int change = -1;
+
+  pthread_mutex_lock(&g_discovery_cache_mutex);
+  for (entry = *bucket; entry != NULL; entry = entry->next) {
+    if (entry->key_hash == key_hash && strcmp(entry->uri, uri) == 0 &&
+        strcmp(entry->device_id, di) == 0)
+      break;
+  }
+  if (entry == NULL) {
+    entry = (oa_discovery_cache_entry_t *)malloc(
+        sizeof(oa_discovery_cache_entry_t));
+    if (entry != NULL) {
+      entry->device_id = copy_string(di);
+      entry->uri = copy_string(uri);
+      entry->key_hash = key_hash;
+      entry->signature = signature;
+      entry->next = *bucket;
+      *bucket = entry;
+    }
+    change = OA_DISCOVERY_NEW;
+  } else if (entry->signature != signature) {
+    entry->signature = signature;
+    change = OA_DISCOVERY_CHANGED;
+  }
+  if (entry != NULL)
+    entry->last_seen = oc_clock_time();
+  pthread_mutex_unlock(&g_discovery_cache_mutex);
+  return change;
+}
+
+static void free_discovery_cache_entry(oa_discovery_cache_entry_t *entry) {
+  free(entry->device_id);
+  free(entry->uri);
+  free(entry);
+}
+
+// Remove the expired entries, and report them as removed if is_report.
+static void expire_discovery_cache(bool is_report) {
+  oc_clock_time_t now = oc_clock_time();
+  pthread_mutex_lock(&g_discovery_cache_mutex);
+  for (int i = 0; i < OA_DISCOVERY_CACHE_BUCKETS; i++) {
+    oa_discovery_cache_entry_t **link = &g_discovery_cache[i];
+    while (*link != NULL) {
+      oa_discovery_cache_entry_t *entry = *link;
+      if (now - entry->last_seen < g_discovery_cache_ttl) {
+        link = &entry->next;
+        continue;
+      }
+      *link = entry->next;
+      oa_discovery_event_data_t *event_data = NULL;
+      if (is_report) {
+        event_data = oa_new_discovery_event_data(entry->device_id, entry->uri,
+                                                 NULL, 0);
+      }
+      if (event_data != NULL) {
+        event_data->interface_mask = 0;
+        event_data->endpoint = NULL;
+        event_data->change = OA_DISCOVERY_REMOVED;
+        // JS thread calls it, so it must not wait for a full queue.
+        int zero = 0;
+        TRY_EMIT_ANT_ASYNC_EVENT(ocf_adapter_discovery, zero,
+                                 (void *)event_data);
+      }
+      free_discovery_cache_entry(entry);
+    }
+  }
+  pthread_mutex_unlock(&g_discovery_cache_mutex);
+}
+
+// OCFAdapter.clearDiscoveryCache()
+void ocf_adapter_clearDiscoveryCache_internal(void) {
+  pthread_mutex_lock(&g_discovery_cache_mutex);
+  for (int i = 0; i < OA_DISCOVERY_CACHE_BUCKETS; i++) {
+    oa_discovery_cache_entry_t *entry = g_discovery_cache[i];
+    while (entry != NULL) {
+      oa_discovery_cache_entry_t *next = entry->next;
+      free_discovery_cache_entry(entry);
+      entry = next;
+    }
+    g_discovery_cache[i] = NULL;
+  }
+  pthread_mutex_unlock(&g_discovery_cache_mutex);
+}
+
 static oc_discovery_flags_t
 oa_on_discovery(const char *di, const char *uri, oc_string_array_t types,
                 oc_interface_mask_t iface_mask, oc_endpoint_t *endpoint,
                 oc_resource_properties_t bm, void *user_data) {
-  // Discovery event
-  oa_discovery_event_data_t *event_data;
-  event_data =
-      (oa_discovery_event_data_t *)malloc(sizeof(oa_discovery_event_data_t));
-
-  // event_data->uri
-  event_data->uri = malloc(sizeof(char) * (strlen(uri) + 1));
-  strncpy(event_data->uri, uri, strlen(uri) + 1);
+  // The cache is always updated, so that the next incremental discovery
+  // knows the resources found by a full one.
+  uint32_t signature = get_discovery_signature(types, iface_mask, endpoint);
+  int change = update_discovery_cache(di, uri, signature);
+  if (change < 0 && g_is_discovery_incremental) {
+    return (g_is_discovering) ? OC_CONTINUE_DISCOVERY : OC_STOP_DISCOVERY;
+  }
 
-  // event_data->types
-  event_data->types = ll_new(oa_discovery_event_types_destroyer);
-  int i;
-  for (i = 0; i < (int)oc_string_array_get_allocated_size(types); i++) {
+  // Discovery event
+  const char *valid_types[OA_DISCOVERY_MAX_TYPES];
+  int valid_types_count = 0;
+  for (int i = 0; i < (int)oc_string_array_get_allocated_size(types); i++) {
     char *type = oc_string_array_get_item(types, i);
-    size_t type_len = strlen(type) + 1;
     if (!check_valid_resource_type(type))
       continue;
-    char *new_type = (char *)malloc(sizeof(char) * (type_len + 1));
-    strncpy(new_type, type, type_len + 1);
-    ll_insert_last(event_data->types, new_type);
+    if (valid_types_count == OA_DISCOVERY_MAX_TYPES) {
+      printf("Too many types of %s: %s is ignored\n", uri, type);
+      continue;
+    }
+    valid_types[valid_types_count++] = type;
+  }
+  oa_discovery_event_data_t *event_data =
+      oa_new_discovery_event_data(di, uri, valid_types, valid_types_count);
+  if (event_data == NULL) {
+    return (g_is_discovering) ? OC_CONTINUE_DISCOVERY : OC_STOP_DISCOVERY;
   }
 
   // event_data->interface_mask
@@ -182,15 +600,29 @@ oa_on_discovery(const char *di, const char *uri, oc_string_array_t types,
   // event_data->endpoint
   oc_endpoint_list_copy((oc_endpoint_t **)&event_data->endpoint, endpoint);
 
+  // event_data->change: an unchanged resource is reported as new in full
+  // discovery.
+  event_data->change = (change < 0) ? OA_DISCOVERY_NEW : change;
+
+  // In batch mode, OCF thread does not wait for JS thread, so that the
+  // discovered resources are queued and delivered together.
   int zero = 0;
-  EMIT_ANT_ASYNC_EVENT(ocf_adapter_discovery, zero, (void *)event_data, true);
+  EMIT_ANT_ASYNC_EVENT(ocf_adapter_discovery, zero, (void *)event_data,
+                       !g_is_discovery_batch);
 
   return (g_is_discovering) ? OC_CONTINUE_DISCOVERY : OC_STOP_DISCOVERY;
 }
-bool ocf_adapter_discovery_internal(const char *resource_type) {
+bool ocf_adapter_discovery_internal(const char *resource_type, bool is_batch,
+                                    bool is_incremental,
+                                    unsigned int cache_ttl_ms) {
   if (g_is_discovering)
     return false;
   g_is_discovering = true;
+  g_is_discovery_batch = is_batch;
+  g_is_discovery_incremental = is_incremental;
+  g_discovery_cache_ttl =
+      (oc_clock_time_t)cache_ttl_ms * OC_CLOCK_SECOND / 1000;
+  expire_discovery_cache(is_incremental);
   oc_do_ip_discovery(resource_type, &oa_on_discovery, NULL);
   return true;
 }
@@ -211,31 +643,185 @@ OCF_REQUEST_INTERNAL_HANDLER(ocf_adapter_delete)
 OCF_REQUEST_INTERNAL(ocf_adapter_delete, oc_do_delete)
 
 OCF_REQUEST_INTERNAL_HANDLER(ocf_adapter_initPost)
-OCF_REQUEST_INTERNAL(ocf_adapter_initPost, oc_init_post)
-
 OCF_REQUEST_INTERNAL_HANDLER(ocf_adapter_initPut)
-OCF_REQUEST_INTERNAL(ocf_adapter_initPut, oc_init_put)
 
-bool ocf_adapter_post_internal(void) { return oc_do_post(); }
-bool ocf_adapter_put_internal(void) { return oc_do_put(); }
+// On JS thread: start recording a post or put request
+static bool init_pending_request(bool is_put, int requestId,
+                                 void *ocf_endpoint_nobject, const char *uri,
+                                 const char *query, int qos,
+                                 bool isPayloadBuffer) {
+  oa_pending_request_t *request;
+
+  // The request of initPost() without post() is dropped.
+  if (g_building_request != NULL) {
+    destroy_pending_request(g_building_request);
+    g_building_request = NULL;
+  }
+
+  request = (oa_pending_request_t *)calloc(1, sizeof(oa_pending_request_t));
+  if (request == NULL)
+    return false;
+  request->uri = copy_string(uri);
+  request->query = copy_string(query);
+  if (request->uri == NULL || request->query == NULL) {
+    destroy_pending_request(request);
+    return false;
+  }
+  request->is_put = is_put;
+  request->request_id = requestId;
+  request->is_payload_buffer = isPayloadBuffer;
+  // The JS endpoint object may be collected before OCF thread sends it.
+  memcpy(&request->endpoint, ocf_endpoint_nobject, sizeof(oc_endpoint_t));
+  request->endpoint.next = NULL;
+  request->qos = (qos == HIGH_QOS) ? HIGH_QOS : LOW_QOS;
+
+  g_building_request = request;
+  return true;
+}
+
+bool ocf_adapter_initPost_internal(int requestId, void *ocf_endpoint_nobject,
+                                   const char *uri, const char *query, int qos,
+                                   bool isPayloadBuffer) {
+  return init_pending_request(false, requestId, ocf_endpoint_nobject, uri,
+                              query, qos, isPayloadBuffer);
+}
+
+bool ocf_adapter_initPut_internal(int requestId, void *ocf_endpoint_nobject,
+                                  const char *uri, const char *query, int qos,
+                                  bool isPayloadBuffer) {
+  return init_pending_request(true, requestId, ocf_endpoint_nobject, uri,
+                              query, qos, isPayloadBuffer);
+}
+
+// On JS thread: queue the recorded request to OCF thread
+static bool queue_pending_request(bool is_put) {
+  oa_pending_request_t *request = g_building_request;
+  g_building_request = NULL;
+  if (request == NULL)
+    return false;
+  if (request->is_put != is_put || request->is_invalid) {
+    destroy_pending_request(request);
+    return false;
+  }
+
+  pthread_mutex_lock(&g_pending_requests_mutex);
+  if (g_pending_requests_tail == NULL)
+    g_pending_requests_head = request;
+  else
+    g_pending_requests_tail->next = request;
+  g_pending_requests_tail = request;
+  pthread_mutex_unlock(&g_pending_requests_mutex);
+
+  signal_event_loop();
+  return true;
+}
+
+bool ocf_adapter_post_internal(void) { return queue_pending_request(false); }
+bool ocf_adapter_put_internal(void) { return queue_pending_request(true); }
+
+// On OCF thread: the request that cannot be sent gets an error response, so
+// that its JS handler is called and removed.
+static void emit_pending_request_failure(oa_pending_request_t *request) {
+  oa_client_response_event_data_t *event_data;
+  fprintf(stderr, "ERROR: OCF %s request to %s cannot be sent\n",
+          (request->is_put) ? "put" : "post", request->uri);
+
+  event_data =
+      (oa_client_response_event_data_t *)oa_alloc_response_event_data();
+  if (event_data == NULL)
+    return;
+  event_data->payload_string = (char *)oa_alloc_payload(1);
+  event_data->endpoint = malloc(sizeof(oc_endpoint_t));
+  if (event_data->payload_string == NULL || event_data->endpoint == NULL) {
+    free(event_data->endpoint);
+    if (event_data->payload_string != NULL)
+      oa_free_event_data(event_data->payload_string);
+    oa_free_event_data(event_data);
+    return;
+  }
+  memcpy(event_data->endpoint, &request->endpoint, sizeof(oc_endpoint_t));
+  event_data->status_code = OC_STATUS_INTERNAL_SERVER_ERROR;
+  event_data->request_id = request->request_id;
+  event_data->is_payload_buffer = false;
+  event_data->payload_buffer = NULL;
+  event_data->payload_buffer_length = 0;
+  event_data->payload_string[0] = '\0';
+  event_data->payload_string_length = 0;
+
+  if (request->is_put) {
+    EMIT_ANT_ASYNC_EVENT(ocf_adapter_initPut, event_data->request_id,
+                         (void *)event_data, false);
+  } else {
+    EMIT_ANT_ASYNC_EVENT(ocf_adapter_initPost, event_data->request_id,
+                         (void *)event_data, false);
+  }
+}
+
+// On OCF thread: build and send the queued requests
+static void send_pending_request(oa_pending_request_t *request) {
+  int user_data =
+      (request->is_payload_buffer) ? request->request_id : -request->request_id;
+  bool res;
+  if (request->is_put) {
+    res = oc_init_put(request->uri, &request->endpoint, request->query,
+                      &ocf_adapter_initPut_handler, request->qos,
+                      (void *)user_data);
+  } else {
+    res = oc_init_post(request->uri, &request->endpoint, request->query,
+                       &ocf_adapter_initPost_handler, request->qos,
+                       (void *)user_data);
+  }
+  if (res) {
+    if (request->has_payload)
+      encode_rep_values(request->values);
+    res = (request->is_put) ? oc_do_put() : oc_do_post();
+  }
+  if (!res)
+    emit_pending_request_failure(request);
+}
+
+static void send_pending_requests(bool is_quitting) {
+  oa_pending_request_t *request;
+  pthread_mutex_lock(&g_pending_requests_mutex);
+  request = g_pending_requests_head;
+  g_pending_requests_head = NULL;
+  g_pending_requests_tail = NULL;
+  pthread_mutex_unlock(&g_pending_requests_mutex);
+
+  while (request != NULL) {
+    oa_pending_request_t *next = request->next;
+    if (!is_quitting)
+      send_pending_request(request);
+    destroy_pending_request(request);
+    request = next;
+  }
+}
 
 void initOCFAdapter(void) {
   // Empty function
 }
 
-bool g_is_ocf_thread_locked = false;
-pthread_mutex_t g_ocf_thread_lock_mutex;
-pthread_cond_t g_ocf_thread_lock_cond;
-void lock_ocf_thread(void) {
-  pthread_mutex_lock(&g_ocf_thread_lock_mutex);
-  g_is_ocf_thread_locked = true;
-  pthread_mutex_unlock(&g_ocf_thread_lock_mutex);
-}
-void unlock_ocf_thread(void) {
-  pthread_mutex_lock(&g_ocf_thread_lock_mutex);
-  g_is_ocf_thread_locked = false;
-  pthread_cond_signal(&g_ocf_thread_lock_cond);
-  pthread_mutex_unlock(&g_ocf_thread_lock_mutex);
+// On OCF thread: wait for the next timer or a wakeup
+static void wait_event_loop(oc_clock_time_t next_event) {
+  struct epoll_event ev;
+  uint64_t count;
+  int timeout_ms = -1;
+
+  if (next_event != 0) {
+    oc_clock_time_t now = oc_clock_time();
+    if (next_event <= now) {
+      return;
+    }
+    // Round up not to wake up before the timer expires
+    timeout_ms = (int)(((next_event - now) * 1000 + OC_CLOCK_SECOND - 1) /
+                       OC_CLOCK_SECOND);
+  }
+
+  if (epoll_wait(g_epoll_fd, &ev, 1, timeout_ms) > 0) {
+    // Consume all the wakeups accumulated so far at once
+    while (read(g_event_fd, &count, sizeof(count)) == sizeof(count))
+      ;
+  }
 }
 
 void *ocf_thread_fn(void *arg) {
@@ -263,27 +849,12 @@ void *ocf_thread_fn(void *arg) {
   if (init < 0)
     return NULL;
 
-  pthread_mutex_init(&g_ocf_thread_lock_mutex, NULL);
-  pthread_cond_init(&g_ocf_thread_lock_cond, NULL);
-
   while (g_thread_quit != 1) {
-    pthread_mutex_lock(&g_ocf_thread_lock_mutex);
-    if (g_is_ocf_thread_locked) {
-      pthread_cond_wait(&g_ocf_thread_lock_cond, &g_ocf_thread_lock_mutex);
-    }
-    pthread_mutex_unlock(&g_ocf_thread_lock_mutex);
-
+    send_pending_requests(false);
     next_event = oc_main_poll();
-    pthread_mutex_lock(&mutex);
-    if (next_event == 0) {
-      pthread_cond_wait(&cv, &mutex);
-    } else {
-      ts.tv_sec = (next_event / OC_CLOCK_SECOND);
-      ts.tv_nsec = (next_event % OC_CLOCK_SECOND) * 1.e09 / OC_CLOCK_SECOND;
-      pthread_cond_timedwait(&cv, &mutex, &ts);
-    }
-    pthread_mutex_unlock(&mutex);
+    wait_event_loop(next_event);
   }
+  send_pending_requests(true);
 
   oc_main_shutdown();
   printf("OCF thread terminates...\n");
@@ -291,14 +862,18 @@ void *ocf_thread_fn(void *arg) {
   return NULL;
 }
 
+// It can be called on any thread and in the signal handler.
 void signal_event_loop(void) {
-  pthread_mutex_lock(&mutex);
-  pthread_cond_signal(&cv);
-  pthread_mutex_unlock(&mutex);
+  uint64_t one = 1;
+  if (g_event_fd >= 0) {
+    // EAGAIN only means that a wakeup is already pending.
+    ssize_t res = write(g_event_fd, &one, sizeof(one));
+    (void)res;
+  }
 }
 
 void handle_signal(int signal) {
   (void)signal;
-  signal_event_loop();
   g_thread_quit = 1;
+  signal_event_loop();
 }
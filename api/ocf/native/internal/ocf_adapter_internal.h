@@ -20,8 +20,8 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
-#include "./ant_async.h"
-#include "./ll.h"
+#include "../../../common/native/internal/ant_async.h"
+#include "../../../common/native/internal/slab.h"
 
 ANT_ASYNC_DECL_IN_HEADER(ocf_adapter_onPrepareEventLoop);
 ANT_ASYNC_DECL_IN_HEADER(ocf_adapter_onPrepareServer);
@@ -48,20 +48,51 @@ void ocf_adapter_sendResponse_internal(void *ocf_request_nobject,
                                        int status_code);
 
 ANT_ASYNC_DECL_IN_HEADER(ocf_adapter_discovery);
+// Change of a discovered resource, compared with the discovery cache
+#define OA_DISCOVERY_CACHE_DEFAULT_TTL_MS 60000
+enum oa_discovery_change_e {
+  OA_DISCOVERY_NEW,
+  OA_DISCOVERY_CHANGED,
+  OA_DISCOVERY_REMOVED
+};
+// Discovery event data
+// The strings (device id, uri and types) are packed into the inline buffer,
+// or into a buffer of the payload pool if they do not fit in it.
+#define OA_DISCOVERY_MAX_TYPES 8
+#define OA_DISCOVERY_INLINE_STRINGS_SIZE 256
 struct oa_discovery_event_data_s {
+  char *device_id;
   char *uri;
-  ll_t *types;
+  char *types[OA_DISCOVERY_MAX_TYPES];
+  int types_count;
   int interface_mask;
-  void *endpoint;
+  void *endpoint; // NULL if the resource is removed
+  int change;
+  char *strings;
+  char inline_strings[OA_DISCOVERY_INLINE_STRINGS_SIZE];
 };
 typedef struct oa_discovery_event_data_s oa_discovery_event_data_t;
 void oa_discovery_event_data_destroyer(void *item);
-void oa_discovery_event_types_destroyer(void *item);
 void ocf_endpoint_destroy(void *handle);
 
+// Event payload pools
+// Discovery and response event data, and the payloads of responses are
+// allocated from slabs of OCF module instead of the heap.
+void ocf_adapter_initEventPools_internal(void);
+oa_discovery_event_data_t *
+oa_new_discovery_event_data(const char *device_id, const char *uri,
+                            const char **types, int types_count);
+void *oa_alloc_response_event_data(void);
+void *oa_alloc_payload(size_t size);
+#define oa_free_event_data(ptr) slab_free(ptr)
+
 bool ocf_adapter_isDiscovering_internal(void);
 void ocf_adapter_stopDiscovery_internal(void);
-bool ocf_adapter_discovery_internal(const char *resource_type);
+bool ocf_adapter_isDiscoveryBatch_internal(void);
+bool ocf_adapter_discovery_internal(const char *resource_type, bool is_batch,
+                                    bool is_incremental,
+                                    unsigned int cache_ttl_ms);
+void ocf_adapter_clearDiscoveryCache_internal(void);
 
 struct oa_client_response_event_data_s {
   void *endpoint;
@@ -96,9 +127,6 @@ bool ocf_adapter_put_internal(void);
 
 void initOCFAdapter(void);
 
-void lock_ocf_thread(void);
-void unlock_ocf_thread(void);
-
 #define KEY_BUFFER_VALUE "bufferValue"
 #define KEY_STRING_VALUE "stringValue"
 
@@ -125,10 +153,16 @@ void unlock_ocf_thread(void);
 #define OCF_REQUEST_INTERNAL_HANDLER(type)                                     \
   static void type##_handler(oc_client_response_t *data) {                     \
     oa_client_response_event_data_t *event_data;                               \
-    event_data = (oa_client_response_event_data_t *)malloc(                    \
-        sizeof(oa_client_response_event_data_t));                              \
+    event_data =                                                               \
+        (oa_client_response_event_data_t *)oa_alloc_response_event_data();     \
+    if (event_data == NULL)                                                    \
+      return;                                                                  \
                                                                                \
     oc_endpoint_t *endpoint = (oc_endpoint_t *)malloc(sizeof(oc_endpoint_t));  \
+    if (endpoint == NULL) {                                                    \
+      oa_free_event_data(event_data);                                          \
+      return;                                                                  \
+    }                                                                          \
     memcpy(endpoint, data->endpoint, sizeof(oc_endpoint_t));                   \
     event_data->endpoint = (void *)endpoint;                                   \
     event_data->status_code = data->code;                                      \
@@ -149,7 +183,13 @@ void unlock_ocf_thread(void);
           oc_rep_get_byte_string(data->payload, KEY_BUFFER_VALUE,              \
                                  &payload_buffer, &payload_buffer_length);     \
       assert(result_getstr);                                                   \
-      event_data->payload_buffer = (char *)malloc(payload_buffer_length);      \
+      event_data->payload_buffer =                                             \
+          (char *)oa_alloc_payload(payload_buffer_length);                     \
+      if (event_data->payload_buffer == NULL) {                                \
+        free(endpoint);                                                        \
+        oa_free_event_data(event_data);                                        \
+        return;                                                                \
+      }                                                                        \
       memcpy(event_data->payload_buffer, payload_buffer,                       \
              payload_buffer_length);                                           \
       event_data->payload_buffer_length = payload_buffer_length;               \
@@ -160,14 +200,28 @@ void unlock_ocf_thread(void);
           oc_rep_get_string(data->payload, KEY_STRING_VALUE, &payload_string,  \
                             &payload_string_length);                           \
       assert(result_getstr);                                                   \
-      event_data->payload_string = (char *)malloc(payload_string_length + 1);  \
+      event_data->payload_string =                                             \
+          (char *)oa_alloc_payload(payload_string_length + 1);                 \
+      if (event_data->payload_string == NULL) {                                \
+        oa_free_event_data(event_data->payload_buffer);                        \
+        free(endpoint);                                                        \
+        oa_free_event_data(event_data);                                        \
+        return;                                                                \
+      }                                                                        \
       memcpy(event_data->payload_string, payload_string,                       \
              payload_string_length);                                           \
+      event_data->payload_string[payload_string_length] = '\0';                \
+      event_data->payload_string_length = payload_string_length;               \
     } else {                                                                   \
       event_data->payload_string_length =                                      \
           oc_rep_to_json(data->payload, NULL, 0, true);                        \
       event_data->payload_string =                                             \
-          (char *)malloc(event_data->payload_string_length + 1);               \
+          (char *)oa_alloc_payload(event_data->payload_string_length + 1);     \
+      if (event_data->payload_string == NULL) {                                \
+        free(endpoint);                                                        \
+        oa_free_event_data(event_data);                                        \
+        return;                                                                \
+      }                                                                        \
       oc_rep_to_json(data->payload, event_data->payload_string,                \
                      event_data->payload_string_length + 1, true);             \
     }                                                                          \
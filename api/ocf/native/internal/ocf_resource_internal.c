@@ -31,7 +31,7 @@
 #include <port/oc_clock.h>
 
 #include "../../../common/native/ant_common.h"
-#include "./ant_async.h"
+#include "../../../common/native/internal/ant_async.h"
 
 #include "./ocf_resource_internal.h"
 
@@ -54,7 +54,9 @@ void *ocf_resource_constructor_internal(const char *name, const char *uri,
 
 bool ocf_resource_destroyer_internal(void *ocf_resource_nobject) {
   oc_resource_t *resource = (oc_resource_t *)ocf_resource_nobject;
-  return oc_delete_resource(resource);
+  bool result = oc_delete_resource(resource);
+  ocf_resource_disableCachedRep_internal(ocf_resource_nobject);
+  return result;
 }
 
 // OCFResource.setDiscoverable()
@@ -132,3 +134,226 @@ void ocf_resource_handler(oc_request_t *request,
   EMIT_ANT_ASYNC_EVENT(ocf_resource_setHandler, handler_id, (void *)event_data,
                        true);
 }
+
+// OCFResource.setCachedRepresentation()
+typedef struct or_cached_value_s {
+  char *key;
+  or_cached_value_type_t type;
+  union {
+    bool boolean;
+    int integer;
+    double number;
+  } scalar;
+  uint8_t *bytes; // string (NULL-terminated) or byte array
+  size_t length;
+  struct or_cached_value_s *next;
+} or_cached_value_t;
+
+typedef struct or_cached_rep_s {
+  oc_resource_t *resource;
+  pthread_mutex_t mutex; // JS thread writes values, OCF thread reads them
+  or_cached_value_t *values;
+  struct or_cached_rep_s *next;
+} or_cached_rep_t;
+
+// The list is changed only on JS thread.
+static or_cached_rep_t *g_cached_reps = NULL;
+
+static void encode_cached_values(or_cached_rep_t *cached_rep) {
+  for (or_cached_value_t *v = cached_rep->values; v != NULL; v = v->next) {
+    g_err |= cbor_encode_text_string(&root_map, v->key, strlen(v->key));
+    switch (v->type) {
+    case OR_CACHED_VALUE_BOOLEAN:
+      g_err |= cbor_encode_boolean(&root_map, v->scalar.boolean);
+      break;
+    case OR_CACHED_VALUE_INT:
+      g_err |= cbor_encode_int(&root_map, v->scalar.integer);
+      break;
+    case OR_CACHED_VALUE_DOUBLE:
+      g_err |= cbor_encode_double(&root_map, v->scalar.number);
+      break;
+    case OR_CACHED_VALUE_STRING:
+      g_err |= cbor_encode_text_string(&root_map, (const char *)v->bytes,
+                                       v->length);
+      break;
+    case OR_CACHED_VALUE_BYTE_ARRAY:
+      g_err |= cbor_encode_byte_string(&root_map, v->bytes, v->length);
+      break;
+    }
+  }
+}
+
+static void ocf_resource_cached_handler(oc_request_t *request,
+                                        oc_interface_mask_t interface_mask,
+                                        void *user_data) {
+  or_cached_rep_t *cached_rep = (or_cached_rep_t *)user_data;
+
+  pthread_mutex_lock(&cached_rep->mutex);
+  oc_rep_start_root_object();
+  switch (interface_mask) {
+  case OC_IF_BASELINE:
+    // Common properties of the resource (rt, if, ...)
+    oc_process_baseline_interface(request->resource);
+    /* fall through */
+  default:
+    encode_cached_values(cached_rep);
+    break;
+  }
+  oc_rep_end_root_object();
+  pthread_mutex_unlock(&cached_rep->mutex);
+
+  oc_send_response(request, OC_STATUS_OK);
+}
+
+static or_cached_rep_t *find_cached_rep(oc_resource_t *resource,
+                                        or_cached_rep_t **prev_out) {
+  or_cached_rep_t *prev = NULL;
+  for (or_cached_rep_t *c = g_cached_reps; c != NULL; c = c->next) {
+    if (c->resource == resource) {
+      if (prev_out != NULL)
+        *prev_out = prev;
+      return c;
+    }
+    prev = c;
+  }
+  return NULL;
+}
+
+void *ocf_resource_enableCachedRep_internal(void *ocf_resource_nobject) {
+  oc_resource_t *resource = (oc_resource_t *)ocf_resource_nobject;
+  or_cached_rep_t *cached_rep = find_cached_rep(resource, NULL);
+  if (cached_rep != NULL)
+    return (void *)cached_rep;
+
+  cached_rep = (or_cached_rep_t *)malloc(sizeof(or_cached_rep_t));
+  if (cached_rep == NULL)
+    return NULL;
+  cached_rep->resource = resource;
+  pthread_mutex_init(&cached_rep->mutex, NULL);
+  cached_rep->values = NULL;
+  cached_rep->next = g_cached_reps;
+  g_cached_reps = cached_rep;
+
+  oc_resource_set_request_handler(resource, OC_GET,
+                                  ocf_resource_cached_handler,
+                                  (void *)cached_rep);
+  return (void *)cached_rep;
+}
+
+static bool is_cached_value_same(or_cached_value_t *v,
+                                 or_cached_value_type_t type,
+                                 const void *value, size_t length) {
+  if (v->type != type)
+    return false;
+  switch (type) {
+  case OR_CACHED_VALUE_BOOLEAN:
+    return v->scalar.boolean == *(const bool *)value;
+  case OR_CACHED_VALUE_INT:
+    return v->scalar.integer == *(const int *)value;
+  case OR_CACHED_VALUE_DOUBLE:
+    return v->scalar.number == *(const double *)value;
+  default:
+    return v->length == length && memcmp(v->bytes, value, length) == 0;
+  }
+}
+
+// Returns true if the cached value is changed.
+bool ocf_resource_setCachedValue_internal(void *cached_rep_ptr,
+                                          const char *key,
+                                          or_cached_value_type_t type,
+                                          const void *value, size_t length) {
+  or_cached_rep_t *cached_rep = (or_cached_rep_t *)cached_rep_ptr;
+  or_cached_value_t *v, *last = NULL;
+  uint8_t *bytes = NULL;
+  bool is_new = false;
+
+  // Only JS thread changes the values, so they can be read without the lock.
+  for (v = cached_rep->values; v != NULL; v = v->next) {
+    if (strcmp(v->key, key) == 0)
+      break;
+    last = v;
+  }
+  if (v != NULL && is_cached_value_same(v, type, value, length))
+    return false;
+
+  // Prepare the new value out of the lock
+  if (type == OR_CACHED_VALUE_STRING || type == OR_CACHED_VALUE_BYTE_ARRAY) {
+    bytes = (uint8_t *)malloc(length + 1);
+    if (bytes == NULL)
+      return false;
+    memcpy(bytes, value, length);
+    bytes[length] = '\0';
+  }
+  if (v == NULL) {
+    v = (or_cached_value_t *)calloc(1, sizeof(or_cached_value_t));
+    if (v == NULL) {
+      free(bytes);
+      return false;
+    }
+    v->key = (char *)malloc(strlen(key) + 1);
+    if (v->key == NULL) {
+      free(bytes);
+      free(v);
+      return false;
+    }
+    strncpy(v->key, key, strlen(key) + 1);
+    is_new = true;
+  }
+
+  pthread_mutex_lock(&cached_rep->mutex);
+  uint8_t *old_bytes = v->bytes;
+  v->type = type;
+  v->bytes = bytes;
+  v->length = length;
+  switch (type) {
+  case OR_CACHED_VALUE_BOOLEAN:
+    v->scalar.boolean = *(const bool *)value;
+    break;
+  case OR_CACHED_VALUE_INT:
+    v->scalar.integer = *(const int *)value;
+    break;
+  case OR_CACHED_VALUE_DOUBLE:
+    v->scalar.number = *(const double *)value;
+    break;
+  default:
+    break;
+  }
+  if (is_new) {
+    // Append the new value to keep the order of keys
+    if (last == NULL)
+      cached_rep->values = v;
+    else
+      last->next = v;
+  }
+  pthread_mutex_unlock(&cached_rep->mutex);
+
+  free(old_bytes);
+  return true;
+}
+
+void ocf_resource_disableCachedRep_internal(void *ocf_resource_nobject) {
+  oc_resource_t *resource = (oc_resource_t *)ocf_resource_nobject;
+  or_cached_rep_t *prev = NULL;
+  or_cached_rep_t *cached_rep = find_cached_rep(resource, &prev);
+  if (cached_rep == NULL)
+    return;
+
+  if (prev == NULL)
+    g_cached_reps = cached_rep->next;
+  else
+    prev->next = cached_rep->next;
+
+  // Wait for OCF thread that may be encoding the values
+  pthread_mutex_lock(&cached_rep->mutex);
+  or_cached_value_t *v = cached_rep->values;
+  while (v != NULL) {
+    or_cached_value_t *next = v->next;
+    free(v->key);
+    free(v->bytes);
+    free(v);
+    v = next;
+  }
+  pthread_mutex_unlock(&cached_rep->mutex);
+  pthread_mutex_destroy(&cached_rep->mutex);
+  free(cached_rep);
+}
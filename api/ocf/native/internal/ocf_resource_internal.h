@@ -19,7 +19,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
-#include "./ant_async.h"
+#include "../../../common/native/internal/ant_async.h"
 
 struct or_setHandler_event_data_s {
   void *request;
@@ -59,4 +59,23 @@ ANT_ASYNC_DECL_IN_HEADER(ocf_resource_setHandler);
 void ocf_resource_setHandler_internal(void *ocf_resource_nobject,
                                       int handler_id, int method);
 
+// Cached representation
+// GET requests (including periodic observe notifications) on a resource in
+// the cached representation mode are served by OCF thread from the values
+// pushed by JS thread, without calling JS handler.
+enum or_cached_value_type_e {
+  OR_CACHED_VALUE_BOOLEAN,
+  OR_CACHED_VALUE_INT,
+  OR_CACHED_VALUE_DOUBLE,
+  OR_CACHED_VALUE_STRING,
+  OR_CACHED_VALUE_BYTE_ARRAY
+};
+typedef enum or_cached_value_type_e or_cached_value_type_t;
+
+void *ocf_resource_enableCachedRep_internal(void *ocf_resource_nobject);
+bool ocf_resource_setCachedValue_internal(void *cached_rep, const char *key,
+                                          or_cached_value_type_t type,
+                                          const void *value, size_t length);
+void ocf_resource_disableCachedRep_internal(void *ocf_resource_nobject);
+
 #endif /* !defined(__OCF_RESOURCE_INTERNAL_H__) */
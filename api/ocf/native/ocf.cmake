@@ -2,6 +2,8 @@ get_filename_component(MODULE_DIR ${CMAKE_CURRENT_LIST_FILE} DIRECTORY)
 
 set(MODULE_NAME "ocf")
 
+include(${MODULE_DIR}/../../common/native/ant_common.cmake)
+
 add_subdirectory(${MODULE_DIR}/internal/ ${CMAKE_BINARY_DIR}/out/ocf/)
 
 list(APPEND EXTERNAL_LIBS ocf)
\ No newline at end of file
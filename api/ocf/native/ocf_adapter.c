@@ -26,29 +26,28 @@
 
 #include "./ocf_adapter.h"
 
-// Linked list destroyers
+// Event data destroyers
 void oa_discovery_event_data_destroyer(void *item) {
   oa_discovery_event_data_t *event;
   event = (oa_discovery_event_data_t *)item;
-  free(event->uri);
-  ll_delete(event->types);
-  free(event);
+  if (event->strings != event->inline_strings) {
+    oa_free_event_data(event->strings);
+  }
+  oa_free_event_data(event);
 }
 void oa_response_event_data_destroyer(void *item) {
   oa_client_response_event_data_t *event;
   event = (oa_client_response_event_data_t *)item;
   if (event->is_payload_buffer) {
-    free(event->payload_buffer);
+    oa_free_event_data(event->payload_buffer);
   }
-  free(event->payload_string);
+  oa_free_event_data(event->payload_string);
 
-  free(event);
+  oa_free_event_data(event);
 }
-void oa_discovery_event_types_destroyer(void *item) { free(item); }
 
 // OCFAdapter.initialize()
 JS_FUNCTION(ocf_adapter_initialize) {
-  init_ant_async_list();
   ocf_adapter_init();
   ocf_resource_init();
   return jerry_create_undefined();
@@ -56,7 +55,7 @@ JS_FUNCTION(ocf_adapter_initialize) {
 
 // OCFAdapter.deinitialize()
 JS_FUNCTION(ocf_adapter_deinitialize) {
-  destroy_ant_async_list();
+  destroy_ant_asyncs("ocf_");
   return jerry_create_undefined();
 }
 
@@ -316,7 +315,99 @@ JS_FUNCTION(ocf_adapter_repSetByteArray) {
 // OCFAdapter.repEndRootObject()
 ANT_API_VOID_TO_VOID(ocf_adapter, repEndRootObject);
 
+// Copy a JS string into buf, or into a heap buffer if buf is too small.
+// The returned string should be released by ocf_release_js_string_copy().
+char *ocf_get_js_string_copy(jerry_value_t jsString, char *buf,
+                             size_t buf_size) {
+  jerry_size_t size = jerry_get_utf8_string_size(jsString);
+  char *str = (size < buf_size) ? buf : (char *)malloc(size + 1);
+  if (str == NULL)
+    return NULL;
+  jerry_size_t copied =
+      jerry_string_to_utf8_char_buffer(jsString, (jerry_char_t *)str, size);
+  str[copied] = '\0';
+  return str;
+}
+void ocf_release_js_string_copy(char *str, char *buf) {
+  if (str != buf)
+    free(str);
+}
+
+static bool encode_js_rep_value(const char *key, jerry_value_t jsValue) {
+  if (jerry_value_is_boolean(jsValue)) {
+    ocf_adapter_repSetBoolean_internal(key, jerry_get_boolean_value(jsValue));
+  } else if (jerry_value_is_number(jsValue)) {
+    double value = jerry_get_number_value(jsValue);
+    if (value >= INT32_MIN && value <= INT32_MAX && value == (int)value) {
+      ocf_adapter_repSetInt_internal(key, (int)value);
+    } else {
+      ocf_adapter_repSetDouble_internal(key, value);
+    }
+  } else if (jerry_value_is_string(jsValue)) {
+    char value_buf[OCF_STRING_STACK_SIZE];
+    char *value =
+        ocf_get_js_string_copy(jsValue, value_buf, sizeof(value_buf));
+    if (value == NULL)
+      return false;
+    ocf_adapter_repSetString_internal(key, value);
+    ocf_release_js_string_copy(value, value_buf);
+  } else if (jerry_value_is_object(jsValue) &&
+             iotjs_jbuffer_get_bufferwrap_ptr(jsValue) != NULL) {
+    iotjs_bufferwrap_t *valueBuffer = iotjs_bufferwrap_from_jbuffer(jsValue);
+    ocf_adapter_repSetByteArray_internal(
+        key, (const uint8_t *)valueBuffer->buffer,
+        iotjs_bufferwrap_length(valueBuffer));
+  } else {
+    printf("repSetObject(): Not supported type of %s\n", key);
+  }
+  return true;
+}
+
+// Encode own enumerable properties of a JS object as the root object of
+// OCRepresentation. It replaces repStartRootObject(), repSet() for each key
+// and repEndRootObject() with one native call.
+static bool encode_js_rep_object(jerry_value_t jsObject) {
+  bool result = true;
+  jerry_value_t jsKeys = jerry_get_object_keys(jsObject);
+  if (jerry_value_is_error(jsKeys)) {
+    jerry_release_value(jsKeys);
+    return false;
+  }
+  uint32_t keys_count = jerry_get_array_length(jsKeys);
+
+  ocf_adapter_repStartRootObject_internal();
+  for (uint32_t i = 0; i < keys_count && result; i++) {
+    jerry_value_t jsKey = jerry_get_property_by_index(jsKeys, i);
+    jerry_value_t jsValue = jerry_get_property(jsObject, jsKey);
+    char key_buf[OCF_STRING_STACK_SIZE];
+    char *key = ocf_get_js_string_copy(jsKey, key_buf, sizeof(key_buf));
+    if (key != NULL) {
+      result = encode_js_rep_value(key, jsValue);
+      ocf_release_js_string_copy(key, key_buf);
+    } else {
+      result = false;
+    }
+    jerry_release_value(jsValue);
+    jerry_release_value(jsKey);
+  }
+  ocf_adapter_repEndRootObject_internal();
+
+  jerry_release_value(jsKeys);
+  return result;
+}
+
+// OCFAdapter.repSetObject()
+JS_FUNCTION(ocf_adapter_repSetObject) {
+  jerry_value_t argObject;
+  DJS_CHECK_ARGS(1, object);
+  argObject = JS_GET_ARG(0, object);
+
+  bool result = encode_js_rep_object(argObject);
+  return jerry_create_boolean(result);
+}
+
 // OCFAdapter.sendResponse()
+// The optional 3rd argument is the payload object encoded by repSetObject().
 JS_FUNCTION(ocf_adapter_sendResponse) {
   jerry_value_t argRequest;
   int argStatusCode;
@@ -325,6 +416,10 @@ JS_FUNCTION(ocf_adapter_sendResponse) {
   argStatusCode = (int)JS_GET_ARG(1, number);
   JS_DECLARE_PTR2(argRequest, void, ocf_request_nobject, ocf_request);
 
+  if (jargc > 2 && jerry_value_is_object(jargv[2])) {
+    encode_js_rep_object(jargv[2]);
+  }
+
   ocf_adapter_sendResponse_internal(ocf_request_nobject, argStatusCode);
   return jerry_create_undefined();
 }
@@ -346,15 +441,73 @@ JS_FUNCTION(ocf_adapter_stopDiscovery) {
   return jerry_create_undefined();
 }
 
+// OCFAdapter.clearDiscoveryCache()
+JS_FUNCTION(ocf_adapter_clearDiscoveryCache) {
+  ocf_adapter_clearDiscoveryCache_internal();
+  return jerry_create_undefined();
+}
+
+// OCFAdapter.setEventBudget()
+JS_FUNCTION(ocf_adapter_setEventBudget) {
+  DJS_CHECK_ARGS(1, number);
+  unsigned int argBudgetUs = (unsigned int)JS_GET_ARG(0, number);
+  set_ant_async_budget(argBudgetUs);
+  return jerry_create_undefined();
+}
+
+// OCFAdapter.getEventMetrics()
+JS_FUNCTION(ocf_adapter_getEventMetrics) {
+  return create_js_ant_async_metrics("ocf_");
+}
+
+// OCFAdapter.getMemoryStats()
+#define OA_MAX_SLAB_STATS 16
+JS_FUNCTION(ocf_adapter_getMemoryStats) {
+  slab_stats_t stats[OA_MAX_SLAB_STATS];
+  size_t count = slab_get_stats_by_prefix("ocf_", stats, OA_MAX_SLAB_STATS);
+  jerry_value_t jsStats = jerry_create_array((uint32_t)count);
+  for (size_t i = 0; i < count; i++) {
+    jerry_value_t jsItem = jerry_create_object();
+    jerry_value_t jsName =
+        jerry_create_string_from_utf8((const jerry_char_t *)stats[i].name);
+    iotjs_jval_set_property_jval(jsItem, "name", jsName);
+    iotjs_jval_set_property_number(jsItem, "objectSize",
+                                   (double)stats[i].object_size);
+    iotjs_jval_set_property_number(jsItem, "capacity",
+                                   (double)stats[i].capacity);
+    iotjs_jval_set_property_number(jsItem, "inUse", (double)stats[i].in_use);
+    iotjs_jval_set_property_number(jsItem, "inUseMax",
+                                   (double)stats[i].in_use_max);
+    iotjs_jval_set_property_number(jsItem, "chunks", (double)stats[i].chunks);
+    iotjs_jval_set_property_number(jsItem, "fallbacks",
+                                   (double)stats[i].fallbacks);
+    iotjs_jval_set_property_by_index(jsStats, (uint32_t)i, jsItem);
+    jerry_release_value(jsName);
+    jerry_release_value(jsItem);
+  }
+  return jsStats;
+}
+
 // OCFAdapter.discovery()
 ANT_ASYNC_DECL_FUNCS(ocf_adapter_discovery, oa_discovery_event_data_destroyer)
 JS_FUNCTION(ocf_adapter_discovery) {
   bool result;
   iotjs_string_t argResourceType;
   jerry_value_t argDiscoveryHandler;
-  DJS_CHECK_ARGS(2, string, function);
+  bool argIsBatch;
+  bool argIsIncremental = false;
+  unsigned int argCacheTTLMs = OA_DISCOVERY_CACHE_DEFAULT_TTL_MS;
+  DJS_CHECK_ARGS(3, string, function, boolean);
   argResourceType = JS_GET_ARG(0, string);
   argDiscoveryHandler = JS_GET_ARG(1, function);
+  argIsBatch = JS_GET_ARG(2, boolean);
+  // Optional: boolean isIncremental, number cacheTTLMs
+  if (jargc > 3 && jerry_value_is_boolean(jargv[3])) {
+    argIsIncremental = jerry_get_boolean_value(jargv[3]);
+  }
+  if (jargc > 4 && jerry_value_is_number(jargv[4])) {
+    argCacheTTLMs = (unsigned int)jerry_get_number_value(jargv[4]);
+  }
   const char *resource_type = iotjs_string_data(&argResourceType);
   if (strlen(resource_type) == 1 && resource_type[0] == ' ') {
     // If zero-length resource type is given, discover all the resources
@@ -364,66 +517,137 @@ JS_FUNCTION(ocf_adapter_discovery) {
   int zero = 0;
   result =
       REGISTER_JS_HANDLER(ocf_adapter_discovery, zero, argDiscoveryHandler);
-  result = result && ocf_adapter_discovery_internal(resource_type);
+  result = result && ocf_adapter_discovery_internal(resource_type, argIsBatch,
+                                                    argIsIncremental,
+                                                    argCacheTTLMs);
 
   iotjs_string_destroy(&argResourceType);
   return jerry_create_boolean(result);
 }
-ANT_UV_HANDLER_FUNCTION(ocf_adapter_discovery) {
-  // Get the first event
-  void *e;
-  while ((e = GET_FIRST_EVENT_FROM_ANT_ASYNC(ocf_adapter_discovery)) != NULL) {
-    ant_async_event_t *event = (ant_async_event_t *)e;
-    oa_discovery_event_data_t *event_data =
-        (oa_discovery_event_data_t *)event->data;
-    // Args 0: object endpoint
-    // set native pointer of OCFEndPoint with oc_endpoint_t
-    jerry_value_t jsEndpoint = jerry_create_object();
+// Discovered resource: endpoint, uri, types, interface_mask, device_id,
+// change
+#define DISCOVERY_ARGC 6
+static const char *g_discovery_change_names[] = {"new", "changed", "removed"};
+static void create_js_discovery_args(oa_discovery_event_data_t *event_data,
+                                     jerry_value_t *js_args) {
+  // Args 0: object endpoint (undefined if the resource is removed)
+  // set native pointer of OCFEndPoint with oc_endpoint_t
+  jerry_value_t jsEndpoint;
+  if (event_data->endpoint != NULL) {
+    jsEndpoint = jerry_create_object();
     jerry_set_object_native_pointer(jsEndpoint, event_data->endpoint,
                                     &ocf_endpoint_native_info);
     IOTJS_ASSERT(jerry_get_object_native_pointer(jsEndpoint, NULL,
                                                  &ocf_endpoint_native_info));
+  } else {
+    jsEndpoint = jerry_create_undefined();
+  }
 
-    // Args 1: string uri
-    jerry_value_t jsUri =
-        jerry_create_string_from_utf8((const jerry_char_t *)event_data->uri);
-
-    // Args 2: array<string> types
-    jerry_value_t jsTypes = jerry_create_object();
-    for (int i = 0; i < event_data->types->len; i++) {
-      char *type_item = (char *)ll_get_n(event_data->types, i);
-      jerry_value_t jsTypeItem =
-          jerry_create_string_from_utf8((const jerry_char_t *)type_item);
-      iotjs_jval_set_property_by_index(jsTypes, (uint32_t)i, jsTypeItem);
-      jerry_release_value(jsTypeItem);
-    }
+  // Args 1: string uri
+  jerry_value_t jsUri =
+      jerry_create_string_from_utf8((const jerry_char_t *)event_data->uri);
+
+  // Args 2: array<string> types
+  jerry_value_t jsTypes =
+      jerry_create_array((uint32_t)event_data->types_count);
+  for (int i = 0; i < event_data->types_count; i++) {
+    char *type_item = event_data->types[i];
+    jerry_value_t jsTypeItem =
+        jerry_create_string_from_utf8((const jerry_char_t *)type_item);
+    iotjs_jval_set_property_by_index(jsTypes, (uint32_t)i, jsTypeItem);
+    jerry_release_value(jsTypeItem);
+  }
+
+  // Args 3: int interface_mask
+  jerry_value_t jsInterfaceMask =
+      jerry_create_number((double)event_data->interface_mask);
+
+  js_args[0] = jsEndpoint;
+  js_args[1] = jsUri;
+  js_args[2] = jsTypes;
+  js_args[3] = jsInterfaceMask;
 
-    // Args 3: int interface_mask
-    jerry_value_t jsInterfaceMask =
-        jerry_create_number((double)event_data->interface_mask);
+  // Args 4: string device_id
+  js_args[4] = jerry_create_string_from_utf8(
+      (const jerry_char_t *)event_data->device_id);
+
+  // Args 5: string change
+  js_args[5] = jerry_create_string_from_utf8(
+      (const jerry_char_t *)g_discovery_change_names[event_data->change]);
+}
+static void release_js_discovery_args(jerry_value_t *js_args) {
+  for (int i = 0; i < DISCOVERY_ARGC; i++) {
+    jerry_release_value(js_args[i]);
+  }
+}
+// Batch mode: an array of {endpoint, uri, types, interfaceMask, deviceId,
+// change} is delivered per wakeup.
+static void deliver_discovery_batch(uint64_t drain_start_ns) {
+  void *e;
+  jerry_value_t jsBatch = jerry_create_array(0);
+  uint32_t batch_length = 0;
+  while (batch_length < ANT_ASYNC_EVENT_QUEUE_SIZE &&
+         (e = GET_NEXT_EVENT_FROM_ANT_ASYNC(ocf_adapter_discovery,
+                                            drain_start_ns)) != NULL) {
+    ant_async_event_t *event = (ant_async_event_t *)e;
+    jerry_value_t js_args[DISCOVERY_ARGC];
+    jerry_value_t jsItem = jerry_create_object();
+    create_js_discovery_args((oa_discovery_event_data_t *)event->data,
+                             js_args);
+    iotjs_jval_set_property_jval(jsItem, "endpoint", js_args[0]);
+    iotjs_jval_set_property_jval(jsItem, "uri", js_args[1]);
+    iotjs_jval_set_property_jval(jsItem, "types", js_args[2]);
+    iotjs_jval_set_property_jval(jsItem, "interfaceMask", js_args[3]);
+    iotjs_jval_set_property_jval(jsItem, "deviceId", js_args[4]);
+    iotjs_jval_set_property_jval(jsItem, "change", js_args[5]);
+    iotjs_jval_set_property_by_index(jsBatch, batch_length++, jsItem);
+    release_js_discovery_args(js_args);
+    jerry_release_value(jsItem);
+
+    // The event data has been copied to JS values
+    REMOVE_FIRST_EVENT_FROM_ANT_ASYNC(ocf_adapter_discovery);
+  }
 
+  if (batch_length > 0) {
+    int zero = 0;
     jerry_value_t js_handler =
-        GET_JS_HANDLER_FROM_ANT_ASYNC(ocf_adapter_discovery, event->key);
-    jerry_value_t js_args[] = {jsEndpoint, jsUri, jsTypes, jsInterfaceMask};
-    iotjs_invoke_callback(js_handler, jerry_create_undefined(), js_args, 4);
+        GET_JS_HANDLER_FROM_ANT_ASYNC(ocf_adapter_discovery, zero);
+    iotjs_invoke_callback(js_handler, jerry_create_undefined(), &jsBatch, 1);
+  }
+  jerry_release_value(jsBatch);
+}
+ANT_UV_HANDLER_FUNCTION(ocf_adapter_discovery) {
+  uint64_t drain_start_ns = START_ANT_ASYNC_DRAIN();
+  void *e;
+  if (ocf_adapter_isDiscoveryBatch_internal()) {
+    deliver_discovery_batch(drain_start_ns);
+    return;
+  }
 
-    jerry_release_value(jsEndpoint);
-    jerry_release_value(jsUri);
-    jerry_release_value(jsTypes);
-    jerry_release_value(jsInterfaceMask);
+  // Get the first event
+  while ((e = GET_NEXT_EVENT_FROM_ANT_ASYNC(ocf_adapter_discovery,
+                                            drain_start_ns)) != NULL) {
+    ant_async_event_t *event = (ant_async_event_t *)e;
+    jerry_value_t js_args[DISCOVERY_ARGC];
+    create_js_discovery_args((oa_discovery_event_data_t *)event->data,
+                             js_args);
 
-    // wake up OCF thread
-    wakeup_ant_async_sender(event);
+    jerry_value_t js_handler =
+        GET_JS_HANDLER_FROM_ANT_ASYNC(ocf_adapter_discovery, event->key);
+    iotjs_invoke_callback(js_handler, jerry_create_undefined(), js_args,
+                          DISCOVERY_ARGC);
+    release_js_discovery_args(js_args);
 
     // Remove the first event
-    // - It also calls the destroyer of the event and event data.
+    // - It also calls the destroyer of the event data, and wakes up OCF
+    //   thread waiting for the event.
     REMOVE_FIRST_EVENT_FROM_ANT_ASYNC(ocf_adapter_discovery);
   }
 }
 
 // OCFAdapter.observe()
 ANT_ASYNC_DECL_FUNCS(ocf_adapter_observe, oa_response_event_data_destroyer)
-OCF_REQUEST_JS_FUNCTION(ocf_adapter_observe, false)
+OCF_REQUEST_JS_FUNCTION(ocf_adapter_observe)
 OCF_REQUEST_UV_HANDLER_FUNCTION(ocf_adapter_observe, false)
 
 // OCFAdapter.stopObserve()
@@ -449,39 +673,38 @@ JS_FUNCTION(ocf_adapter_stopObserve) {
 
 // OCFAdapter.get()
 ANT_ASYNC_DECL_FUNCS(ocf_adapter_get, oa_response_event_data_destroyer)
-OCF_REQUEST_JS_FUNCTION(ocf_adapter_get, false)
+OCF_REQUEST_JS_FUNCTION(ocf_adapter_get)
 OCF_REQUEST_UV_HANDLER_FUNCTION(ocf_adapter_get, true)
 
 // OCFAdapter.delete()
 ANT_ASYNC_DECL_FUNCS(ocf_adapter_delete, oa_response_event_data_destroyer)
-OCF_REQUEST_JS_FUNCTION(ocf_adapter_delete, false)
+OCF_REQUEST_JS_FUNCTION(ocf_adapter_delete)
 OCF_REQUEST_UV_HANDLER_FUNCTION(ocf_adapter_delete, true)
 
 // OCFAdapter.initPost()
 ANT_ASYNC_DECL_FUNCS(ocf_adapter_initPost, oa_response_event_data_destroyer)
-OCF_REQUEST_JS_FUNCTION(ocf_adapter_initPost, true)
+OCF_REQUEST_JS_FUNCTION(ocf_adapter_initPost)
 OCF_REQUEST_UV_HANDLER_FUNCTION(ocf_adapter_initPost, true)
 
 // OCFAdapter.initPut()
 ANT_ASYNC_DECL_FUNCS(ocf_adapter_initPut, oa_response_event_data_destroyer)
-OCF_REQUEST_JS_FUNCTION(ocf_adapter_initPut, true)
+OCF_REQUEST_JS_FUNCTION(ocf_adapter_initPut)
 OCF_REQUEST_UV_HANDLER_FUNCTION(ocf_adapter_initPut, true)
 
 // OCFAdapter.post()
 JS_FUNCTION(ocf_adapter_post) {
   bool result = ocf_adapter_post_internal();
-  unlock_ocf_thread();
   return jerry_create_boolean(result);
 }
 
 // OCFAdapter.put()
 JS_FUNCTION(ocf_adapter_put) {
   bool result = ocf_adapter_put_internal();
-  unlock_ocf_thread();
   return jerry_create_boolean(result);
 }
 
 void ocf_adapter_init(void) {
+  ocf_adapter_initEventPools_internal();
   INIT_ANT_ASYNC(ocf_adapter_onPrepareEventLoop, NULL);
   INIT_ANT_ASYNC(ocf_adapter_onPrepareServer, NULL);
   INIT_ANT_ASYNC(ocf_adapter_onPrepareClient, NULL);
@@ -520,6 +743,7 @@ void InitOCFAdapterNative(jerry_value_t ocfNative) {
   REGISTER_ANT_API(ocfNative, ocf_adapter, repSetString);
   REGISTER_ANT_API(ocfNative, ocf_adapter, repSetByteArray);
   REGISTER_ANT_API(ocfNative, ocf_adapter, repEndRootObject);
+  REGISTER_ANT_API(ocfNative, ocf_adapter, repSetObject);
 
   // Send Response on Server-side
   REGISTER_ANT_API(ocfNative, ocf_adapter, sendResponse);
@@ -527,6 +751,10 @@ void InitOCFAdapterNative(jerry_value_t ocfNative) {
   // Client-side Initialization
   REGISTER_ANT_API(ocfNative, ocf_adapter, isDiscovering);
   REGISTER_ANT_API(ocfNative, ocf_adapter, stopDiscovery);
+  REGISTER_ANT_API(ocfNative, ocf_adapter, clearDiscoveryCache);
+  REGISTER_ANT_API(ocfNative, ocf_adapter, setEventBudget);
+  REGISTER_ANT_API(ocfNative, ocf_adapter, getEventMetrics);
+  REGISTER_ANT_API(ocfNative, ocf_adapter, getMemoryStats);
   REGISTER_ANT_API(ocfNative, ocf_adapter, discovery);
   REGISTER_ANT_API(ocfNative, ocf_adapter, observe);
   REGISTER_ANT_API(ocfNative, ocf_adapter, stopObserve);
@@ -22,7 +22,7 @@
 
 #include "../../common/native/ant_common.h"
 
-#include "./internal/ant_async.h"
+#include "../../common/native/internal/ant_async.h"
 #include "./internal/ll.h"
 #include "./internal/ocf_adapter_internal.h"
 #include "./ocf_common.h"
@@ -35,7 +35,7 @@ void InitOCFAdapterNative(jerry_value_t ocfNative);
 /* (JS) native.ocf_adapter_{optype}()
  * -> (Native) JS_FUNCTION(type)
  * -> {optype}_internal() -> Send OCF request */
-#define OCF_REQUEST_JS_FUNCTION(type, is_lock_required)                        \
+#define OCF_REQUEST_JS_FUNCTION(type)                                          \
   JS_FUNCTION(type) {                                                          \
     bool result;                                                               \
     jerry_value_t argRequest;                                                  \
@@ -65,9 +65,6 @@ void InitOCFAdapterNative(jerry_value_t ocfNative);
                                                                                \
     int qos = (int)iotjs_jval_as_number(jsQos);                                \
                                                                                \
-    if (is_lock_required) {                                                    \
-      lock_ocf_thread();                                                       \
-    }                                                                          \
     result = REGISTER_JS_HANDLER(type, requestId, argResponseHandler);         \
     result = result && type##_internal(requestId, ocf_endpoint_nobject, uri,   \
                                        query, qos, argIsPayloadBuffer);        \
@@ -89,8 +86,10 @@ void InitOCFAdapterNative(jerry_value_t ocfNative);
  * -> (JS) {anonymous_handler}() */
 #define OCF_REQUEST_UV_HANDLER_FUNCTION(type, one_way)                         \
   ANT_UV_HANDLER_FUNCTION(type) {                                              \
+    uint64_t drain_start_ns = START_ANT_ASYNC_DRAIN();                         \
     void *e;                                                                   \
-    while ((e = GET_FIRST_EVENT_FROM_ANT_ASYNC(type)) != NULL) {               \
+    while ((e = GET_NEXT_EVENT_FROM_ANT_ASYNC(type, drain_start_ns)) !=        \
+           NULL) {                                                             \
       ant_async_event_t *event = (ant_async_event_t *)e;                       \
       oa_client_response_event_data_t *event_data =                            \
           (oa_client_response_event_data_t *)event->data;                      \
@@ -156,10 +155,12 @@ void InitOCFAdapterNative(jerry_value_t ocfNative);
       jerry_release_value(jsEndpoint);                                         \
       jerry_release_value(jsResponse);                                         \
                                                                                \
+      /* The event data is released on the removal */                         \
+      int request_id = event_data->request_id;                                 \
       REMOVE_FIRST_EVENT_FROM_ANT_ASYNC(type);                                 \
                                                                                \
       if (one_way)                                                             \
-        UNREGISTER_JS_HANDLER(type, event_data->request_id);                   \
+        UNREGISTER_JS_HANDLER(type, request_id);                               \
     }                                                                          \
   }
 
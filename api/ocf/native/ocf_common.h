@@ -16,6 +16,8 @@
 #ifndef __OCF_COMMON_H__
 #define __OCF_COMMON_H__
 
+#include <iotjs_def.h>
+
 #define JS_DECLARE_PTR2(JOBJ, TYPE, NAME, TYPE2)                               \
   TYPE *NAME = NULL;                                                           \
   do {                                                                         \
@@ -25,4 +27,10 @@
     }                                                                          \
   } while (0)
 
+// JS strings shorter than this are copied on stack
+#define OCF_STRING_STACK_SIZE 64
+char *ocf_get_js_string_copy(jerry_value_t jsString, char *buf,
+                             size_t buf_size);
+void ocf_release_js_string_copy(char *str, char *buf);
+
 #endif /* !defined(__OCF_COMMON_H__) */
@@ -23,7 +23,7 @@
 #include <modules/iotjs_module_buffer.h>
 
 #include "../../common/native/ant_common.h"
-#include "./internal/ant_async.h"
+#include "../../common/native/internal/ant_async.h"
 #include "./internal/ll.h"
 #include "./internal/ocf_resource_internal.h"
 
@@ -217,9 +217,10 @@ JS_FUNCTION(ocf_resource_setHandler) {
 }
 ANT_UV_HANDLER_FUNCTION(ocf_resource_setHandler) {
   // Get the first event
+  uint64_t drain_start_ns = START_ANT_ASYNC_DRAIN();
   void *e;
-  while ((e = GET_FIRST_EVENT_FROM_ANT_ASYNC(ocf_resource_setHandler)) !=
-         NULL) {
+  while ((e = GET_NEXT_EVENT_FROM_ANT_ASYNC(ocf_resource_setHandler,
+                                            drain_start_ns)) != NULL) {
     ant_async_event_t *event = (ant_async_event_t *)e;
     or_setHandler_event_data_t *event_data =
         (or_setHandler_event_data_t *)event->data;
@@ -272,15 +273,84 @@ ANT_UV_HANDLER_FUNCTION(ocf_resource_setHandler) {
     iotjs_string_destroy(&payload_string_jsstr);
     jerry_release_value(js_ocf_request);
 
-    // wake up OCF thread
-    wakeup_ant_async_sender(event);
-
     // Remove the first event
-    // - It also calls the destroyer of the event and event data.
+    // - It also calls the destroyer of the event data, and wakes up OCF
+    //   thread waiting for the event.
     REMOVE_FIRST_EVENT_FROM_ANT_ASYNC(ocf_resource_setHandler);
   }
 }
 
+// OCFResource.setCachedRepresentation()
+static bool set_cached_js_value(void *cached_rep, const char *key,
+                                jerry_value_t jsValue) {
+  if (jerry_value_is_boolean(jsValue)) {
+    bool value = jerry_get_boolean_value(jsValue);
+    return ocf_resource_setCachedValue_internal(
+        cached_rep, key, OR_CACHED_VALUE_BOOLEAN, &value, sizeof(value));
+  } else if (jerry_value_is_number(jsValue)) {
+    double number = jerry_get_number_value(jsValue);
+    if (number >= INT32_MIN && number <= INT32_MAX &&
+        number == (int)number) {
+      int value = (int)number;
+      return ocf_resource_setCachedValue_internal(
+          cached_rep, key, OR_CACHED_VALUE_INT, &value, sizeof(value));
+    }
+    return ocf_resource_setCachedValue_internal(
+        cached_rep, key, OR_CACHED_VALUE_DOUBLE, &number, sizeof(number));
+  } else if (jerry_value_is_string(jsValue)) {
+    char value_buf[OCF_STRING_STACK_SIZE];
+    char *value =
+        ocf_get_js_string_copy(jsValue, value_buf, sizeof(value_buf));
+    if (value == NULL)
+      return false;
+    bool is_changed = ocf_resource_setCachedValue_internal(
+        cached_rep, key, OR_CACHED_VALUE_STRING, value, strlen(value));
+    ocf_release_js_string_copy(value, value_buf);
+    return is_changed;
+  } else if (jerry_value_is_object(jsValue) &&
+             iotjs_jbuffer_get_bufferwrap_ptr(jsValue) != NULL) {
+    iotjs_bufferwrap_t *valueBuffer = iotjs_bufferwrap_from_jbuffer(jsValue);
+    return ocf_resource_setCachedValue_internal(
+        cached_rep, key, OR_CACHED_VALUE_BYTE_ARRAY, valueBuffer->buffer,
+        iotjs_bufferwrap_length(valueBuffer));
+  }
+  printf("setCachedRepresentation(): Not supported type of %s\n", key);
+  return false;
+}
+
+JS_FUNCTION(ocf_resource_setCachedRepresentation) {
+  jerry_value_t argSelf, argPayload;
+  bool is_changed = false;
+  DJS_CHECK_ARGS(2, object, object);
+  argSelf = JS_GET_ARG(0, object);
+  argPayload = JS_GET_ARG(1, object);
+  JS_DECLARE_PTR2(argSelf, void, self, ocf_resource);
+
+  void *cached_rep = ocf_resource_enableCachedRep_internal(self);
+  if (cached_rep == NULL) {
+    return jerry_create_boolean(false);
+  }
+
+  jerry_value_t jsKeys = jerry_get_object_keys(argPayload);
+  uint32_t keys_count =
+      jerry_value_is_error(jsKeys) ? 0 : jerry_get_array_length(jsKeys);
+  for (uint32_t i = 0; i < keys_count; i++) {
+    jerry_value_t jsKey = jerry_get_property_by_index(jsKeys, i);
+    jerry_value_t jsValue = jerry_get_property(argPayload, jsKey);
+    char key_buf[OCF_STRING_STACK_SIZE];
+    char *key = ocf_get_js_string_copy(jsKey, key_buf, sizeof(key_buf));
+    if (key != NULL) {
+      is_changed |= set_cached_js_value(cached_rep, key, jsValue);
+      ocf_release_js_string_copy(key, key_buf);
+    }
+    jerry_release_value(jsValue);
+    jerry_release_value(jsKey);
+  }
+  jerry_release_value(jsKeys);
+
+  return jerry_create_boolean(is_changed);
+}
+
 void ocf_resource_init(void) {
   INIT_ANT_ASYNC(ocf_resource_setHandler, or_setHandler_event_data_destroyer);
 }
@@ -291,4 +361,5 @@ void InitOCFResourceNative(jerry_value_t ocfNative) {
   REGISTER_ANT_API(ocfNative, ocf_resource, setDiscoverable);
   REGISTER_ANT_API(ocfNative, ocf_resource, setPeriodicObservable);
   REGISTER_ANT_API(ocfNative, ocf_resource, setHandler);
+  REGISTER_ANT_API(ocfNative, ocf_resource, setCachedRepresentation);
 }
@@ -303,10 +303,10 @@ class OCF:
             return native.ocf_adapter.isDiscovering()
 
         def discovery(self,resourceType, discoveryHandler):
-            return native.ocf_adapter_discovery(resourceType, discoveryHandler)
+            return native.ocf_adapter_discovery(resourceType, discoveryHandler, False)
 
         def discoveryAll(self,discoveryHandler) :
-            return native.ocf_adapter_discovery(' ', discoveryHandler)
+            return native.ocf_adapter_discovery(' ', discoveryHandler, False)
 
         def observe(self,endpoint,uri,userHandler,query,qos,isResponsePayloadBuffer):
             if query == None:
@@ -20,6 +20,8 @@ var settings = {};
 settings.ml = {};
 settings.ml.modelPath = '';
 settings.ml.num_fragments = 12;
+// More than 1 enables pipelined offloading if the gateway supports it
+settings.ml.max_in_flight_frames = 1;
 settings.deviceType = 'tx2';
 settings.isH264Enabled = false;
 settings.isSourceFilterEnabled = false;
@@ -143,7 +145,8 @@ function onStart() {
     var mlFragmentElement = ant.gateway.createImgClsImagenetElement(
       settings.ml.modelPath,
       settings.ml.num_fragments,
-      gatewayAddress
+      gatewayAddress,
+      settings.ml.max_in_flight_frames
     );
     subpipe1Elements.push(mlFragmentElement);
 
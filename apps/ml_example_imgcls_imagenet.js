@@ -155,8 +155,9 @@ function onStart() {
     var totalPssInKB = 0;
     var totalFrameLatency = 0.0;
     var sampleCount = 0;
-    sink.connectSignal('new-sample', function (name, data) {
-      var result = ant.ml.getMaxOfBuffer(data, 'float32');
+    var onNewSample = function (name, data, tensors) {
+      // tensors[0].data is a Float32Array view of 'classes'
+      var result = ant.ml.getMaxOfBuffer(tensors[0].data, 'float32');
       var labelMessage = '';
 
       var pssInKB = ant.runtime.getPSSInKB() - baselinePssInKB;
@@ -194,6 +195,9 @@ function onStart() {
         }
       }
       ant.remoteui.setStreamingViewLabelText(labelMessage);
+    };
+    sink.connectSignal('new-sample', onNewSample, {
+      tensors: mlElement.outputNames
     });
     subpipe1Elements.push(sink);
 
@@ -159,7 +159,7 @@ function onStart() {
     var prevTimestamp = 0;
     var totalFrameLatency = 0.0;
     var sampleCount = 0;
-    sink.connectSignal('new-sample', function (name, data) {
+    var onNewSample = function (name, data, tensors) {
       var labelMessage = '';
 
       var frameLatency = -1;
@@ -184,23 +184,28 @@ function onStart() {
           ' FPS)';
       }
       var bboxes = [];
-      var arr = ant.ml.toFloatArray(data);
-      var numObjects = arr[0];
+      // Float32Array views of num_objects, classes, scores and bboxes
+      var numObjects = tensors[0].data[0];
+      var classes = tensors[1].data;
+      var boxes = tensors[3].data;
 
       for (step = 0; step < numObjects; step++) {
-        var base = 21 + step * 4;
+        var base = step * 4;
         var bbox1 = {
-          xmin: arr[base],
-          ymin: arr[base + 1],
-          xmax: arr[base + 2],
-          ymax: arr[base + 3],
-          labeltext: labels[arr[1 + step]]
+          xmin: boxes[base],
+          ymin: boxes[base + 1],
+          xmax: boxes[base + 2],
+          ymax: boxes[base + 3],
+          labeltext: labels[classes[step]]
         };
         bboxes.push(bbox1);
       }
       console.log('\n\nResult:\n ' + JSON.stringify(bboxes) + '\n');
       ant.remoteui.setStreamingViewBoundingBoxes(bboxes);
       ant.remoteui.setStreamingViewLabelText(labelMessage);
+    };
+    sink.connectSignal('new-sample', onNewSample, {
+      tensors: mlElement.outputNames
     });
     subpipe1Elements.push(sink);
 
@@ -13,10 +13,13 @@
 # limitations under the License.
 #
 
+import collections
 import errno
 import socket
 from socket import error as socket_error
 import os
+import queue
+import threading
 
 import nnstreamer_python as nns
 import numpy as np
@@ -25,6 +28,13 @@ from keras.applications import mobilenet
 import fragment_runner as runner
 import antml_util as util
 
+# Pipelined protocol: the connection starts with PIPELINE_MAGIC and the
+# in-flight window size. Each frame is sent as frame id, payload length,
+# tail_from and the payload, and the gateway replies with the frame id and the
+# next offload point. Every field is a 4-byte big-endian integer.
+PIPELINE_MAGIC = b'ANTP'
+PIPELINE_FRAME_ID_MASK = 0xFFFFFFFF
+
 class CustomFilter(object):
     def __init__(self, *args):
         # Parse arguments
@@ -34,6 +44,9 @@ class CustomFilter(object):
         input_names = util.names_str_to_strarray(args[3])
         num_fragments = int(args[4])
         target_uri = args[5]
+        # Optional: the number of frames whose tails can be executed on the
+        # target while heads of next frames run. 1 is the blocking protocol.
+        max_in_flight = int(args[6]) if len(args) > 6 else 1
 
         for input_type in input_types:
             if input_type is None:
@@ -54,6 +67,14 @@ class CustomFilter(object):
         self.input_names = input_names
         self.num_fragments = num_fragments
         self.target_uri = target_uri
+        self.max_in_flight = max(max_in_flight, 1)
+        self.is_pipelined = self.max_in_flight > 1
+
+        # In-flight window of pipelined mode
+        self.window_cond = threading.Condition()
+        self.in_flight_frames = collections.deque()
+        self.next_frame_id = 0
+        self.send_queue = None
 
         # Initialize fragment runner
         self.offload_from = num_fragments - 1  # Initial setting
@@ -80,11 +101,99 @@ class CustomFilter(object):
         target_port = int(self.target_uri[(self.target_uri.find(":")+1):])
         try:
             self.client_socket.connect((target_ip_addr, target_port))
-            self.is_connected = True
+            self.client_socket.setsockopt(socket.IPPROTO_TCP,
+                                          socket.TCP_NODELAY, 1)
+            if self.is_pipelined:
+                self.start_pipeline()
+            else:
+                self.is_connected = True
         except socket.timeout:
             return False
         return True
 
+    def start_pipeline(self):
+        self.client_socket.sendall(
+            PIPELINE_MAGIC + self.max_in_flight.to_bytes(4, 'big'))
+        with self.window_cond:
+            self.in_flight_frames.clear()
+            self.is_connected = True
+        # Sender and receiver are bound to this connection.
+        self.send_queue = queue.Queue()
+        sender = threading.Thread(target=self.send_frames,
+                                  args=(self.client_socket, self.send_queue))
+        receiver = threading.Thread(target=self.receive_results,
+                                    args=(self.client_socket, self.send_queue))
+        sender.daemon = True
+        receiver.daemon = True
+        sender.start()
+        receiver.start()
+
+    def stop_pipeline(self, client_socket, send_queue):
+        with self.window_cond:
+            if self.client_socket is not client_socket:
+                return
+            self.is_connected = False
+            self.in_flight_frames.clear()
+            self.window_cond.notify_all()
+        send_queue.put(None)
+        try:
+            client_socket.shutdown(socket.SHUT_RDWR)
+        except socket_error:
+            pass
+        client_socket.close()
+
+    def send_frames(self, client_socket, send_queue):
+        # Transfer of a frame overlaps the head of next frame.
+        while True:
+            frame = send_queue.get()
+            if frame is None:
+                return
+            frame_id, tail_from, head_out_tensor = frame
+            payload_buffer = memoryview(head_out_tensor).cast('B')
+            header_buffer = (frame_id.to_bytes(4, 'big')
+                             + len(payload_buffer).to_bytes(4, 'big')
+                             + tail_from.to_bytes(4, 'big'))
+            try:
+                send_buffers(client_socket, [header_buffer, payload_buffer])
+            except socket_error:
+                self.stop_pipeline(client_socket, send_queue)
+                return
+
+    def receive_results(self, client_socket, send_queue):
+        while True:
+            try:
+                reply_buffer = recv_exactly(client_socket, 8)
+            except socket_error:
+                reply_buffer = None
+            if reply_buffer is None:
+                self.stop_pipeline(client_socket, send_queue)
+                return
+            frame_id = int.from_bytes(reply_buffer[:4], byteorder='big')
+            result = int.from_bytes(reply_buffer[4:], byteorder='big')
+            with self.window_cond:
+                # Tails are executed in order of frames.
+                if (len(self.in_flight_frames) == 0
+                        or self.in_flight_frames[0] != frame_id):
+                    print("Unexpected frame id: {}".format(frame_id))
+                    is_valid = False
+                else:
+                    self.in_flight_frames.popleft()
+                    is_valid = True
+                    if 0 <= result < self.num_fragments:
+                        self.offload_from = result
+                    self.window_cond.notify_all()
+            if not is_valid:
+                self.stop_pipeline(client_socket, send_queue)
+                return
+
+    def wait_for_window(self):
+        # Returns False if the connection is lost while waiting.
+        with self.window_cond:
+            while (self.is_connected
+                   and len(self.in_flight_frames) >= self.max_in_flight):
+                self.window_cond.wait()
+            return self.is_connected
+
     def invoke(self, input_array):
         try:
             retdata = np.array([0]).reshape([1, 1, 1, 1]).astype(np.int32)
@@ -92,6 +201,10 @@ class CustomFilter(object):
                 self.connect_to_target()
                 return [retdata]
 
+            # Wait until the oldest frame's tail is done on the target
+            if self.is_pipelined and not self.wait_for_window():
+                return [retdata]
+
             # inference locally
             head_from = 0
             head_to = self.offload_from - 1
@@ -101,22 +214,31 @@ class CustomFilter(object):
             head_in_tensor = mobilenet.preprocess_input(input_tensor)
             head_out_tensor = runner.run_fragments(self.interpreters,
                                                    head_in_tensor, head_from, head_to)
+            head_out_tensor = np.ascontiguousarray(head_out_tensor)
 
             # send the output tensor to the target URI
             tail_from = self.offload_from
 
-            payload_buffer = head_out_tensor.tobytes()
-
-            payload_length = len(payload_buffer)
-            payload_length_buffer = payload_length.to_bytes(4, 'big')
-
-            tail_from_buffer = tail_from.to_bytes(4, 'big')
+            if self.is_pipelined:
+                with self.window_cond:
+                    if not self.is_connected:
+                        return [retdata]
+                    frame_id = self.next_frame_id
+                    self.next_frame_id = ((frame_id + 1)
+                                          & PIPELINE_FRAME_ID_MASK)
+                    self.in_flight_frames.append(frame_id)
+                    self.send_queue.put((frame_id, tail_from, head_out_tensor))
+                return [retdata]
 
-            self.client_socket.send(payload_length_buffer)
-            self.client_socket.send(tail_from_buffer)
-            self.client_socket.send(payload_buffer)
+            payload_buffer = memoryview(head_out_tensor).cast('B')
+            header_buffer = (len(payload_buffer).to_bytes(4, 'big')
+                             + tail_from.to_bytes(4, 'big'))
+            send_buffers(self.client_socket, [header_buffer, payload_buffer])
 
-            result_buffer = self.client_socket.recv(4)
+            result_buffer = recv_exactly(self.client_socket, 4)
+            if result_buffer is None:
+                self.is_connected = False
+                return [retdata]
             result = int.from_bytes(result_buffer, byteorder='big')
             if 0 <= result < self.num_fragments:
                 self.offload_from = result
@@ -128,3 +250,28 @@ class CustomFilter(object):
                 raise serr
 
         return [retdata]
+
+
+def send_buffers(client_socket, buffers):
+    # Header and payload are sent in one system call without being joined.
+    buffers = [memoryview(buffer).cast('B') for buffer in buffers]
+    while len(buffers) > 0:
+        sent_length = client_socket.sendmsg(buffers)
+        while len(buffers) > 0 and sent_length >= len(buffers[0]):
+            sent_length -= len(buffers[0])
+            buffers.pop(0)
+        if len(buffers) > 0:
+            buffers[0] = buffers[0][sent_length:]
+
+
+def recv_exactly(client_socket, length):
+    # Returns None if the connection is closed.
+    buffer = bytearray(length)
+    view = memoryview(buffer)
+    received_length = 0
+    while received_length < length:
+        chunk_length = client_socket.recv_into(view[received_length:])
+        if chunk_length == 0:
+            return None
+        received_length += chunk_length
+    return bytes(buffer)
@@ -0,0 +1,151 @@
+/* Copyright (c) 2017-2021 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// DFE execute input marshalling benchmark
+// It compares the legacy input marshalling (input copied into a new bytes
+// object) with the current one (memoryview over the caller's buffer) on a
+// 224x224x3 float32 tensor. A fake TFLite interpreter keeps its input without
+// copy, so only the output conversion is common to both. Bytes copied per call
+// are measured as the peak of Python allocations traced by tracemalloc.
+// numpy is required.
+//
+//   gcc -O2 -I../../api/antgateway/native/internal $(python3-config --includes)
+//     dfe-execute-bench.c
+//     ../../api/antgateway/native/internal/ant_gateway_dfe_internal.c
+//     $(python3-config --ldflags --embed) -o dfe-execute-bench
+//     && ./dfe-execute-bench [calls]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <Python.h>
+
+#include "ant_gateway_dfe_internal.h"
+
+#define TENSOR_SIZE (224 * 224 * 3)
+
+// tensorflow and keras are not needed by dfe_execute
+static const char *kSetupScript =
+    "import sys, types, tracemalloc\n"
+    "import numpy as np\n"
+    "for name in ['tensorflow', 'keras', 'keras.preprocessing',\n"
+    "             'keras.applications']:\n"
+    "    sys.modules[name] = types.ModuleType(name)\n"
+    "sys.modules['keras.preprocessing'].image = None\n"
+    "sys.modules['keras.applications'].mobilenet = None\n"
+    "sys.path.insert(0, '../../api/antgateway/python')\n"
+    "import ant_gateway_dfe\n"
+    "class FakeInterpreter:\n"
+    "    def get_input_details(self):\n"
+    "        return [{'index': 0, 'shape': [1, 224, 224, 3]}]\n"
+    "    def get_output_details(self):\n"
+    "        return [{'index': 1}]\n"
+    "    def set_tensor(self, index, tensor):\n"
+    "        self.tensor = tensor\n"
+    "    def invoke(self):\n"
+    "        pass\n"
+    "    def get_tensor(self, index):\n"
+    "        tensor = self.tensor\n"
+    "        self.tensor = None\n"
+    "        return tensor\n"
+    "interpreters = [FakeInterpreter()]\n";
+
+static PyObject *g_interpreters;
+static PyObject *g_tracemalloc;
+static PyObject *g_dfe_execute;
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+// Legacy: input is copied to a new bytes object on every call
+static void *legacy_execute(void *input, size_t length) {
+  PyObject *pyInput = PyBytes_FromStringAndSize((const char *)input,
+                                                (Py_ssize_t)length);
+  PyObject *pyOutput = PyObject_CallFunction(g_dfe_execute, "(OOii)",
+                                             g_interpreters, pyInput, 0, 0);
+  Py_DECREF(pyInput);
+  return (void *)pyOutput;
+}
+
+static void *current_execute(void *input, size_t length) {
+  return ant_gateway_dfeExecute_internal((void *)g_interpreters, input, length,
+                                         0, 0);
+}
+
+static long traced_peak_bytes(void) {
+  PyObject *result =
+      PyObject_CallMethod(g_tracemalloc, "get_traced_memory", NULL);
+  long peak = PyLong_AsLong(PyTuple_GetItem(result, 1));
+  Py_DECREF(result);
+  return peak;
+}
+
+static void run_bench(const char *name, void *(*execute)(void *, size_t),
+                      float *input, int calls) {
+  size_t length = sizeof(float) * TENSOR_SIZE;
+  double start_us, elapsed_us;
+  long peak_bytes;
+  void *output;
+  int i;
+
+  // Bytes copied per call
+  Py_XDECREF(PyObject_CallMethod(g_tracemalloc, "start", NULL));
+  output = execute(input, length);
+  peak_bytes = traced_peak_bytes();
+  ant_gateway_dfeExecute_releaseOutput(output);
+  Py_XDECREF(PyObject_CallMethod(g_tracemalloc, "stop", NULL));
+
+  // Latency per call
+  start_us = now_us();
+  for (i = 0; i < calls; i++) {
+    output = execute(input, length);
+    ant_gateway_dfeExecute_releaseOutput(output);
+  }
+  elapsed_us = now_us() - start_us;
+
+  printf("**DFEExecuteBench** %s: %ld bytes copied/call (input %zu bytes), "
+         "%.1f us/call\n",
+         name, peak_bytes, length, elapsed_us / calls);
+}
+
+int main(int argc, char **argv) {
+  int calls = (argc > 1) ? atoi(argv[1]) : 1000;
+  float *input = (float *)calloc(TENSOR_SIZE, sizeof(float));
+  PyObject *main_module, *dfe_module;
+
+  Py_Initialize();
+  if (PyRun_SimpleString(kSetupScript) != 0)
+    return 1;
+  main_module = PyImport_AddModule("__main__");
+  g_interpreters = PyObject_GetAttrString(main_module, "interpreters");
+  g_tracemalloc = PyObject_GetAttrString(main_module, "tracemalloc");
+  dfe_module = PyObject_GetAttrString(main_module, "ant_gateway_dfe");
+  g_dfe_execute = PyObject_GetAttrString(dfe_module, "dfe_execute");
+  Py_DECREF(dfe_module);
+
+  run_bench("legacy (bytes)", legacy_execute, input, calls);
+  run_bench("memoryview", current_execute, input, calls);
+
+  Py_DECREF(g_dfe_execute);
+  Py_DECREF(g_tracemalloc);
+  Py_DECREF(g_interpreters);
+  free(input);
+  return 0;
+}
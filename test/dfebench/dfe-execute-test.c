@@ -0,0 +1,182 @@
+/* Copyright (c) 2017-2021 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// DFE execute regression test
+// It runs ant_gateway_dfe.dfe_execute through the embedded Python path with
+// fake TFLite interpreters. Each fragment adds 1 to its input, so the output
+// tells how many fragments are executed. It checks that only the fragments of
+// [startLayerNum, endLayerNum] are invoked, and that the first fragment reads
+// the caller's buffer without copy. Then it checks the per-fragment profile
+// table. numpy is required.
+//
+//   gcc -g -I../../api/antgateway/native/internal $(python3-config --includes)
+//     dfe-execute-test.c
+//     ../../api/antgateway/native/internal/ant_gateway_dfe_internal.c
+//     $(python3-config --ldflags --embed) -o dfe-execute-test
+//     && ./dfe-execute-test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Python.h>
+
+#include "ant_gateway_dfe_internal.h"
+
+#define NUM_FRAGMENTS 5
+#define DFE_PROFILE_WARMUPS 3
+#define TENSOR_SIZE 16
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+
+// tensorflow and keras are not needed by dfe_execute
+static const char *kSetupScript =
+    "import sys, types\n"
+    "import numpy as np\n"
+    "for name in ['tensorflow', 'keras', 'keras.preprocessing',\n"
+    "             'keras.applications']:\n"
+    "    sys.modules[name] = types.ModuleType(name)\n"
+    "sys.modules['keras.preprocessing'].image = None\n"
+    "sys.modules['keras.applications'].mobilenet = None\n"
+    "sys.path.insert(0, '../../api/antgateway/python')\n"
+    "import ant_gateway_dfe\n"
+    "class FakeInterpreter:\n"
+    "    def __init__(self):\n"
+    "        self.invoked = 0\n"
+    "        self.input_address = 0\n"
+    "    def get_input_details(self):\n"
+    "        return [{'index': 0, 'shape': [1, " STRINGIFY(TENSOR_SIZE) "]}]\n"
+    "    def get_output_details(self):\n"
+    "        return [{'index': 1}]\n"
+    "    def set_tensor(self, index, tensor):\n"
+    "        self.input_address = tensor.ctypes.data\n"
+    "        self.input = np.array(tensor, dtype=np.float32)\n"
+    "    def invoke(self):\n"
+    "        self.invoked += 1\n"
+    "        self.output = self.input + 1\n"
+    "    def get_tensor(self, index):\n"
+    "        return self.output\n"
+    "interpreters = ant_gateway_dfe.FragmentInterpreters(\n"
+    "    [FakeInterpreter() for i in range(" STRINGIFY(NUM_FRAGMENTS) ")])\n";
+
+static PyObject *g_interpreters;
+static int g_failures;
+
+static long get_interpreter_attr(int index, const char *name) {
+  PyObject *interpreter = PyList_GetItem(g_interpreters, index);
+  PyObject *value = PyObject_GetAttrString(interpreter, name);
+  long result = PyLong_AsLong(value);
+  Py_DECREF(value);
+  return result;
+}
+
+static void reset_interpreters(void) {
+  PyObject *zero = PyLong_FromLong(0);
+  int i;
+  for (i = 0; i < NUM_FRAGMENTS; i++) {
+    PyObject *interpreter = PyList_GetItem(g_interpreters, i);
+    PyObject_SetAttrString(interpreter, "invoked", zero);
+    PyObject_SetAttrString(interpreter, "input_address", zero);
+  }
+  Py_DECREF(zero);
+}
+
+static void check_execute(int start, int end) {
+  float input[TENSOR_SIZE];
+  float *output;
+  size_t output_length;
+  void *output_tensor;
+  int i;
+
+  for (i = 0; i < TENSOR_SIZE; i++)
+    input[i] = (float)i;
+  reset_interpreters();
+  output_tensor = ant_gateway_dfeExecute_internal(
+      (void *)g_interpreters, input, sizeof(input), start, end);
+  if (output_tensor == NULL) {
+    printf("FAIL [%d, %d]: no output\n", start, end);
+    g_failures++;
+    return;
+  }
+  output = (float *)ant_gateway_dfeExecute_getOutputBufferWithLength(
+      output_tensor, &output_length);
+
+  // Executed fragment count
+  if (output_length != sizeof(input) || output[0] != (float)(end - start + 1)) {
+    printf("FAIL [%d, %d]: %.0f fragments executed\n", start, end, output[0]);
+    g_failures++;
+  }
+  for (i = 0; i < NUM_FRAGMENTS; i++) {
+    long expected = (i >= start && i <= end) ? 1 : 0;
+    if (get_interpreter_attr(i, "invoked") != expected) {
+      printf("FAIL [%d, %d]: fragment %d invoked %ld times\n", start, end, i,
+             get_interpreter_attr(i, "invoked"));
+      g_failures++;
+    }
+  }
+
+  // Zero-copy input
+  if (get_interpreter_attr(start, "input_address") != (long)(intptr_t)input) {
+    printf("FAIL [%d, %d]: input is copied\n", start, end);
+    g_failures++;
+  }
+  ant_gateway_dfeExecute_releaseOutput(output_tensor);
+}
+
+// Fragment i is invoked once by every range that contains it, and the first
+// DFE_PROFILE_WARMUPS invocations are not counted.
+static void check_profile(void) {
+  char *profile = ant_gateway_dfeGetProfile_internal((void *)g_interpreters);
+  PyObject *json_module = PyImport_ImportModule("json");
+  PyObject *table = PyObject_CallMethod(json_module, "loads", "(s)", profile);
+  int i;
+
+  for (i = 0; i < NUM_FRAGMENTS; i++) {
+    PyObject *entry = PyList_GetItem(table, i);
+    long count = PyLong_AsLong(PyDict_GetItemString(entry, "count"));
+    long output_bytes =
+        PyLong_AsLong(PyDict_GetItemString(entry, "outputBytes"));
+    long expected = (long)(i + 1) * (NUM_FRAGMENTS - i) - DFE_PROFILE_WARMUPS;
+    if (count != expected || output_bytes != sizeof(float) * TENSOR_SIZE) {
+      printf("FAIL profile %d: count %ld (expected %ld), %ld bytes\n", i,
+             count, expected, output_bytes);
+      g_failures++;
+    }
+  }
+  Py_DECREF(table);
+  Py_DECREF(json_module);
+  free(profile);
+}
+
+int main(int argc, char **argv) {
+  PyObject *main_module;
+  int start, end;
+
+  Py_Initialize();
+  if (PyRun_SimpleString(kSetupScript) != 0)
+    return 1;
+  main_module = PyImport_AddModule("__main__");
+  g_interpreters = PyObject_GetAttrString(main_module, "interpreters");
+
+  for (start = 0; start < NUM_FRAGMENTS; start++)
+    for (end = start; end < NUM_FRAGMENTS; end++)
+      check_execute(start, end);
+  check_profile();
+
+  Py_DECREF(g_interpreters);
+  printf("**DFEExecuteTest** %s (%d failures)\n",
+         (g_failures == 0) ? "PASS" : "FAIL", g_failures);
+  return (g_failures == 0) ? 0 : 1;
+}
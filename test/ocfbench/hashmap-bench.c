@@ -0,0 +1,229 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ant_async handler map benchmark
+// It compares the legacy semaphore-locked hashmap (modulo hashing, whole-table
+// probing on a miss) with the current one (lock-free get). A reader thread
+// looks up handlers as OCF thread does, while a writer thread adds and
+// removes handlers as JS thread does.
+//
+//   gcc -O2 -pthread -I../../api/common/native/internal hashmap-bench.c
+//     ../../api/common/native/internal/hashmap.c
+//     -o hashmap-bench && ./hashmap-bench [seconds]
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "hashmap.h"
+
+#define NUM_HANDLERS 32
+#define KEY_STRIDE 7919
+
+static volatile int g_stop;
+static volatile long g_sink;
+
+// Legacy hashmap (lookup and update paths only)
+#define LEGACY_INITIAL_SIZE 1024
+
+typedef struct {
+  unsigned int key;
+  int in_use;
+  any_t data;
+} legacy_element_t;
+
+typedef struct {
+  int table_size;
+  int size;
+  legacy_element_t *data;
+  sem_t lock;
+} legacy_map_t;
+
+static legacy_map_t *legacy_new(void) {
+  legacy_map_t *m = (legacy_map_t *)malloc(sizeof(legacy_map_t));
+  m->data = (legacy_element_t *)calloc(LEGACY_INITIAL_SIZE,
+                                       sizeof(legacy_element_t));
+  sem_init(&m->lock, 0, 1);
+  m->table_size = LEGACY_INITIAL_SIZE;
+  m->size = 0;
+  return m;
+}
+
+static void legacy_free(legacy_map_t *m) {
+  free(m->data);
+  sem_destroy(&m->lock);
+  free(m);
+}
+
+static unsigned int legacy_hash_int(legacy_map_t *m, unsigned int key) {
+  key += (key << 12);
+  key ^= (key >> 22);
+  key += (key << 4);
+  key ^= (key >> 9);
+  key += (key << 10);
+  key ^= (key >> 2);
+  key += (key << 7);
+  key ^= (key >> 12);
+  key = (key >> 3) * 2654435761;
+  return key % (unsigned int)m->table_size;
+}
+
+static int legacy_put(legacy_map_t *m, unsigned int key, any_t value) {
+  int curr, i;
+  sem_wait(&m->lock);
+  curr = (int)legacy_hash_int(m, key);
+  for (i = 0; i < m->table_size; i++) {
+    if (m->data[curr].in_use == 0 ||
+        (m->data[curr].key == key && m->data[curr].in_use == 1)) {
+      m->data[curr].data = value;
+      m->data[curr].key = key;
+      m->data[curr].in_use = 1;
+      m->size++;
+      sem_post(&m->lock);
+      return MAP_OK;
+    }
+    curr = (curr + 1) % m->table_size;
+  }
+  sem_post(&m->lock);
+  return MAP_FULL;
+}
+
+static int legacy_get(legacy_map_t *m, unsigned int key, any_t *arg) {
+  int curr, i;
+  sem_wait(&m->lock);
+  curr = (int)legacy_hash_int(m, key);
+  for (i = 0; i < m->table_size; i++) {
+    if (m->data[curr].key == key && m->data[curr].in_use == 1) {
+      *arg = m->data[curr].data;
+      sem_post(&m->lock);
+      return MAP_OK;
+    }
+    curr = (curr + 1) % m->table_size;
+  }
+  *arg = NULL;
+  sem_post(&m->lock);
+  return MAP_MISSING;
+}
+
+static int legacy_remove(legacy_map_t *m, unsigned int key) {
+  int curr, i;
+  sem_wait(&m->lock);
+  curr = (int)legacy_hash_int(m, key);
+  for (i = 0; i < m->table_size; i++) {
+    if (m->data[curr].key == key && m->data[curr].in_use == 1) {
+      m->data[curr].in_use = 0;
+      m->data[curr].data = NULL;
+      m->data[curr].key = 0;
+      m->size--;
+      sem_post(&m->lock);
+      return MAP_OK;
+    }
+    curr = (curr + 1) % m->table_size;
+  }
+  sem_post(&m->lock);
+  return MAP_MISSING;
+}
+
+// Benchmark
+typedef struct {
+  int is_legacy;
+  void *map;
+  long reads;
+  long writes;
+} bench_t;
+
+static int bench_put(bench_t *b, unsigned int key, any_t value) {
+  return b->is_legacy ? legacy_put((legacy_map_t *)b->map, key, value)
+                      : hashmap_put(b->map, key, value);
+}
+
+static int bench_get(bench_t *b, unsigned int key, any_t *arg) {
+  return b->is_legacy ? legacy_get((legacy_map_t *)b->map, key, arg)
+                      : hashmap_get(b->map, key, arg);
+}
+
+static int bench_remove(bench_t *b, unsigned int key) {
+  return b->is_legacy ? legacy_remove((legacy_map_t *)b->map, key)
+                      : hashmap_remove(b->map, key);
+}
+
+// OCF thread: lookups of registered handlers, and some of late responses
+static void *reader_fn(void *arg) {
+  bench_t *b = (bench_t *)arg;
+  unsigned int i = 0;
+  long sum = 0;
+  any_t value;
+  while (!g_stop) {
+    // 1 of 4 lookups misses
+    unsigned int key = (i % (NUM_HANDLERS + NUM_HANDLERS / 3)) * KEY_STRIDE;
+    if (bench_get(b, key, &value) == MAP_OK)
+      sum += (long)value;
+    i++;
+  }
+  b->reads = (long)i;
+  g_sink = sum;
+  return NULL;
+}
+
+// JS thread: handlers of requests are added and removed
+static void *writer_fn(void *arg) {
+  bench_t *b = (bench_t *)arg;
+  unsigned int i = 0;
+  while (!g_stop) {
+    unsigned int key = (NUM_HANDLERS + 1 + (i % 64)) * KEY_STRIDE;
+    bench_put(b, key, (any_t)(long)(i + 1));
+    bench_remove(b, key);
+    i++;
+    usleep(10);
+  }
+  b->writes = (long)i;
+  return NULL;
+}
+
+static void run_bench(const char *name, bench_t *b, double seconds) {
+  pthread_t reader, writer;
+  unsigned int i;
+
+  for (i = 0; i < NUM_HANDLERS; i++)
+    bench_put(b, i * KEY_STRIDE, (any_t)(long)(i + 1));
+
+  g_stop = 0;
+  pthread_create(&reader, NULL, reader_fn, b);
+  pthread_create(&writer, NULL, writer_fn, b);
+  usleep((useconds_t)(seconds * 1e6));
+  g_stop = 1;
+  pthread_join(reader, NULL);
+  pthread_join(writer, NULL);
+
+  printf("**OCFHashmapBench** %s: %.0f gets/sec (%.0f put+removes/sec)\n",
+         name, (double)b->reads / seconds, (double)b->writes / seconds);
+}
+
+int main(int argc, char **argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+  bench_t legacy = {1, NULL, 0, 0};
+  bench_t current = {0, NULL, 0, 0};
+
+  legacy.map = legacy_new();
+  run_bench("legacy", &legacy, seconds);
+  legacy_free((legacy_map_t *)legacy.map);
+
+  current.map = hashmap_new();
+  run_bench("lock-free get", &current, seconds);
+  hashmap_free(current.map);
+  return 0;
+}
@@ -0,0 +1,139 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// OCF Benchmark: synchronous request handling latency
+// The app is both an OCF server and its client. Each GET request is handled
+// by a JS handler while OCF thread waits for it (sync mode ant async event),
+// and the next request is sent when the response arrives. It prints the
+// percentiles of the round-trip latency.
+
+var ant = require('ant');
+var console = require('console');
+var ocf = require('ocf');
+
+var NUM_WARMUP_REQUESTS = 20;
+var NUM_REQUESTS = 500;
+
+var gOA = undefined;
+var gLatencies = [];
+var gRequestCount = 0;
+var gStartTime = 0;
+
+/* OCF server */
+function onGetBench(request) {
+  gOA.repStartRootObject();
+  gOA.repSet('count', gRequestCount);
+  gOA.repEndRootObject();
+  gOA.sendResponse(request, ocf.OC_STATUS_OK);
+}
+
+/* OCF client */
+function sendRequest(endpoint, uri) {
+  gStartTime = new Date().valueOf();
+  gOA.get(endpoint, uri, function (response) {
+    var latency = new Date().valueOf() - gStartTime;
+    gRequestCount++;
+    if (gRequestCount > NUM_WARMUP_REQUESTS) {
+      gLatencies.push(latency);
+    }
+    if (gRequestCount < NUM_WARMUP_REQUESTS + NUM_REQUESTS) {
+      sendRequest(endpoint, uri);
+    } else {
+      printResult();
+    }
+  });
+}
+
+function percentile(sortedValues, ratio) {
+  var index = Math.ceil(sortedValues.length * ratio) - 1;
+  return sortedValues[Math.max(0, Math.min(index, sortedValues.length - 1))];
+}
+
+function printResult() {
+  var sorted = gLatencies.slice().sort(function (a, b) {
+    return a - b;
+  });
+  var sum = 0;
+  for (var i = 0; i < sorted.length; i++) {
+    sum += sorted[i];
+  }
+  console.log(
+    '**OCFSyncRequestBench** requests: ' +
+      sorted.length +
+      ', avg: ' +
+      (sum / sorted.length).toFixed(2) +
+      'ms, p50: ' +
+      percentile(sorted, 0.5) +
+      'ms, p90: ' +
+      percentile(sorted, 0.9) +
+      'ms, p99: ' +
+      percentile(sorted, 0.99) +
+      'ms, max: ' +
+      sorted[sorted.length - 1] +
+      'ms'
+  );
+}
+
+function onDiscovery(endpoint, uri, types, interfaceMask) {
+  for (var i in types) {
+    if (types[i] == 'oic.r.bench') {
+      sendRequest(endpoint, uri);
+      return;
+    }
+  }
+}
+
+/* OCF lifecycle handlers */
+function onPrepareOCFEventLoop() {
+  gOA.setPlatform('ant');
+  gOA.addDevice('/oic/d', 'oic.d.bench', 'Bench', 'ocf.1.0.0', 'ocf.res.1.0.0');
+}
+
+function onPrepareOCFServer() {
+  var device = gOA.getDevice(0);
+  var rBench = ocf.createResource(
+    device,
+    'bench',
+    '/bench/1',
+    ['oic.r.bench'],
+    [ocf.OC_IF_R]
+  );
+  rBench.setDiscoverable(true);
+  rBench.setHandler(ocf.OC_GET, onGetBench);
+  gOA.addResource(rBench);
+}
+
+function onPrepareOCFClient() {
+  gOA.discovery('oic.r.bench', onDiscovery);
+}
+
+/* ANT lifecycle handlers */
+function onInitialize() {
+  gOA = ocf.getAdapter();
+  gOA.onPrepareEventLoop(onPrepareOCFEventLoop);
+  gOA.onPrepareServer(onPrepareOCFServer);
+  gOA.onPrepareClient(onPrepareOCFClient);
+}
+
+function onStart() {
+  gOA.start();
+}
+
+function onStop() {
+  gOA.stop();
+  gOA.deinitialize();
+}
+
+ant.runtime.setCurrentApp(onInitialize, onStart, onStop);
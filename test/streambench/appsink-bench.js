@@ -0,0 +1,91 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stream API Benchmark: appsink delivery to JS
+// It delivers 224x224 BGR frames to JS as fast as possible, and measures
+// frames/sec. Set ZERO_COPY to compare copied Buffers with zero-copy frames.
+// The CPU usage of the process should be observed with top.
+
+var ant = require('ant');
+var console = require('console');
+
+var ZERO_COPY = true;
+var DURATION_MS = 10000;
+
+var numFrames = 0;
+var numBytes = 0;
+var startTime = undefined;
+
+var onSample = function (name, data) {
+  if (startTime === undefined) {
+    startTime = new Date().valueOf();
+  }
+  numFrames++;
+  numBytes += data.length;
+};
+
+var onInitialize = function () {
+  console.log('onInitialize');
+};
+
+var onStart = function () {
+  ant.stream.initialize();
+  setTimeout(function () {
+    var pipeline = ant.stream.buildPipeline({
+      name: 'appsink-bench',
+      elements: [
+        { factory: 'videotestsrc', properties: { 'is-live': false } },
+        {
+          factory: 'capsfilter',
+          caps: { caps: 'video/x-raw,width=224,height=224,format=BGR' }
+        },
+        { factory: 'appsink', properties: { 'emit-signals': true } }
+      ],
+      links: [
+        [0, 1],
+        [1, 2]
+      ]
+    });
+    pipeline.elements[2].connectSignal('new-sample', onSample, {
+      zeroCopy: ZERO_COPY
+    });
+    pipeline.setState(pipeline.STATE_PLAYING);
+
+    setTimeout(function () {
+      var elapsedMS = new Date().valueOf() - startTime;
+      pipeline.setState(pipeline.STATE_NULL);
+      console.log(
+        '**StreamAppsinkBench** ' +
+          (ZERO_COPY ? 'zero-copy' : 'copy') +
+          ': ' +
+          numFrames +
+          ' frames (' +
+          numBytes +
+          ' bytes) in ' +
+          elapsedMS +
+          'ms (' +
+          ((numFrames * 1000) / elapsedMS).toFixed(1) +
+          ' frames/sec)'
+      );
+    }, DURATION_MS);
+  }, 2000);
+};
+
+var onStop = function () {
+  console.log('onStop');
+  ant.stream.finalize();
+};
+
+ant.runtime.setCurrentApp(onInitialize, onStart, onStop);
@@ -0,0 +1,115 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stream API Benchmark: stream thread RPC calls/sec
+// - sync mode: one call at a time
+// - pipelined mode: NUM_IN_FLIGHT calls in flight at once
+
+var ant = require('ant');
+var console = require('console');
+
+var NUM_CALLS = 2000;
+var NUM_IN_FLIGHT = 16;
+
+var element = undefined;
+var setPropertyArgs = function () {
+  return [element._elementIndex, 'silent', true];
+};
+
+var runSyncBench = function () {
+  var startTime = new Date().valueOf();
+  for (var i = 0; i < NUM_CALLS; i++) {
+    ant.stream.callRpc(
+      ant.stream.RPC_METHOD.ELEMENT_SETPROPERTY,
+      setPropertyArgs()
+    );
+  }
+  var elapsedMS = new Date().valueOf() - startTime;
+  console.log(
+    '**StreamRPCBench** sync: ' +
+      NUM_CALLS +
+      ' calls in ' +
+      elapsedMS +
+      'ms (' +
+      ((NUM_CALLS * 1000) / elapsedMS).toFixed(1) +
+      ' calls/sec)'
+  );
+};
+
+var runPipelinedBench = function (onFinish) {
+  if (typeof ant.stream.callRpcAsync !== 'function') {
+    console.log('**StreamRPCBench** pipelined: not supported');
+    onFinish();
+    return;
+  }
+  var sentCount = 0;
+  var doneCount = 0;
+  var startTime = new Date().valueOf();
+  var onResult = function (results) {
+    doneCount++;
+    if (sentCount < NUM_CALLS) {
+      sentCount++;
+      ant.stream.callRpcAsync(
+        ant.stream.RPC_METHOD.ELEMENT_SETPROPERTY,
+        setPropertyArgs(),
+        onResult
+      );
+    } else if (doneCount == NUM_CALLS) {
+      var elapsedMS = new Date().valueOf() - startTime;
+      console.log(
+        '**StreamRPCBench** pipelined(' +
+          NUM_IN_FLIGHT +
+          '): ' +
+          NUM_CALLS +
+          ' calls in ' +
+          elapsedMS +
+          'ms (' +
+          ((NUM_CALLS * 1000) / elapsedMS).toFixed(1) +
+          ' calls/sec)'
+      );
+      onFinish();
+    }
+  };
+  for (var i = 0; i < NUM_IN_FLIGHT && sentCount < NUM_CALLS; i++) {
+    sentCount++;
+    ant.stream.callRpcAsync(
+      ant.stream.RPC_METHOD.ELEMENT_SETPROPERTY,
+      setPropertyArgs(),
+      onResult
+    );
+  }
+};
+
+var onInitialize = function () {
+  console.log('onInitialize');
+};
+
+var onStart = function () {
+  ant.stream.initialize();
+  setTimeout(function () {
+    element = ant.stream.createElement('identity');
+    runSyncBench();
+    runPipelinedBench(function () {
+      console.log('**StreamRPCBench** finished');
+    });
+  }, 2000);
+};
+
+var onStop = function () {
+  console.log('onStop');
+  ant.stream.finalize();
+};
+
+ant.runtime.setCurrentApp(onInitialize, onStart, onStop);
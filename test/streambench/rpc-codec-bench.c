@@ -0,0 +1,117 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stream API RPC message throughput benchmark
+// It compares the legacy newline-split text messages (fixed 10x1000 argv,
+// strtok and sscanf) with the binary RPC messages, by encoding and parsing
+// an element_setProperty call.
+//
+//   gcc -O2 -I../../api/antstream/native/internal rpc-codec-bench.c
+//     ../../api/antstream/native/internal/ant_stream_rpc.c
+//     -o rpc-codec-bench && ./rpc-codec-bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ant_stream_rpc.h"
+
+#define LEGACY_RPC_MAX_ARGC 10
+#define LEGACY_MAX_ARG_LENGTH 1000
+
+static volatile int g_sink;
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void legacy_round_trip(int element_index, const char *key, int value) {
+  char message[LEGACY_MAX_ARG_LENGTH];
+  char argv[LEGACY_RPC_MAX_ARGC][LEGACY_MAX_ARG_LENGTH];
+  int argc = 0;
+  int parsed_index, parsed_type, parsed_value;
+  char *token;
+
+  // JS side: string concatenation
+  snprintf(message, sizeof(message), "element_setProperty\n%d\n%s\n%d\n%d",
+           element_index, key, 2, value);
+
+  // Stream thread: tokenize, copy and re-parse numbers
+  token = strtok(message, "\n");
+  while (token != NULL) {
+    if (argc < LEGACY_RPC_MAX_ARGC) {
+      snprintf(argv[argc], LEGACY_MAX_ARG_LENGTH, "%s", token);
+    }
+    argc++;
+    token = strtok(NULL, "\n");
+  }
+  if (strncmp(argv[0], "element_setProperty", LEGACY_MAX_ARG_LENGTH) == 0) {
+    sscanf(argv[1], "%d", &parsed_index);
+    sscanf(argv[3], "%d", &parsed_type);
+    sscanf(argv[4], "%d", &parsed_value);
+    g_sink = parsed_index + parsed_type + parsed_value + argv[2][0];
+  }
+}
+
+static void binary_round_trip(int element_index, const char *key, int value) {
+  rpc_writer_t writer;
+  rpc_message_t msg;
+  uint8_t *message;
+  size_t length;
+
+  // JS side: typed arguments
+  rpc_writer_init(&writer, RPC_ELEMENT_SETPROPERTY);
+  rpc_writer_put_integer(&writer, element_index);
+  rpc_writer_put_string(&writer, key, (uint32_t)strlen(key));
+  rpc_writer_put_integer(&writer, value);
+  message = rpc_writer_finish(&writer, &length);
+
+  // Stream thread: parse without copying strings
+  if (rpc_message_parse(message, length, &msg) == RPC_OK) {
+    if (rpc_message_check_signature(&msg, "is*")) {
+      g_sink = RPC_ARG_INTEGER_VALUE(&msg, 0) + RPC_ARG_INTEGER_VALUE(&msg, 2) +
+               RPC_ARG_STRING_VALUE(&msg, 1)[0];
+    }
+    rpc_message_destroy(&msg);
+  }
+  free(message);
+}
+
+int main(int argc, char **argv) {
+  long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+  double start, legacy_sec, binary_sec;
+  long i;
+
+  start = now_sec();
+  for (i = 0; i < iterations; i++) {
+    legacy_round_trip((int)(i % 100), "config-interval", (int)i);
+  }
+  legacy_sec = now_sec() - start;
+
+  start = now_sec();
+  for (i = 0; i < iterations; i++) {
+    binary_round_trip((int)(i % 100), "config-interval", (int)i);
+  }
+  binary_sec = now_sec() - start;
+
+  printf("**StreamRPCCodecBench** legacy text: %.0f msgs/sec\n",
+         (double)iterations / legacy_sec);
+  printf("**StreamRPCCodecBench** binary: %.0f msgs/sec\n",
+         (double)iterations / binary_sec);
+  return 0;
+}
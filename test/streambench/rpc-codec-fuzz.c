@@ -0,0 +1,169 @@
+/* Copyright (c) 2017-2020 SKKU ESLAB, and contributors. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stream API RPC message parser fuzz test
+// Every input must be either rejected or parsed into a message that is
+// re-encoded into exactly the same bytes.
+//
+// Standalone (random mutation of valid messages):
+//   gcc -g -fsanitize=address,undefined -I../../api/antstream/native/internal
+//     rpc-codec-fuzz.c ../../api/antstream/native/internal/ant_stream_rpc.c
+//     -o rpc-codec-fuzz && ./rpc-codec-fuzz [iterations]
+// libFuzzer:
+//   clang -g -DANT_LIBFUZZER -fsanitize=fuzzer,address,undefined
+//     -I../../api/antstream/native/internal rpc-codec-fuzz.c
+//     ../../api/antstream/native/internal/ant_stream_rpc.c -o rpc-codec-fuzz
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ant_stream_rpc.h"
+
+static void check_message(const uint8_t *data, size_t length) {
+  rpc_message_t msg;
+  rpc_writer_t writer;
+  uint8_t *encoded;
+  size_t encoded_length;
+  uint32_t i;
+
+  if (rpc_message_parse(data, length, &msg) != RPC_OK)
+    return;
+
+  // Parsed strings must be inside the message and NUL-terminated
+  for (i = 0; i < msg.argc; i++) {
+    if (msg.args[i].type == RPC_ARG_STRING) {
+      const char *str = RPC_ARG_STRING_VALUE(&msg, i);
+      uint32_t str_length = msg.args[i].value.string.length;
+      if ((const uint8_t *)str < data ||
+          (const uint8_t *)str + str_length >= data + length ||
+          str[str_length] != '\0') {
+        fprintf(stderr, "FAIL: string argument %u is out of message\n", i);
+        abort();
+      }
+    }
+  }
+
+  // Round trip
+  rpc_writer_init(&writer, msg.method_id);
+  for (i = 0; i < msg.argc; i++) {
+    rpc_writer_put_arg(&writer, &msg.args[i]);
+  }
+  encoded = rpc_writer_finish(&writer, &encoded_length);
+  if (encoded == NULL || encoded_length != length ||
+      memcmp(encoded, data, length) != 0) {
+    // Booleans other than 0/1 are normalized by the parser
+    bool is_normalized = false;
+    for (i = 0; i < msg.argc; i++) {
+      if (msg.args[i].type == RPC_ARG_BOOLEAN)
+        is_normalized = true;
+    }
+    if (encoded == NULL || encoded_length != length || !is_normalized) {
+      fprintf(stderr, "FAIL: round trip mismatch\n");
+      abort();
+    }
+  }
+  free(encoded);
+  rpc_message_destroy(&msg);
+}
+
+#ifdef ANT_LIBFUZZER
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  check_message(data, size);
+  return 0;
+}
+#else
+static uint8_t *make_seed_message(size_t *length) {
+  rpc_writer_t writer;
+  int i;
+  rpc_writer_init(&writer, (uint16_t)(rand() % (RPC_METHOD_COUNT + 2)));
+  for (i = rand() % 12; i > 0; i--) {
+    switch (rand() % 4) {
+    case 0:
+      rpc_writer_put_boolean(&writer, rand() % 2);
+      break;
+    case 1: {
+      char str[64];
+      int str_length = rand() % (int)sizeof(str);
+      memset(str, 'a' + rand() % 26, (size_t)str_length);
+      rpc_writer_put_string(&writer, str, (uint32_t)str_length);
+      break;
+    }
+    case 2:
+      rpc_writer_put_integer(&writer, rand());
+      break;
+    case 3:
+      rpc_writer_put_double(&writer, rand() / 3.0);
+      break;
+    }
+  }
+  return rpc_writer_finish(&writer, length);
+}
+
+static void mutate(uint8_t *data, size_t *length, size_t capacity) {
+  int n = 1 + rand() % 4;
+  while (n-- > 0) {
+    switch (rand() % 4) {
+    case 0: // flip a byte
+      if (*length > 0)
+        data[rand() % *length] ^= (uint8_t)(1 << (rand() % 8));
+      break;
+    case 1: // random byte
+      if (*length > 0)
+        data[rand() % *length] = (uint8_t)rand();
+      break;
+    case 2: // truncate
+      if (*length > 0)
+        *length = (size_t)rand() % *length;
+      break;
+    case 3: // append
+      if (*length < capacity)
+        data[(*length)++] = (uint8_t)rand();
+      break;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  long iterations = (argc > 1) ? atol(argv[1]) : 1000000;
+  long i;
+  srand(0);
+  for (i = 0; i < iterations; i++) {
+    size_t length;
+    uint8_t *seed = make_seed_message(&length);
+    size_t capacity = length + 16;
+    uint8_t *data = (uint8_t *)malloc(capacity);
+    memcpy(data, seed, length);
+    free(seed);
+
+    // A valid message must be parsed
+    {
+      rpc_message_t msg;
+      if (rpc_message_parse(data, length, &msg) != RPC_OK) {
+        fprintf(stderr, "FAIL: valid message is rejected\n");
+        return 1;
+      }
+      rpc_message_destroy(&msg);
+    }
+    check_message(data, length);
+
+    mutate(data, &length, capacity);
+    check_message(data, length);
+    free(data);
+  }
+  printf("PASS: %ld iterations\n", iterations);
+  return 0;
+}
+#endif